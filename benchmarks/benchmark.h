@@ -0,0 +1,38 @@
+#ifndef ANDROIDSCRIPT_BENCHMARK_H
+#define ANDROIDSCRIPT_BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Timed part of a benchmark: performs about `ops` operations and returns
+// how many it actually did
+using BenchmarkBody = std::function<int64_t(int64_t ops)>;
+
+struct Benchmark {
+    std::string name;                     // "group/case"
+    std::function<BenchmarkBody()> setup; // Untimed; builds the state the body uses
+    int64_t bytes_per_op = 0;             // Input bytes per operation, if meaningful
+};
+
+void addFrontendBenchmarks(std::vector<Benchmark>& suite);
+void addInterpreterBenchmarks(std::vector<Benchmark>& suite);
+void addValueBenchmarks(std::vector<Benchmark>& suite);
+
+// Keep the compiler from dropping a result that is never read
+template <typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_BENCHMARK_H
@@ -0,0 +1,86 @@
+#include "benchmark.h"
+#include "lexer.h"
+#include "parser.h"
+#include <memory>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// A script with `functions` functions mixing the usual statements and
+// expressions. The same count always gives the same text.
+std::string generateScript(int functions) {
+    std::string script = "// Generated benchmark input\n";
+    for (int i = 0; i < functions; ++i) {
+        std::string n = std::to_string(i);
+        script +=
+            "function Step" + n + "(count, label) {\n"
+            "    total = 0\n"
+            "    items = [1, 2, 3, " + n + "]\n"
+            "    for (i = 0; i < count; i = i + 1) {\n"
+            "        if (i % 3 == 0 && label != \"skip\") {\n"
+            "            total = total + i * " + n + " - 1\n"
+            "        } else {\n"
+            "            Push(items, \"item-\" + ToString(i))\n"
+            "        }\n"
+            "    }\n"
+            "    ForEach(item in items) {\n"
+            "        Log(\"step " + n + ": \" + ToString(item))\n"
+            "    }\n"
+            "    return total\n"
+            "}\n"
+            "result" + n + " = Step" + n + "(" + n + ", \"run\")\n";
+    }
+    return script;
+}
+
+void addSizes(std::vector<Benchmark>& suite, const char* group, bool parse) {
+    const std::pair<const char*, int> sizes[] = {{"small", 10}, {"medium", 100}, {"large", 1000}};
+    for (const auto& size : sizes) {
+        auto source = std::make_shared<std::string>(generateScript(size.second));
+        Benchmark benchmark;
+        benchmark.name = std::string(group) + "/" + size.first;
+        benchmark.bytes_per_op = static_cast<int64_t>(source->size());
+        benchmark.setup = [source, parse]() -> BenchmarkBody {
+            Lexer lexer(*source);
+            auto tokens = std::make_shared<std::vector<Token>>(lexer.tokenize());
+            Parser check(*tokens);
+            check.parse();
+            if (lexer.hasErrors() || check.hasErrors()) {
+                throw std::runtime_error("generated script does not parse");
+            }
+
+            if (!parse) {
+                return [source](int64_t ops) {
+                    for (int64_t i = 0; i < ops; ++i) {
+                        Lexer lexer(*source);
+                        auto result = lexer.tokenize();
+                        keep(result);
+                    }
+                    return ops;
+                };
+            }
+            return [tokens](int64_t ops) {
+                for (int64_t i = 0; i < ops; ++i) {
+                    Parser parser(*tokens);
+                    auto program = parser.parse();
+                    keep(program);
+                }
+                return ops;
+            };
+        };
+        suite.push_back(std::move(benchmark));
+    }
+}
+
+} // namespace
+
+// One operation is a whole generated script: tokenizing its text, or
+// parsing its tokens
+void addFrontendBenchmarks(std::vector<Benchmark>& suite) {
+    addSizes(suite, "lex", false);
+    addSizes(suite, "parse", true);
+}
+
+} // namespace androidscript
@@ -0,0 +1,159 @@
+#include "benchmark.h"
+#include "environment.h"
+#include "interpreter_pool.h"
+#include "lexer.h"
+#include "parser.h"
+#include <memory>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+struct ScriptCase {
+    const char* name;
+    // Defines Bench(n), which runs its loop body n times. `data` is a
+    // 1000-element integer array and `record` an object with fields a and b.
+    const char* source;
+};
+
+const ScriptCase kCases[] = {
+    // Loop overhead alone, to subtract from the others
+    {"loop_empty",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+    {"variable_lookup",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        if (true) {\n"
+     "            if (true) {\n"
+     "                v = g1 + g2 + g3 + g4\n"
+     "            }\n"
+     "        }\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"
+     "g1 = 1\n"
+     "g2 = 2\n"
+     "g3 = 3\n"
+     "g4 = 4\n"},
+    {"arithmetic",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    s = 0\n"
+     "    while (i < n) {\n"
+     "        s = (s + i * 3 - 1) % 1000003\n"
+     "        f = i * 0.5 + 2.25\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+    {"function_call",
+     "function Add(a, b) {\n"
+     "    return a + b\n"
+     "}\n"
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        i = Add(i, 1)\n"
+     "    }\n"
+     "}\n"},
+    {"string_concat",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        s = \"device-\" + \"emulator\" + \":\" + i\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+    {"array_push",
+     "function Bench(n) {\n"
+     "    items = []\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        Push(items, i)\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+    {"array_iterate",
+     "function Bench(n) {\n"
+     "    done = 0\n"
+     "    s = 0\n"
+     "    while (done < n) {\n"
+     "        ForEach(x in data) {\n"
+     "            s = s + x\n"
+     "        }\n"
+     "        done = done + 1000\n"
+     "    }\n"
+     "    return done\n"
+     "}\n"},
+    {"member_access",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        v = record.a + record.b\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+    {"native_call",
+     "function Bench(n) {\n"
+     "    i = 0\n"
+     "    while (i < n) {\n"
+     "        v = Length(\"abc\")\n"
+     "        i = i + 1\n"
+     "    }\n"
+     "}\n"},
+};
+
+BenchmarkBody setupScript(const char* source) {
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    auto program = std::make_shared<std::vector<std::unique_ptr<Statement>>>(parser.parse());
+    if (lexer.hasErrors() || parser.hasErrors()) {
+        throw std::runtime_error("benchmark script does not parse");
+    }
+
+    std::shared_ptr<Interpreter> interpreter = InterpreterPool::create();
+    ValueArray data;
+    for (int64_t i = 0; i < 1000; ++i) {
+        data.push_back(Value(i));
+    }
+    auto globals = interpreter->getGlobalEnvironment();
+    globals->define("data", Value(std::move(data)));
+    ValueMap record;
+    record["a"] = Value(1);
+    record["b"] = Value(2);
+    globals->define("record", Value(std::move(record)));
+
+    interpreter->execute(*program);
+    if (interpreter->hasErrors()) {
+        throw std::runtime_error("benchmark script failed: " + interpreter->getErrors().front());
+    }
+    Value bench = globals->get("Bench");
+
+    // The AST stays alive as long as the interpreter that ran it
+    return [program, interpreter, bench](int64_t ops) {
+        Value done = interpreter->callFunction(bench, {Value(ops)});
+        return done.isInt() ? done.asInt() : ops;
+    };
+}
+
+} // namespace
+
+// One operation is one iteration of the script's loop (one element for
+// array_iterate)
+void addInterpreterBenchmarks(std::vector<Benchmark>& suite) {
+    for (const auto& script : kCases) {
+        Benchmark benchmark;
+        benchmark.name = std::string("interp/") + script.name;
+        const char* source = script.source;
+        benchmark.setup = [source]() { return setupScript(source); };
+        suite.push_back(std::move(benchmark));
+    }
+}
+
+} // namespace androidscript
@@ -0,0 +1,155 @@
+// Microbenchmarks for the lexer, parser, interpreter and Value
+//
+//   androidscript-bench [--filter=TEXT] [--samples=N] [--min-time=MS]
+//                       [--label=TEXT] [--list] [--check]
+//
+// Each benchmark's operation count is calibrated until one run takes at
+// least --min-time, then that many operations are timed --samples times.
+// Results go to stdout as JSON (progress to stderr), so runs from
+// different commits can be compared. --check only runs each benchmark's
+// setup, including the correctness checks some of them make, and fails if
+// one throws; the build runs it on the value/format_ benchmarks.
+
+#include "benchmark.h"
+#include "json.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef ANDROIDSCRIPT_BUILD_TYPE
+#define ANDROIDSCRIPT_BUILD_TYPE "unknown"
+#endif
+
+using namespace androidscript;
+
+namespace {
+
+struct Options {
+    std::string filter;
+    int samples = 5;
+    int64_t min_time_ms = 100;
+    std::string label;
+    bool list = false;
+    bool check = false;
+};
+
+// Value of --name=value, or nullptr if arg is another option
+const char* option(const std::string& arg, const char* name) {
+    std::string prefix = std::string("--") + name + "=";
+    return arg.rfind(prefix, 0) == 0 ? arg.c_str() + prefix.size() : nullptr;
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (const char* value = option(arg, "filter")) {
+            options.filter = value;
+        } else if (const char* value = option(arg, "samples")) {
+            options.samples = std::max(1, std::stoi(value));
+        } else if (const char* value = option(arg, "min-time")) {
+            options.min_time_ms = std::max<int64_t>(1, std::stoll(value));
+        } else if (const char* value = option(arg, "label")) {
+            options.label = value;
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+int64_t elapsedNs(const BenchmarkBody& body, int64_t ops, int64_t& done) {
+    auto start = std::chrono::steady_clock::now();
+    done = body(ops);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+Value run(const Benchmark& benchmark, const Options& options) {
+    BenchmarkBody body = benchmark.setup();
+
+    // Calibrate; this also warms up caches and the allocator
+    int64_t min_ns = options.min_time_ms * 1000000;
+    int64_t ops = 1;
+    int64_t done = 0;
+    while (true) {
+        int64_t ns = elapsedNs(body, ops, done);
+        if (ns >= min_ns) break;
+        int64_t scale = ns > 0 ? min_ns * 12 / 10 / ns : 100;
+        ops *= std::clamp<int64_t>(scale, 2, 100);
+    }
+
+    std::vector<double> per_op;
+    for (int i = 0; i < options.samples; ++i) {
+        int64_t ns = elapsedNs(body, ops, done);
+        per_op.push_back(static_cast<double>(ns) / static_cast<double>(std::max<int64_t>(done, 1)));
+    }
+    std::sort(per_op.begin(), per_op.end());
+
+    ValueMap result;
+    result["name"] = Value(benchmark.name);
+    result["ops_per_sample"] = Value(done);
+    result["ns_per_op"] = Value(per_op[per_op.size() / 2]);
+    result["min_ns_per_op"] = Value(per_op.front());
+    result["max_ns_per_op"] = Value(per_op.back());
+    if (benchmark.bytes_per_op) {
+        result["bytes_per_op"] = Value(benchmark.bytes_per_op);
+        result["mb_per_s"] = Value(static_cast<double>(benchmark.bytes_per_op) * 1000.0 /
+                                   per_op[per_op.size() / 2]);
+    }
+    return Value(std::move(result));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parseOptions(argc, argv);
+
+        std::vector<Benchmark> suite;
+        addFrontendBenchmarks(suite);
+        addInterpreterBenchmarks(suite);
+        addValueBenchmarks(suite);
+
+        ValueArray results;
+        for (const auto& benchmark : suite) {
+            if (benchmark.name.find(options.filter) == std::string::npos) continue;
+            if (options.list) {
+                std::cout << benchmark.name << "\n";
+                continue;
+            }
+            if (options.check) {
+                benchmark.setup();
+                std::cerr << benchmark.name << "... ok\n";
+                continue;
+            }
+            std::cerr << benchmark.name << "..." << std::flush;
+            Value result = run(benchmark, options);
+            std::cerr << " " << std::fixed << std::setprecision(1)
+                      << result["ns_per_op"].asFloat() << " ns/op\n";
+            results.push_back(std::move(result));
+        }
+        if (options.list || options.check) return 0;
+
+        ValueMap report;
+        report["label"] = Value(options.label);
+        report["build_type"] = Value(ANDROIDSCRIPT_BUILD_TYPE);
+#ifdef __VERSION__
+        report["compiler"] = Value(__VERSION__);
+#endif
+        report["samples"] = Value(options.samples);
+        report["min_time_ms"] = Value(options.min_time_ms);
+        report["benchmarks"] = Value(std::move(results));
+        std::cout << stringifyJson(Value(std::move(report)), 2) << "\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
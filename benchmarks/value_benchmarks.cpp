@@ -0,0 +1,225 @@
+#include "benchmark.h"
+#include "number_format.h"
+#include "value.h"
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+template <typename Body>
+void add(std::vector<Benchmark>& suite, const char* name, Body body) {
+    Benchmark benchmark;
+    benchmark.name = std::string("value/") + name;
+    benchmark.setup = [body]() -> BenchmarkBody { return body; };
+    suite.push_back(std::move(benchmark));
+}
+
+template <typename Setup>
+void addWithSetup(std::vector<Benchmark>& suite, const char* name, Setup setup) {
+    Benchmark benchmark;
+    benchmark.name = std::string("value/") + name;
+    benchmark.setup = setup;
+    suite.push_back(std::move(benchmark));
+}
+
+// Deterministic 64-bit pattern stream (splitmix64)
+uint64_t nextBits(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Finite doubles spread over the whole exponent range, and int64s of
+// every width
+std::vector<double> randomDoubles(size_t count, uint64_t seed) {
+    std::vector<double> values;
+    values.reserve(count);
+    while (values.size() < count) {
+        uint64_t bits = nextBits(seed);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (std::isfinite(value)) values.push_back(value);
+    }
+    return values;
+}
+
+std::vector<int64_t> randomInts(size_t count, uint64_t seed) {
+    std::vector<int64_t> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t bits = nextBits(seed);
+        values.push_back(static_cast<int64_t>(bits >> (bits % 64)));
+        if (bits & 1) values.back() = -values.back();
+    }
+    return values;
+}
+
+// Every value must parse back from its text bit for bit; throws otherwise.
+// Run from the format benchmarks' setup over a million values each.
+void checkRoundTrip(const std::vector<double>& doubles, const std::vector<int64_t>& ints) {
+    std::string text;
+    for (double value : doubles) {
+        text.clear();
+        appendFloat(text, value);
+        double parsed = 0;
+        if (!parseFloat(text, parsed) || std::memcmp(&parsed, &value, sizeof(value)) != 0) {
+            throw std::runtime_error("float round trip failed for " + text);
+        }
+    }
+    for (int64_t value : ints) {
+        text.clear();
+        appendInt(text, value);
+        int64_t parsed = 0;
+        if (!parseInt(text, parsed) || parsed != value) {
+            throw std::runtime_error("int round trip failed for " + text);
+        }
+    }
+}
+
+// Table of inputs the number benchmarks cycle through
+constexpr size_t kNumbers = 1024;
+
+ValueArray numbers(int64_t count) {
+    ValueArray items;
+    for (int64_t i = 0; i < count; ++i) {
+        items.push_back(Value(i));
+    }
+    return items;
+}
+
+} // namespace
+
+// Value operations called from C++, without the interpreter around them
+void addValueBenchmarks(std::vector<Benchmark>& suite) {
+    add(suite, "copy_int", [](int64_t ops) {
+        Value source(int64_t(42));
+        for (int64_t i = 0; i < ops; ++i) {
+            Value copy(source);
+            keep(copy);
+        }
+        return ops;
+    });
+    add(suite, "copy_string", [](int64_t ops) {
+        Value source("com.example.application.MainActivity");
+        for (int64_t i = 0; i < ops; ++i) {
+            Value copy(source);
+            keep(copy);
+        }
+        return ops;
+    });
+    add(suite, "copy_array_100", [](int64_t ops) {
+        Value source(numbers(100));
+        for (int64_t i = 0; i < ops; ++i) {
+            Value copy(source);
+            keep(copy);
+        }
+        return ops;
+    });
+    add(suite, "add_int", [](int64_t ops) {
+        Value sum(int64_t(0));
+        Value one(int64_t(1));
+        for (int64_t i = 0; i < ops; ++i) {
+            sum = sum + one;
+        }
+        keep(sum);
+        return ops;
+    });
+    add(suite, "concat_string", [](int64_t ops) {
+        Value prefix("device-");
+        Value serial("emulator-5554");
+        for (int64_t i = 0; i < ops; ++i) {
+            Value joined = prefix + serial;
+            keep(joined);
+        }
+        return ops;
+    });
+    add(suite, "compare_string", [](int64_t ops) {
+        Value a("com.example.application.MainActivity");
+        Value b("com.example.application.MainActivitx");
+        int64_t equal = 0;
+        for (int64_t i = 0; i < ops; ++i) {
+            keep(a);
+            equal += (a == b) ? 1 : 0;
+        }
+        keep(equal);
+        return ops;
+    });
+    add(suite, "array_push", [](int64_t ops) {
+        Value items = Value::makeArray();
+        for (int64_t i = 0; i < ops; ++i) {
+            items.asArray().push_back(Value(i));
+        }
+        keep(items);
+        return ops;
+    });
+    add(suite, "object_member", [](int64_t ops) {
+        ValueMap fields;
+        for (const char* key : {"serial", "model", "android_version", "screen_width", "screen_height"}) {
+            fields[key] = Value(key);
+        }
+        Value object(std::move(fields));
+        for (int64_t i = 0; i < ops; ++i) {
+            const Value& field = object["screen_width"];
+            keep(field);
+        }
+        return ops;
+    });
+
+    addWithSetup(suite, "format_float", []() -> BenchmarkBody {
+        checkRoundTrip(randomDoubles(1000000, 1), {});
+        auto values = std::make_shared<std::vector<double>>(randomDoubles(kNumbers, 2));
+        return [values](int64_t ops) {
+            std::string text;
+            for (int64_t i = 0; i < ops; ++i) {
+                text.clear();
+                appendFloat(text, (*values)[static_cast<size_t>(i) % kNumbers]);
+                keep(text);
+            }
+            return ops;
+        };
+    });
+    addWithSetup(suite, "format_int", []() -> BenchmarkBody {
+        checkRoundTrip({}, randomInts(1000000, 3));
+        auto values = std::make_shared<std::vector<int64_t>>(randomInts(kNumbers, 4));
+        return [values](int64_t ops) {
+            std::string text;
+            for (int64_t i = 0; i < ops; ++i) {
+                text.clear();
+                appendInt(text, (*values)[static_cast<size_t>(i) % kNumbers]);
+                keep(text);
+            }
+            return ops;
+        };
+    });
+    addWithSetup(suite, "parse_float", []() -> BenchmarkBody {
+        auto texts = std::make_shared<std::vector<std::string>>();
+        for (double value : randomDoubles(kNumbers, 5)) texts->push_back(formatFloat(value));
+        return [texts](int64_t ops) {
+            double value = 0;
+            for (int64_t i = 0; i < ops; ++i) {
+                parseFloat((*texts)[static_cast<size_t>(i) % kNumbers], value);
+                keep(value);
+            }
+            return ops;
+        };
+    });
+    addWithSetup(suite, "parse_int", []() -> BenchmarkBody {
+        auto texts = std::make_shared<std::vector<std::string>>();
+        for (int64_t value : randomInts(kNumbers, 6)) texts->push_back(formatInt(value));
+        return [texts](int64_t ops) {
+            int64_t value = 0;
+            for (int64_t i = 0; i < ops; ++i) {
+                parseInt((*texts)[static_cast<size_t>(i) % kNumbers], value);
+                keep(value);
+            }
+            return ops;
+        };
+    });
+}
+
+} // namespace androidscript
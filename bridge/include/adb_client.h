@@ -1,6 +1,7 @@
 #ifndef ANDROIDSCRIPT_ADB_CLIENT_H
 #define ANDROIDSCRIPT_ADB_CLIENT_H
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
@@ -27,6 +28,28 @@ struct AdbResult {
     bool success() const { return exit_code == 0; }
 };
 
+// Hook invoked before every blocking read from an adb child process.
+// A cooperative scheduler installs one to park the calling coroutine until
+// the pipe is readable instead of blocking the OS thread. The hook is
+// per-thread; when none is set reads block normally.
+using IoWaitHook = void (*)(int fd);
+void setIoWaitHook(IoWaitHook hook);
+
+// Hook told what an adb command is doing on the calling thread: "adb spawn"
+// while the adb process starts, "adb wait" while its output is read, and
+// nullptr once it has exited. Per-thread; used by the profiler.
+using CommandPhaseHook = void (*)(const char* phase);
+void setCommandPhaseHook(CommandPhaseHook hook);
+
+// Hook given the arguments and timing of every adb command once it has
+// exited: when it was started, when the process was running and when it
+// finished. Process-wide; used by the tracer.
+using CommandTraceHook = void (*)(const std::vector<std::string>& args,
+                                  std::chrono::steady_clock::time_point started,
+                                  std::chrono::steady_clock::time_point spawned,
+                                  std::chrono::steady_clock::time_point finished);
+void setCommandTraceHook(CommandTraceHook hook);
+
 // ADB Client for device communication
 class AdbClient {
 public:
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <iostream>
 #include <array>
+#include <atomic>
 #include <memory>
 #include <stdexcept>
 
@@ -11,10 +12,37 @@
 #else
 #include <unistd.h>
 #include <sys/wait.h>
+#include <cerrno>
 #endif
 
 namespace androidscript {
 
+namespace {
+
+thread_local IoWaitHook t_io_wait_hook = nullptr;
+thread_local CommandPhaseHook t_phase_hook = nullptr;
+std::atomic<CommandTraceHook> g_trace_hook{nullptr};
+
+void phase(const char* name) {
+    if (t_phase_hook) {
+        t_phase_hook(name);
+    }
+}
+
+} // namespace
+
+void setIoWaitHook(IoWaitHook hook) {
+    t_io_wait_hook = hook;
+}
+
+void setCommandPhaseHook(CommandPhaseHook hook) {
+    t_phase_hook = hook;
+}
+
+void setCommandTraceHook(CommandTraceHook hook) {
+    g_trace_hook.store(hook);
+}
+
 AdbClient::AdbClient() {
     adb_path_ = findAdbPath();
     if (adb_path_.empty()) {
@@ -56,7 +84,12 @@ AdbResult AdbClient::executeCommand(const std::vector<std::string>& args) {
 
     std::string command = cmd.str();
 
+    using Clock = std::chrono::steady_clock;
+    CommandTraceHook trace = g_trace_hook.load(std::memory_order_relaxed);
+    Clock::time_point started = trace ? Clock::now() : Clock::time_point();
+
     // Execute command and capture output
+    phase("adb spawn");
 #ifdef _WIN32
     // Windows implementation
     FILE* pipe = _popen(command.c_str(), "r");
@@ -66,15 +99,41 @@ AdbResult AdbClient::executeCommand(const std::vector<std::string>& args) {
 #endif
 
     if (!pipe) {
+        phase(nullptr);
+        if (trace) {
+            Clock::time_point now = Clock::now();
+            trace(args, started, now, now);
+        }
         return {-1, "", "Failed to execute command"};
     }
+    Clock::time_point spawned = trace ? Clock::now() : Clock::time_point();
 
     // Read output
+    phase("adb wait");
     std::string output;
-    std::array<char, 128> buffer;
-    while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
+    std::array<char, 4096> buffer;
+#ifdef _WIN32
+    while (fgets(buffer.data(), static_cast<int>(buffer.size()), pipe) != nullptr) {
         output += buffer.data();
     }
+#else
+    // Unbuffered reads of whatever is available, so an installed wait hook
+    // only ever parks the caller while the pipe is empty
+    int fd = fileno(pipe);
+    while (true) {
+        if (t_io_wait_hook) {
+            t_io_wait_hook(fd);
+        }
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n > 0) {
+            output.append(buffer.data(), static_cast<size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+#endif
 
     // Close pipe and get exit code
 #ifdef _WIN32
@@ -85,6 +144,10 @@ AdbResult AdbClient::executeCommand(const std::vector<std::string>& args) {
         exit_code = WEXITSTATUS(exit_code);
     }
 #endif
+    phase(nullptr);
+    if (trace) {
+        trace(args, started, spawned, Clock::now());
+    }
 
     return {exit_code, output, ""};
 }
@@ -0,0 +1,27 @@
+# Ahead-of-time compilation of AndroidScript files
+#
+# androidscript_add_aot_executable(<name> <script.as>)
+#
+# Translates the script to C++ with `androidscript --emit-cpp` at build time
+# and builds it into a standalone executable linked against the same core
+# runtime and ADB bridge the interpreter uses.
+
+function(androidscript_add_aot_executable name script)
+    get_filename_component(script_path "${script}" ABSOLUTE)
+    set(generated "${CMAKE_CURRENT_BINARY_DIR}/${name}.cpp")
+
+    add_custom_command(
+        OUTPUT "${generated}"
+        COMMAND androidscript --emit-cpp "${script_path}" -o "${generated}"
+        DEPENDS androidscript "${script_path}"
+        COMMENT "Compiling ${script} to C++"
+        VERBATIM
+    )
+
+    add_executable(${name} "${generated}")
+    target_link_libraries(${name}
+        PRIVATE
+            androidscript-core
+            androidscript-bridge
+    )
+endfunction()
@@ -0,0 +1,139 @@
+#ifndef ANDROIDSCRIPT_AOT_RUNTIME_H
+#define ANDROIDSCRIPT_AOT_RUNTIME_H
+
+// Runtime support for scripts compiled with `androidscript --emit-cpp`
+//
+// Generated translation units include this header and link against
+// androidscript-core and androidscript-bridge. Everything here mirrors the
+// semantics of the tree-walking Interpreter so compiled scripts behave the
+// same way (evaluation order, scoping, error messages).
+
+#include "interpreter.h"
+#include "environment.h"
+#include "builtins.h"
+#include "hash_table.h"
+#include "module.h"
+#include "named_args.h"
+#include "scheduler.h"
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+namespace aot {
+
+// Binary operands. Always built with a braced-init-list so the left operand
+// is evaluated before the right one, as in Interpreter::visit(BinaryExpr&).
+struct Operands {
+    Value left;
+    Value right;
+};
+
+// Callee followed by its arguments, evaluated left to right
+struct CallSite {
+    Value callee;
+    std::vector<Value> args;
+};
+
+using CompiledFunction = Value (*)(const std::vector<Value>&, const std::shared_ptr<Environment>&);
+
+inline Value add(const Operands& o) { return o.left + o.right; }
+inline Value sub(const Operands& o) { return o.left - o.right; }
+inline Value mul(const Operands& o) { return o.left * o.right; }
+inline Value div(const Operands& o) { return o.left / o.right; }
+inline Value mod(const Operands& o) { return o.left % o.right; }
+inline Value eq(const Operands& o) { return Value(o.left == o.right); }
+inline Value ne(const Operands& o) { return Value(o.left != o.right); }
+inline Value lt(const Operands& o) { return Value(o.left < o.right); }
+inline Value le(const Operands& o) { return Value(o.left <= o.right); }
+inline Value gt(const Operands& o) { return Value(o.left > o.right); }
+inline Value ge(const Operands& o) { return Value(o.left >= o.right); }
+
+// Both sides are always evaluated (the interpreter does not short-circuit)
+inline Value logicalAnd(const Operands& o) { return Value(o.left.isTruthy() && o.right.isTruthy()); }
+inline Value logicalOr(const Operands& o) { return Value(o.left.isTruthy() || o.right.isTruthy()); }
+
+// Object evaluated before index, as in Interpreter::visit(IndexExpr&)
+inline Value index(const Operands& o) { return Interpreter::getIndex(o.left, o.right); }
+
+inline Value call(const CallSite& site) {
+    if (site.callee.isNativeFunction()) {
+        return site.callee.asNativeFunction()(site.args);
+    }
+    if (site.callee.isFunction() && site.callee.asFunction().compiled) {
+        const FunctionObject& func = site.callee.asFunction();
+        return func.compiled(site.args, func.closure);
+    }
+    throw std::runtime_error("Value is not callable");
+}
+
+// Call with named arguments: the site's arguments are the positional ones
+// followed by the named ones in source order
+inline Value callNamed(const NamedArgCache& cache, CallSite&& site) {
+    site.args = cache.bind(site.callee, std::move(site.args));
+    return call(site);
+}
+
+inline void checkArity(const std::vector<Value>& args, size_t expected) {
+    if (args.size() != expected) {
+        throw std::runtime_error("Expected " + std::to_string(expected) +
+                                 " arguments but got " + std::to_string(args.size()));
+    }
+}
+
+// Script functions compile to C++ functions bound to their defining scope
+inline Value makeFunction(CompiledFunction fn, std::shared_ptr<Environment> closure,
+                          std::vector<std::string> parameters) {
+    FunctionObject func;
+    func.parameters = std::move(parameters);
+    func.closure = std::move(closure);
+    func.compiled = fn;
+    return Value::makeFunction(func);
+}
+
+// Outermost scope, where #include defines a module's names
+inline std::shared_ptr<Environment> root(std::shared_ptr<Environment> env) {
+    while (!env->isGlobal()) env = env->getParent();
+    return env;
+}
+
+inline Value makeArray(std::vector<Value> elements) {
+    return Value::makeArray(elements);
+}
+
+// Run one top-level statement, recording errors like Interpreter::execute
+template <typename Fn>
+void runStatement(std::vector<std::string>& errors, Fn&& fn) {
+    try {
+        fn();
+    } catch (const ReturnException&) {
+        errors.push_back("Return statement outside of function");
+    } catch (const BreakException&) {
+        errors.push_back("Break statement outside of loop");
+    } catch (const ContinueException&) {
+        errors.push_back("Continue statement outside of loop");
+    } catch (const std::exception& e) {
+        errors.push_back(std::string("Runtime error: ") + e.what());
+    }
+}
+
+// Report errors the same way the androidscript host does
+inline int finish(const std::vector<std::string>& errors) {
+    Scheduler::drainShared();
+    if (errors.empty()) {
+        return 0;
+    }
+    std::cerr << "Runtime errors:\n";
+    for (const auto& error : errors) {
+        std::cerr << "  " << error << "\n";
+    }
+    return 1;
+}
+
+} // namespace aot
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_AOT_RUNTIME_H
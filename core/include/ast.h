@@ -3,6 +3,7 @@
 
 #include "token.h"
 #include <memory>
+#include <utility>
 #include <vector>
 #include <string>
 
@@ -10,6 +11,7 @@ namespace androidscript {
 
 // Forward declarations
 class ASTVisitor;
+class NamedArgCache;
 
 // Base AST Node
 class ASTNode {
@@ -69,7 +71,11 @@ class CallExpr : public Expression {
 public:
     std::unique_ptr<Expression> callee;
     std::vector<std::unique_ptr<Expression>> arguments;
-    std::map<std::string, std::unique_ptr<Expression>> named_args;
+
+    // name: value arguments after the positional ones, in source order, and
+    // their parameter binding (set by the parser when there are any)
+    std::vector<std::pair<std::string, std::unique_ptr<Expression>>> named_args;
+    std::shared_ptr<NamedArgCache> named_cache;
 
     CallExpr(std::unique_ptr<Expression> c,
              std::vector<std::unique_ptr<Expression>> args)
@@ -114,6 +120,10 @@ public:
 class Statement : public ASTNode {
 public:
     virtual ~Statement() = default;
+
+    // Source line of the statement's first token; 0 for blocks and the
+    // clauses of a for loop
+    int line = 0;
 };
 
 class ExpressionStmt : public Statement {
@@ -237,6 +247,21 @@ public:
     void accept(ASTVisitor& visitor) override;
 };
 
+// #include "file.as" or #import "file.as" [as name]
+class ImportStmt : public Statement {
+public:
+    Token directive;
+    Token path;
+    Token alias;  // INVALID when no alias was given
+
+    ImportStmt(Token dir, Token p, Token a)
+        : directive(dir), path(p), alias(a) {}
+
+    bool isInclude() const { return directive.lexeme == "#include"; }
+
+    void accept(ASTVisitor& visitor) override;
+};
+
 // Visitor interface
 class ASTVisitor {
 public:
@@ -264,6 +289,7 @@ public:
     virtual void visit(ReturnStmt& stmt) = 0;
     virtual void visit(BreakStmt& stmt) = 0;
     virtual void visit(ContinueStmt& stmt) = 0;
+    virtual void visit(ImportStmt& stmt) = 0;
 };
 
 } // namespace androidscript
@@ -2,6 +2,7 @@
 #define ANDROIDSCRIPT_BUILTINS_H
 
 #include "value.h"
+#include "environment.h"
 #include <vector>
 
 namespace androidscript {
@@ -11,12 +12,18 @@ class Interpreter;
 
 // Register all built-in functions with the interpreter
 void registerBuiltins(Interpreter& interpreter);
+void registerBuiltins(const std::shared_ptr<Environment>& env);
+
+// Frozen environment holding every builtin, built once per process and
+// shared read-only by interpreters whose globals sit on top of it
+std::shared_ptr<Environment> sharedBuiltins();
 
 // Utility functions
 Value builtin_Print(const std::vector<Value>& args);
 Value builtin_Log(const std::vector<Value>& args);
 Value builtin_LogError(const std::vector<Value>& args);
 Value builtin_Sleep(const std::vector<Value>& args);
+Value builtin_Now(const std::vector<Value>& args);
 Value builtin_Assert(const std::vector<Value>& args);
 
 // String functions
@@ -27,17 +34,60 @@ Value builtin_ToLower(const std::vector<Value>& args);
 Value builtin_Contains(const std::vector<Value>& args);
 Value builtin_Replace(const std::vector<Value>& args);
 
+// Regular expressions
+Value builtin_Match(const std::vector<Value>& args);
+Value builtin_MatchAll(const std::vector<Value>& args);
+Value builtin_RegexReplace(const std::vector<Value>& args);
+Value builtin_Split(const std::vector<Value>& args);
+
 // Array functions
 Value builtin_Count(const std::vector<Value>& args);
 Value builtin_Push(const std::vector<Value>& args);
 Value builtin_Pop(const std::vector<Value>& args);
 Value builtin_Join(const std::vector<Value>& args);
 
+// Higher-order array functions
+Value builtin_Sort(const std::vector<Value>& args);
+Value builtin_MapArray(const std::vector<Value>& args);
+Value builtin_Filter(const std::vector<Value>& args);
+Value builtin_Reduce(const std::vector<Value>& args);
+Value builtin_Find(const std::vector<Value>& args);
+Value builtin_Unique(const std::vector<Value>& args);
+
+// Memoization
+Value builtin_Memoize(const std::vector<Value>& args);
+Value builtin_MemoStats(const std::vector<Value>& args);
+
+// Hash map and set
+Value builtin_Map(const std::vector<Value>& args);
+Value builtin_Set(const std::vector<Value>& args);
+Value builtin_Has(const std::vector<Value>& args);
+Value builtin_Get(const std::vector<Value>& args);
+Value builtin_Put(const std::vector<Value>& args);
+Value builtin_Delete(const std::vector<Value>& args);
+Value builtin_Keys(const std::vector<Value>& args);
+
+// Tasks and channels
+Value builtin_Spawn(const std::vector<Value>& args);
+Value builtin_Await(const std::vector<Value>& args);
+Value builtin_AwaitAll(const std::vector<Value>& args);
+Value builtin_Channel(const std::vector<Value>& args);
+Value builtin_Send(const std::vector<Value>& args);
+Value builtin_Receive(const std::vector<Value>& args);
+Value builtin_Close(const std::vector<Value>& args);
+Value builtin_ParallelMap(const std::vector<Value>& args);
+Value builtin_ParallelForEach(const std::vector<Value>& args);
+
 // Type conversion
 Value builtin_ToString(const std::vector<Value>& args);
 Value builtin_ToInt(const std::vector<Value>& args);
 Value builtin_ToFloat(const std::vector<Value>& args);
 
+// JSON
+Value builtin_JsonParse(const std::vector<Value>& args);
+Value builtin_JsonStringify(const std::vector<Value>& args);
+Value builtin_JsonStream(const std::vector<Value>& args);
+
 // Device management (placeholders for now)
 Value builtin_Device(const std::vector<Value>& args);
 Value builtin_GetAllDevices(const std::vector<Value>& args);
@@ -46,6 +96,12 @@ Value builtin_GetAllDevices(const std::vector<Value>& args);
 Value builtin_FileExists(const std::vector<Value>& args);
 Value builtin_ReadFile(const std::vector<Value>& args);
 Value builtin_WriteFile(const std::vector<Value>& args);
+Value builtin_Open(const std::vector<Value>& args);
+Value builtin_ReadLine(const std::vector<Value>& args);
+Value builtin_Read(const std::vector<Value>& args);
+Value builtin_Write(const std::vector<Value>& args);
+Value builtin_Flush(const std::vector<Value>& args);
+Value builtin_CsvRows(const std::vector<Value>& args);
 
 // UI Automation
 Value builtin_Tap(const std::vector<Value>& args);
@@ -61,6 +117,9 @@ Value builtin_InstallApp(const std::vector<Value>& args);
 Value builtin_UninstallApp(const std::vector<Value>& args);
 Value builtin_ClearAppData(const std::vector<Value>& args);
 
+// Native extensions
+Value builtin_LoadExtension(const std::vector<Value>& args);
+
 // Device File Operations
 Value builtin_PushFile(const std::vector<Value>& args);
 Value builtin_PullFile(const std::vector<Value>& args);
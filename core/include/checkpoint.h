@@ -0,0 +1,153 @@
+#ifndef ANDROIDSCRIPT_CHECKPOINT_H
+#define ANDROIDSCRIPT_CHECKPOINT_H
+
+#include "value.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+class Environment;
+class Statement;
+
+// Progress file that lets a long run continue after a crash
+// (androidscript --checkpoint / --resume)
+//
+// The interpreter reports safe points: before each top-level statement and
+// at the start of every iteration of a loop reached only through top-level
+// statements and loop bodies (not from inside a function, an if branch or
+// an imported file). Each safe point appends a record with the globals
+// whose encoding changed since the previous one, the loop position and the
+// selected device. Records are checksummed, so a torn last record is
+// ignored, and the log is compacted once it outgrows the live state.
+//
+// Functions, native handles and values containing them are not saved;
+// resuming re-runs the skipped declarations and imports instead.
+class Checkpointer {
+public:
+    // Start a fresh checkpoint file for a script
+    static std::unique_ptr<Checkpointer> create(const std::string& path,
+                                                const std::string& script_path);
+
+    // Load the last complete record of a checkpoint file; the run then
+    // skips ahead to it and keeps appending to the same file. Throws if the
+    // file is unreadable or the script changed since it was written.
+    static std::unique_ptr<Checkpointer> open(const std::string& path);
+
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    const std::string& scriptPath() const { return script_path_; }
+
+    // Globals of the interpreter being checkpointed
+    void attach(std::shared_ptr<Environment> globals);
+
+    // The run completed; the file is no longer needed
+    void finish();
+
+    // Interpreter side. A statement list (the program or a loop body) is
+    // entered and left around its statements; beginStatement returns false
+    // for statements skipped while resuming.
+    void enterList();
+    void leaveList();
+    bool beginStatement(size_t index, Statement* stmt);
+
+private:
+    friend class CheckpointLoop;
+
+    struct Frame {
+        const Statement* statement = nullptr;
+        uint32_t index = 0;
+        bool in_loop = false;
+        uint64_t iteration = 0;   // Index of the current iteration
+        uint64_t started = 0;     // Iterations begun so far
+        Value iterable;           // Array a ForEach walks
+
+        // Array and size the saved copy of the iterable was encoded from
+        const ValueArray* encoded_array = nullptr;
+        size_t encoded_size = 0;
+    };
+
+    std::string path_;
+    std::string script_path_;
+    uint64_t script_hash_ = 0;
+    std::FILE* file_ = nullptr;
+    uint64_t file_bytes_ = 0;
+
+    std::shared_ptr<Environment> globals_;
+    std::vector<Frame> live_;
+
+    // Encoded values as of the last record, by variable name (ForEach
+    // iterables use reserved names)
+    std::map<std::string, std::string> saved_;
+    uint64_t saved_bytes_ = 0;
+    std::string device_;
+
+    // Position being resumed to, if any
+    std::vector<Frame> target_;
+    bool resuming_ = false;
+
+    Checkpointer() = default;
+
+    bool enterLoop(const Statement* loop);
+    void setIterable(const Value& iterable);
+    void beginIteration();
+    void leaveLoop();
+    Value savedIterable() const;
+
+    void restore();
+    void save();
+    void writeRecord(const std::string& payload);
+    void compact();
+    void openForAppend(const char* mode);
+};
+
+// One loop visit as seen by the checkpointer. Inactive (every call a no-op)
+// without a checkpointer or when the loop is not on the safe path.
+class CheckpointLoop {
+public:
+    CheckpointLoop(Checkpointer* checkpointer, const Statement& loop);
+    ~CheckpointLoop();
+
+    CheckpointLoop(const CheckpointLoop&) = delete;
+    CheckpointLoop& operator=(const CheckpointLoop&) = delete;
+
+    bool active() const { return active_; }
+
+    // Resuming: the loop was already running, so its initializer must not
+    // run again; ForEach skips the items already visited
+    bool resuming() const { return resume_iterations_ != kNotResuming; }
+    uint64_t resumeIterations() const { return resuming() ? resume_iterations_ : 0; }
+
+    // Resuming into the body of an interrupted iteration: skip the loop
+    // condition once (it was already checked with the state back then)
+    bool resumesInside() const { return inside_; }
+
+    // ForEach: the iterable to walk (the saved one when resuming). Loops
+    // over anything but an array of saveable values are not checkpointed.
+    Value iterable(const std::function<Value()>& evaluate);
+
+    // Start of an iteration, before the condition is checked
+    void iteration() {
+        if (active_) checkpointer_->beginIteration();
+    }
+
+private:
+    static constexpr uint64_t kNotResuming = ~0ULL;
+
+    Checkpointer* checkpointer_;
+    bool active_;
+    bool inside_;
+    uint64_t resume_iterations_;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_CHECKPOINT_H
@@ -0,0 +1,36 @@
+#ifndef ANDROIDSCRIPT_CLOCK_H
+#define ANDROIDSCRIPT_CLOCK_H
+
+#include <cstdint>
+
+namespace androidscript {
+
+// Time source for Sleep(), Now() and the scheduler's timers
+//
+// In real mode this is the system clock. In virtual mode (--virtual-time)
+// time only moves when the scheduler finds every task waiting on a timer;
+// it then jumps straight to the earliest deadline, so scripts that mostly
+// sleep finish in a fraction of their real duration.
+class Clock {
+public:
+    // Monotonic milliseconds, used for deadlines
+    static int64_t monotonicMs();
+
+    // Milliseconds since the Unix epoch, used by Now()
+    static int64_t epochMs();
+
+    // Switch to virtual time, starting from the current real time. Call
+    // before any script runs.
+    static void enableVirtual();
+    static bool isVirtual();
+
+    // Move virtual time forward (never backwards). No-op in real mode.
+    static void advanceTo(int64_t monotonic_ms);
+
+    // Virtual time that has passed since enableVirtual()
+    static int64_t virtualElapsedMs();
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_CLOCK_H
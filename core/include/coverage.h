@@ -0,0 +1,41 @@
+#ifndef ANDROIDSCRIPT_COVERAGE_H
+#define ANDROIDSCRIPT_COVERAGE_H
+
+#include "execution_hooks.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace androidscript {
+
+// Line coverage of one script (androidscript --coverage). Counts how often
+// each statement of the program it was built from runs; statements of
+// included or imported files are not counted.
+class LineCoverage : public ExecutionHooks {
+public:
+    explicit LineCoverage(const std::vector<std::unique_ptr<Statement>>& program);
+
+    void onStatement(Interpreter& interpreter, Statement& stmt) override;
+
+    // Lines with at least one statement, and how many of them ran
+    size_t linesFound() const;
+    size_t linesHit() const;
+
+    // gcov-style listing: each source line prefixed with its execution
+    // count, "#####" if it never ran or "-" if it has no statement
+    void writeReport(std::ostream& out, const std::string& source) const;
+
+private:
+    std::unordered_map<const Statement*, size_t> index_;
+    std::vector<int> lines_;        // Line of each statement
+    std::vector<uint64_t> counts_;  // Runs of each statement
+
+    // Highest count per line (-1: no statement on it)
+    std::vector<int64_t> lineCounts() const;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_COVERAGE_H
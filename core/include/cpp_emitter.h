@@ -0,0 +1,87 @@
+#ifndef ANDROIDSCRIPT_CPP_EMITTER_H
+#define ANDROIDSCRIPT_CPP_EMITTER_H
+
+#include "ast.h"
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Ahead-of-time translator - walks the AST and emits a C++ translation unit
+//
+// The generated program links against androidscript-core and
+// androidscript-bridge and uses the same Value runtime and builtins as the
+// interpreter (see aot_runtime.h). Variables still live in Environment
+// scopes so behaviour matches; the gain comes from removing AST dispatch,
+// hoisting literals to constants and compiling control flow natively.
+class CppEmitter : public ASTVisitor {
+public:
+    CppEmitter();
+
+    // Translate a parsed program into a complete C++ source file
+    std::string emit(const std::vector<std::unique_ptr<Statement>>& program,
+                     const std::string& source_name);
+
+    // Error reporting
+    const std::vector<std::string>& getErrors() const { return errors_; }
+    bool hasErrors() const { return !errors_.empty(); }
+
+    // Expression visitors
+    void visit(BinaryExpr& expr) override;
+    void visit(UnaryExpr& expr) override;
+    void visit(LiteralExpr& expr) override;
+    void visit(VariableExpr& expr) override;
+    void visit(CallExpr& expr) override;
+    void visit(ArrayExpr& expr) override;
+    void visit(MemberExpr& expr) override;
+    void visit(IndexExpr& expr) override;
+
+    // Statement visitors
+    void visit(ExpressionStmt& stmt) override;
+    void visit(AssignmentStmt& stmt) override;
+    void visit(BlockStmt& stmt) override;
+    void visit(IfStmt& stmt) override;
+    void visit(WhileStmt& stmt) override;
+    void visit(ForStmt& stmt) override;
+    void visit(ForEachStmt& stmt) override;
+    void visit(FunctionStmt& stmt) override;
+    void visit(ReturnStmt& stmt) override;
+    void visit(BreakStmt& stmt) override;
+    void visit(ContinueStmt& stmt) override;
+    void visit(ImportStmt& stmt) override;
+
+private:
+    std::ostringstream constants_;   // Hoisted literal values
+    std::map<std::string, std::string> constant_names_;
+    std::ostringstream functions_;   // Compiled script functions
+    std::ostringstream module_state_; // Include flags and import namespaces
+    std::map<std::string, std::string> module_functions_;  // Path -> C++ name
+    std::vector<std::string> import_stack_;  // Files being emitted, innermost last
+    std::ostringstream* out_;        // Current function body being written
+    std::string expr_;               // Result of the last expression visit
+    std::string env_;                // C++ name of the current scope
+    int indent_;
+    int loop_depth_;
+    int in_function_;
+    int counter_;
+    std::vector<std::string> errors_;
+
+    // Helpers
+    std::string expression(Expression* expr);
+    void statement(Statement* stmt);
+    void line(const std::string& text);
+    std::string newName(const std::string& prefix);
+    std::string newScope();
+    std::string constant(const std::string& initializer);
+    std::string moduleFunction(const std::string& path);
+    void reportError(const std::string& message);
+
+    static std::string quote(const std::string& text);
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_CPP_EMITTER_H
@@ -0,0 +1,50 @@
+#ifndef ANDROIDSCRIPT_CSV_H
+#define ANDROIDSCRIPT_CSV_H
+
+#include "mapped_file.h"
+#include "value.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Rows of a CSV file returned by CsvRows(), one per ForEach iteration
+//
+// The file is memory-mapped and parsed lazily, so memory use does not grow
+// with the number of rows. Fields follow RFC 4180: comma separated, quoted
+// fields may contain commas, line breaks and doubled quotes. Lines end with
+// "\n" or "\r\n"; blank lines are skipped. With a header, rows are objects
+// keyed by column name (missing trailing fields are nil); without one they
+// are arrays of strings.
+class CsvRows : public NativeObject {
+public:
+    // Throws if the file cannot be opened
+    CsvRows(const std::string& path, bool header);
+
+    std::string typeName() const override { return "csv rows"; }
+    bool isIterable() const override { return true; }
+
+    // Throws on malformed quoting or a row longer than the header
+    bool next(Value& item) override;
+
+private:
+    std::mutex mutex_;
+    MappedFile file_;
+    std::string path_;
+    size_t pos_;
+    size_t discarded_;                  // Bytes handed back to the system
+    size_t line_;                       // Line number at pos_
+    size_t record_line_;                // Line the last record started on
+    std::vector<std::string> columns_;
+    bool has_header_;
+    std::vector<std::string> fields_;   // Reused between records
+    size_t field_count_;
+
+    bool readRecord();
+    [[noreturn]] void fail(const std::string& message, size_t line) const;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_CSV_H
@@ -0,0 +1,54 @@
+#ifndef ANDROIDSCRIPT_DEBUGGER_H
+#define ANDROIDSCRIPT_DEBUGGER_H
+
+#include "execution_hooks.h"
+#include <istream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Line debugger for one script (androidscript --debug). Stops before the
+// first statement and at breakpoints, then reads commands from `in`:
+// break/delete N, step, next, finish, continue, print NAME, where, list,
+// quit. Breakpoints apply to the script itself, not to included files.
+class Debugger : public ExecutionHooks {
+public:
+    // Thrown by the quit command; ends the run
+    struct Quit {};
+
+    Debugger(const std::vector<std::unique_ptr<Statement>>& program,
+             const std::string& source, std::istream& in, std::ostream& out);
+
+    void onStatement(Interpreter& interpreter, Statement& stmt) override;
+    void onCall(Interpreter& interpreter, const FunctionObject& fn) override;
+    void onReturn(Interpreter& interpreter, const FunctionObject& fn) override;
+
+private:
+    enum class Mode { Run, Step, Next, Finish };
+
+    std::istream& in_;
+    std::ostream& out_;
+    std::vector<std::string> source_;
+    std::set<const Statement*> own_;              // Statements of the script
+    std::map<int, const Statement*> first_on_line_;
+    std::set<const Statement*> breakpoints_;
+
+    Mode mode_ = Mode::Step;
+    size_t depth_ = 0;       // Script function calls in progress
+    size_t stop_depth_ = 0;  // Depth where next/finish were given
+    std::vector<int> frames_;  // Call-site line of each call in progress
+    int line_ = 0;             // Line of the statement about to run
+    std::string last_command_;
+
+    bool shouldStop(const Statement& stmt) const;
+    void prompt(Interpreter& interpreter, const Statement& stmt);
+    void show(int line, bool own) const;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_DEBUGGER_H
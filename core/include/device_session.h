@@ -0,0 +1,79 @@
+#ifndef ANDROIDSCRIPT_DEVICE_SESSION_H
+#define ANDROIDSCRIPT_DEVICE_SESSION_H
+
+#include "value.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace androidscript {
+
+// One connected Android device. Sessions are cached per serial for the
+// whole process, so model, Android version and screen size are queried once
+// and device values carry their session rather than a serial to look up.
+class DeviceSession : public std::enable_shared_from_this<DeviceSession> {
+public:
+    // Session for a serial (throws if adb does not list it), or for the
+    // first online device when the serial is empty. A cached session is
+    // returned without asking adb unless one of its commands failed since
+    // it was last checked; then adb is asked again and the session dropped
+    // if the device is gone.
+    static std::shared_ptr<DeviceSession> connect(const std::string& serial);
+
+    // Session for a device read back from a checkpoint: the cached one, or
+    // one built from the saved info without asking adb
+    static std::shared_ptr<DeviceSession> attach(const DeviceRef& saved);
+
+    // Sessions for every device adb lists
+    static std::vector<std::shared_ptr<DeviceSession>> connectAll();
+
+    const DeviceRef& info() const { return info_; }
+    const std::string& serial() const { return info_.serial; }
+
+    // Script value for this device
+    Value value();
+
+    // $device.Name(...): the automation builtin Name bound to this device,
+    // or nil if there is no such method. Built once per session and name.
+    Value method(const std::string& name);
+
+    // Automation commands, taking the arguments of the matching builtins
+    Value tap(const std::vector<Value>& args);
+    Value swipe(const std::vector<Value>& args);
+    Value input(const std::vector<Value>& args);
+    Value screenshot(const std::vector<Value>& args);
+    Value keyEvent(const std::vector<Value>& args);
+    Value launchApp(const std::vector<Value>& args);
+    Value stopApp(const std::vector<Value>& args);
+    Value installApp(const std::vector<Value>& args);
+    Value uninstallApp(const std::vector<Value>& args);
+    Value clearAppData(const std::vector<Value>& args);
+    Value pushFile(const std::vector<Value>& args);
+    Value pullFile(const std::vector<Value>& args);
+
+private:
+    explicit DeviceSession(DeviceRef info) : info_(std::move(info)) {}
+
+    static std::shared_ptr<DeviceSession> cached(const std::string& serial);
+
+    template <typename AdbCall>
+    void run(const char* command, AdbCall&& call);
+
+    DeviceRef info_;
+    std::atomic<bool> stale_{false};
+    std::mutex mutex_;
+    std::unordered_map<std::string, Value> methods_;
+};
+
+// Device chosen with Device() by the running interpreter, or by the calling
+// thread when no interpreter is running (top-level AOT-compiled code).
+// Null until one is selected.
+std::shared_ptr<DeviceSession> selectedDevice();
+void selectDevice(std::shared_ptr<DeviceSession> device);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_DEVICE_SESSION_H
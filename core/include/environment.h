@@ -24,9 +24,19 @@ public:
     void assign(const std::string& name, const Value& value);
     bool exists(const std::string& name) const;
 
-    // Scope management
+    // Scope management. A script's global scope is the root, or the child
+    // of a frozen environment (the shared builtins).
     std::shared_ptr<Environment> getParent() const { return parent_; }
-    bool isGlobal() const { return parent_ == nullptr; }
+    bool isGlobal() const { return parent_ == nullptr || parent_->frozen_; }
+
+    // Make this scope read-only so threads can share it: define() throws,
+    // and assign() from a child scope creates the variable in the global
+    // scope below it instead
+    void freeze() { frozen_ = true; }
+    bool isFrozen() const { return frozen_; }
+
+    // Variables defined directly in this scope
+    const std::map<std::string, Value>& variables() const { return values_; }
 
     // Clear all variables (for reset/cleanup)
     void clear();
@@ -34,6 +44,7 @@ public:
 private:
     std::map<std::string, Value> values_;
     std::shared_ptr<Environment> parent_;
+    bool frozen_ = false;
 };
 
 // Exception for undefined variables
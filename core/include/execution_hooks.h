@@ -0,0 +1,47 @@
+#ifndef ANDROIDSCRIPT_EXECUTION_HOOKS_H
+#define ANDROIDSCRIPT_EXECUTION_HOOKS_H
+
+#include "ast.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+class Interpreter;
+struct FunctionObject;
+
+// Observer of a running interpreter: debuggers, coverage, profiling
+// (Interpreter::setHooks). While nothing is attached (and tracing and
+// allocation tracking are off), statement and call boundaries only test one
+// flag of the interpreter.
+// Tasks started with Spawn or ParallelMap run unobserved.
+class ExecutionHooks {
+public:
+    virtual ~ExecutionHooks() = default;
+
+    // Before a statement that has a source line runs (not blocks)
+    virtual void onStatement(Interpreter& /* interpreter */, Statement& /* stmt */) {}
+
+    // Around a call of a script function; onReturn also runs when the call
+    // throws. AOT-compiled functions are not reported.
+    virtual void onCall(Interpreter& /* interpreter */, const FunctionObject& /* fn */) {}
+    virtual void onReturn(Interpreter& /* interpreter */, const FunctionObject& /* fn */) {}
+
+    // Around a call expression whose callee is a builtin or other native
+    // function (natives called by natives are not reported)
+    virtual void onNativeCall(Interpreter& /* interpreter */, const CallExpr& /* call */) {}
+    virtual void onNativeReturn(Interpreter& /* interpreter */, const CallExpr& /* call */) {}
+};
+
+// Every statement of a program that has a source line, in source order,
+// including those nested in blocks, loops and function bodies
+std::vector<const Statement*> collectStatements(
+    const std::vector<std::unique_ptr<Statement>>& program);
+
+// Callee of a call as written at the call site: Tap(...) or $device.Tap(...)
+const std::string& calleeName(const CallExpr& call);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_EXECUTION_HOOKS_H
@@ -0,0 +1,85 @@
+#ifndef ANDROIDSCRIPT_EXTENSION_API_H
+#define ANDROIDSCRIPT_EXTENSION_API_H
+
+// Stable C ABI for native AndroidScript extensions
+//
+// An extension is a shared library loaded at runtime with
+// LoadExtension("libfoo.so"). It exports one entry point,
+// androidscript_extension_init(), which registers native functions through
+// the host API table. Values never cross the boundary as C++ objects: the
+// extension reads arguments and writes its result through the accessors
+// below, so extensions can be built with any C or C++ compiler.
+//
+// Compatibility rules: fields are only ever appended to as_host_api, and
+// abi_version is bumped when that happens. Extensions should check
+// host->abi_version >= the version they were built against.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANDROIDSCRIPT_EXTENSION_ABI_VERSION 1
+
+#if defined(_WIN32)
+#define ANDROIDSCRIPT_EXTENSION_EXPORT __declspec(dllexport)
+#else
+#define ANDROIDSCRIPT_EXTENSION_EXPORT __attribute__((visibility("default")))
+#endif
+
+// Argument types as seen by extensions
+typedef enum as_type {
+    AS_TYPE_NIL = 0,
+    AS_TYPE_BOOL = 1,
+    AS_TYPE_INT = 2,
+    AS_TYPE_FLOAT = 3,
+    AS_TYPE_STRING = 4,
+    AS_TYPE_OTHER = 5   // Arrays, objects, devices, ... (opaque for now)
+} as_type;
+
+typedef struct as_call as_call;          // One native call in progress
+typedef struct as_registry as_registry;  // Registration context during init
+
+// Native function signature. Read arguments and set the result through the
+// host API; leaving the result unset returns null.
+typedef void (*as_native_fn)(as_call* call, void* userdata);
+
+typedef struct as_host_api {
+    uint32_t abi_version;
+    uint32_t struct_size;
+
+    // Registration (only valid during androidscript_extension_init)
+    int (*register_function)(as_registry* registry, const char* name,
+                             as_native_fn fn, void* userdata);
+
+    // Arguments
+    size_t (*arg_count)(const as_call* call);
+    as_type (*arg_type)(const as_call* call, size_t index);
+    int (*arg_bool)(const as_call* call, size_t index);
+    int64_t (*arg_int)(const as_call* call, size_t index);
+    double (*arg_float)(const as_call* call, size_t index);
+    const char* (*arg_string)(const as_call* call, size_t index, size_t* length);
+
+    // Result
+    void (*return_nil)(as_call* call);
+    void (*return_bool)(as_call* call, int value);
+    void (*return_int)(as_call* call, int64_t value);
+    void (*return_float)(as_call* call, double value);
+    void (*return_string)(as_call* call, const char* data, size_t length);
+
+    // Raise a script runtime error; the result is ignored
+    void (*raise_error)(as_call* call, const char* message);
+} as_host_api;
+
+// Entry point every extension must export. Return 0 on success.
+typedef int (*as_extension_init_fn)(const as_host_api* host, as_registry* registry);
+
+#define ANDROIDSCRIPT_EXTENSION_INIT_SYMBOL "androidscript_extension_init"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANDROIDSCRIPT_EXTENSION_API_H
@@ -0,0 +1,18 @@
+#ifndef ANDROIDSCRIPT_EXTENSION_LOADER_H
+#define ANDROIDSCRIPT_EXTENSION_LOADER_H
+
+#include "environment.h"
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Load a native extension (see extension_api.h) and define its functions in
+// env. Libraries stay loaded for the life of the process; loading the same
+// path again reuses the already-registered functions without re-running the
+// extension's init. Returns the names of the functions defined.
+std::vector<std::string> loadExtension(const std::string& path, Environment& env);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_EXTENSION_LOADER_H
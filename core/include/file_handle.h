@@ -0,0 +1,59 @@
+#ifndef ANDROIDSCRIPT_FILE_HANDLE_H
+#define ANDROIDSCRIPT_FILE_HANDLE_H
+
+#include "value.h"
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Buffered local file returned by Open()
+//
+// Wraps a stdio stream with a large userspace buffer, so per-line reads and
+// appends cost a memcpy instead of a system call. The file is closed by
+// Close() or when the last reference to the handle goes away. Iterating a
+// handle with ForEach yields its remaining lines.
+class FileHandle : public NativeObject {
+public:
+    // mode is "r", "w", "a", "r+", "w+" or "a+" as for fopen(); throws if
+    // the mode is invalid or the file cannot be opened
+    FileHandle(const std::string& path, const std::string& mode);
+    ~FileHandle() override;
+
+    std::string typeName() const override { return "file"; }
+    bool isIterable() const override { return true; }
+    bool next(Value& item) override;
+
+    // Next line without its "\n" or "\r\n"; false at end of file
+    bool readLine(std::string& line);
+
+    // Up to count bytes; count == 0 reads the rest of the file. False when
+    // nothing was left to read.
+    bool read(size_t count, std::string& out);
+
+    void write(std::string_view data);
+    void flush();
+
+    // Flushes and closes; further calls except close() throw
+    void close();
+
+private:
+    enum class LastOp { NONE, READ, WRITE };
+
+    std::mutex mutex_;
+    std::FILE* file_;
+    std::string path_;
+    std::vector<char> buffer_;
+    bool readable_;
+    bool writable_;
+    LastOp last_op_;
+
+    std::FILE* stream(LastOp op);
+    void closeLocked();
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_FILE_HANDLE_H
@@ -0,0 +1,76 @@
+#ifndef ANDROIDSCRIPT_HASH_TABLE_H
+#define ANDROIDSCRIPT_HASH_TABLE_H
+
+#include "value.h"
+#include <cstdint>
+#include <vector>
+
+namespace androidscript {
+
+// Exact key comparison used by hash tables. Unlike Value::operator== this
+// never uses an epsilon for floats, so it is consistent with Value::hash().
+bool valueKeyEquals(const Value& a, const Value& b);
+
+// Open-addressing hash table keyed by Value (backs Map() and Set())
+//
+// Linear probing over a power-of-two slot array. Probing walks a compact
+// array of cached key hashes and only touches the (large) key/value entry
+// when the hashes match. Deleted slots are marked with a tombstone and
+// reclaimed on the next rehash.
+class ValueHashTable {
+public:
+    ValueHashTable();
+
+    // Lookup
+    bool contains(const Value& key) const;
+    const Value* find(const Value& key) const;
+    Value* find(const Value& key);
+
+    // Insert or overwrite; returns true if the key was new
+    bool put(const Value& key, const Value& value);
+
+    // Remove; returns true if the key was present
+    bool remove(const Value& key);
+
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Iteration over live entries (slot order, not insertion order)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < hashes_.size(); ++i) {
+            if (hashes_[i] >= kFirstHash) {
+                fn(entries_[i].key, entries_[i].value);
+            }
+        }
+    }
+
+    ValueArray keys() const;
+
+private:
+    // Reserved hash values marking empty and deleted slots
+    static constexpr uint64_t kEmpty = 0;
+    static constexpr uint64_t kTombstone = 1;
+    static constexpr uint64_t kFirstHash = 2;
+
+    struct Entry {
+        Value key;
+        Value value;
+    };
+
+    std::vector<uint64_t> hashes_;  // Per-slot hash, kEmpty or kTombstone
+    std::vector<Entry> entries_;
+    size_t size_;   // Live entries
+    size_t used_;   // Live entries + tombstones
+
+    static uint64_t slotHash(const Value& key);
+    size_t findSlot(const Value& key, uint64_t hash) const;
+    void rehash(size_t capacity);
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_HASH_TABLE_H
@@ -4,12 +4,20 @@
 #include "ast.h"
 #include "value.h"
 #include "environment.h"
+#include <atomic>
+#include <map>
 #include <memory>
+#include <set>
+#include <typeinfo>
 #include <vector>
 #include <string>
 
 namespace androidscript {
 
+class Checkpointer;
+class DeviceSession;
+class ExecutionHooks;
+
 // Control flow exceptions
 class ReturnException : public std::exception {
 public:
@@ -26,8 +34,13 @@ class ContinueException : public std::exception {};
 class Interpreter : public ASTVisitor {
 public:
     Interpreter();
+    explicit Interpreter(std::shared_ptr<Environment> globals);
     ~Interpreter() override = default;
 
+    // Interpreter running on the calling thread or scheduler task, if any.
+    // Lets native functions call back into script code.
+    static Interpreter* current();
+
     // Execute a list of statements
     void execute(const std::vector<std::unique_ptr<Statement>>& statements);
 
@@ -40,6 +53,52 @@ public:
     // Get global environment (for registering built-ins)
     std::shared_ptr<Environment> getGlobalEnvironment() { return global_; }
 
+    // Forget everything a run left behind: globals start over as an empty
+    // scope on the same parent (the shared builtins for pooled interpreters),
+    // and errors, imports, the checkpointer, device and hooks are dropped. Closures from the
+    // previous run keep the old scope alive rather than seeing the new one.
+    void reset();
+
+    // File being run; #include and #import resolve relative to it and it
+    // counts as already loaded for cycle checks
+    void setScriptPath(const std::string& path);
+
+    // Record safe points to (and resume from) a checkpoint file while
+    // running the top-level program. The first runtime error then stops the
+    // run, so the checkpoint stays at the failing iteration.
+    void setCheckpointer(Checkpointer* checkpointer);
+
+    // Debugger, coverage or tracer to notify of statements and calls (null
+    // detaches). Not owned; also dropped by reset().
+    void setHooks(ExecutionHooks* hooks) {
+        hooks_ = hooks;
+        updateInstrumented();
+    }
+    ExecutionHooks* hooks() const { return hooks_; }
+
+    // Scope of the statement being run (function locals while in a call)
+    std::shared_ptr<Environment> getEnvironment() { return environment_; }
+
+    // Device chosen with Device(); automation builtins act on it. Tasks
+    // spawned from this interpreter start out with the same device.
+    const std::shared_ptr<DeviceSession>& device() const { return device_; }
+    void setDevice(std::shared_ptr<DeviceSession> device) { device_ = std::move(device); }
+
+    // For the allocation profiler (androidscript-allocprof): while on,
+    // every interpreter keeps track of the innermost AST node it is running
+    // and the builtin it is calling, if any
+    static void setAllocationTracking(bool on) { track_allocations_ = on; }
+    static bool allocationTracking() { return track_allocations_.load(std::memory_order_relaxed); }
+    const std::type_info* currentNode() const { return current_node_; }
+    const std::string* currentBuiltin() const { return current_builtin_; }
+
+    // Call a script or native function
+    Value callFunction(const Value& callee, const std::vector<Value>& args);
+
+    // Member and index access (shared with AOT-compiled scripts)
+    static Value getMember(const Value& object, const std::string& member);
+    static Value getIndex(const Value& object, const Value& index);
+
     // Error handling
     const std::vector<std::string>& getErrors() const { return errors_; }
     bool hasErrors() const { return !errors_.empty(); }
@@ -66,6 +125,7 @@ public:
     void visit(ReturnStmt& stmt) override;
     void visit(BreakStmt& stmt) override;
     void visit(ContinueStmt& stmt) override;
+    void visit(ImportStmt& stmt) override;
 
 private:
     std::shared_ptr<Environment> global_;
@@ -73,10 +133,37 @@ private:
     Value last_value_;  // Last evaluated expression value
     std::vector<std::string> errors_;
 
+    // Modules: files whose imports are being run (innermost last), files
+    // already included into each top-level scope, and imported files. The
+    // scopes of imported modules are kept so included_ keys stay valid.
+    struct ImportedModule {
+        std::shared_ptr<Environment> scope;
+        Value exports;
+    };
+    std::vector<std::string> import_stack_;
+    std::set<std::pair<const Environment*, std::string>> included_;
+    std::map<std::string, ImportedModule> modules_;
+
+    Checkpointer* checkpoint_ = nullptr;
+    std::shared_ptr<DeviceSession> device_;
+    ExecutionHooks* hooks_ = nullptr;
+
+    // Hooks attached, tracing or allocation tracking on. Worked out when a
+    // run starts and when hooks change, so statements, expressions and calls
+    // test this one plain flag and do nothing more while it is off.
+    bool instrumented_ = false;
+    void updateInstrumented();
+
+    static inline std::atomic<bool> track_allocations_{false};
+    const std::type_info* current_node_ = nullptr;
+    const std::string* current_builtin_ = nullptr;
+
     // Helpers
+    void runModule(const std::string& path, std::shared_ptr<Environment> env);
     void executeBlock(const std::vector<std::unique_ptr<Statement>>& statements,
                      std::shared_ptr<Environment> env);
-    Value callFunction(const Value& callee, const std::vector<Value>& args);
+    void executeCheckpointed(const std::vector<std::unique_ptr<Statement>>& statements);
+    void executeLoopBody(Statement* body, bool safe);
     void reportError(const std::string& message);
 };
 
@@ -0,0 +1,63 @@
+#ifndef ANDROIDSCRIPT_INTERPRETER_POOL_H
+#define ANDROIDSCRIPT_INTERPRETER_POOL_H
+
+#include "interpreter.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace androidscript {
+
+// Ready-to-run interpreters for executing many scripts (test cases) in turn
+//
+// Every interpreter's globals are an empty scope on top of sharedBuiltins(),
+// so making one allocates a single map instead of registering every builtin
+// again, and all of them share one copy of the builtins. A returned
+// interpreter is reset before it is handed out again, which costs only the
+// globals the last script defined. Safe to use from several threads; the
+// pool must outlive its leases.
+class InterpreterPool {
+public:
+    // Interpreter lent to one run; goes back to the pool when destroyed
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Interpreter& operator*() const { return *interpreter_; }
+        Interpreter* operator->() const { return interpreter_.get(); }
+
+    private:
+        friend class InterpreterPool;
+        Lease(InterpreterPool* pool, std::unique_ptr<Interpreter> interpreter);
+
+        InterpreterPool* pool_;
+        std::unique_ptr<Interpreter> interpreter_;
+    };
+
+    // prewarm: interpreters to build up front
+    explicit InterpreterPool(size_t prewarm = 0);
+
+    InterpreterPool(const InterpreterPool&) = delete;
+    InterpreterPool& operator=(const InterpreterPool&) = delete;
+
+    Lease acquire();
+
+    // Interpreters waiting to be reused
+    size_t idleCount() const;
+
+    // A fresh interpreter whose globals sit on the shared builtins
+    static std::unique_ptr<Interpreter> create();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Interpreter>> idle_;
+
+    void release(std::unique_ptr<Interpreter> interpreter);
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_INTERPRETER_POOL_H
@@ -0,0 +1,57 @@
+#ifndef ANDROIDSCRIPT_JSON_H
+#define ANDROIDSCRIPT_JSON_H
+
+#include "value.h"
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace androidscript {
+
+// JSON <-> Value
+//
+// Objects become objects, arrays arrays; numbers without a fraction or
+// exponent that fit in 64 bits become integers, others floats. Parsing is a
+// single pass over the text with string bodies scanned by the vectorized
+// findJsonSpecial() kernel.
+
+// Throws std::runtime_error naming the byte offset of malformed input
+Value parseJson(std::string_view text);
+
+// indent > 0 pretty-prints with that many spaces per level. Maps become
+// objects (keys converted to strings) and sets arrays; functions, devices
+// and native objects cannot be converted.
+std::string stringifyJson(const Value& value, int indent = 0);
+
+// Elements of a top-level JSON array read from a file one at a time, so
+// arrays far larger than memory can be walked with ForEach. Memory use is
+// bounded by the read buffer plus the largest single element.
+class JsonStream : public NativeObject {
+public:
+    // Throws if the file cannot be opened
+    explicit JsonStream(const std::string& path);
+
+    std::string typeName() const override { return "json stream"; }
+    bool isIterable() const override { return true; }
+
+    // Parse the next element; false after the closing ']'
+    bool next(Value& item) override;
+
+private:
+    std::ifstream file_;
+    std::string path_;
+    std::string buffer_;
+    size_t pos_;            // Next unread byte in buffer_
+    size_t offset_;         // File offset of buffer_[0], for error messages
+    bool started_;
+    bool finished_;
+
+    bool fill();
+    bool skipWhitespace();
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_JSON_H
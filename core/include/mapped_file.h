@@ -0,0 +1,38 @@
+#ifndef ANDROIDSCRIPT_MAPPED_FILE_H
+#define ANDROIDSCRIPT_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace androidscript {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view data() const { return std::string_view(data_, size_); }
+    size_t size() const { return size_; }
+
+    // Hint that bytes before offset will not be read again, so their pages
+    // can leave the resident set of a sequential reader
+    void discardBefore(size_t offset);
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t discarded_;
+#ifdef _WIN32
+    void* mapping_;
+#endif
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_MAPPED_FILE_H
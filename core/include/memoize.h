@@ -0,0 +1,74 @@
+#ifndef ANDROIDSCRIPT_MEMOIZE_H
+#define ANDROIDSCRIPT_MEMOIZE_H
+
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace androidscript {
+
+// Bounded cache of a function's results keyed by its arguments (Memoize)
+//
+// Arguments compare structurally: arrays and objects by content, everything
+// else as Map() keys do (maps, sets, functions and handles by identity).
+// Keys and results are snapshotted on insert and results copied again on
+// each hit, so changing an array after the call does not change what is
+// stored. When full, the least recently used entry is
+// evicted. Safe to share between threads.
+class MemoCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t capacity = 0;
+    };
+
+    explicit MemoCache(size_t capacity);
+
+    MemoCache(const MemoCache&) = delete;
+    MemoCache& operator=(const MemoCache&) = delete;
+
+    // Copy of the stored result for these arguments; counts a hit or a miss
+    bool find(const std::vector<Value>& args, Value& result);
+
+    // Remember a result, evicting the least recently used entry if full
+    void insert(const std::vector<Value>& args, const Value& result);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::vector<Value> args;
+        uint64_t hash;
+        Value result;
+    };
+    using EntryList = std::list<Entry>;  // Most recently used first
+
+    // Points at the arguments of a lookup or of a stored entry
+    struct KeyRef {
+        const std::vector<Value>* args;
+        uint64_t hash;
+    };
+    struct KeyHash {
+        size_t operator()(const KeyRef& key) const { return static_cast<size_t>(key.hash); }
+    };
+    struct KeyEquals {
+        bool operator()(const KeyRef& a, const KeyRef& b) const;
+    };
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    EntryList entries_;
+    std::unordered_map<KeyRef, EntryList::iterator, KeyHash, KeyEquals> index_;
+    Stats stats_;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_MEMOIZE_H
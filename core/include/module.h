@@ -0,0 +1,60 @@
+#ifndef ANDROIDSCRIPT_MODULE_H
+#define ANDROIDSCRIPT_MODULE_H
+
+#include "ast.h"
+#include "environment.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Script files loaded with #include and #import
+//
+// Each file is read and parsed once per process and its AST kept for the
+// life of the process (script functions point into it), so every
+// interpreter and task that imports it shares the same tree.
+
+struct Module {
+    std::string path;  // Canonical path
+    std::vector<std::unique_ptr<Statement>> program;
+};
+
+class ModuleCache {
+public:
+    static ModuleCache& instance();
+
+    // Canonical path of name, relative to from_dir unless absolute (or to
+    // the working directory when from_dir is empty). Throws if there is no
+    // such file.
+    static std::string resolve(const std::string& name, const std::string& from_dir);
+
+    // Parsed module for a canonical path; throws with the lexer or parser
+    // errors of a malformed file
+    std::shared_ptr<const Module> load(const std::string& path);
+
+private:
+    ModuleCache() = default;
+
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<const Module>> modules_;
+};
+
+// Top-level scope for an imported module: a fresh global scope over the
+// shared builtins (when globals has them) holding the other native functions
+// visible in globals, so module variables never leak into the importer
+std::shared_ptr<Environment> makeModuleScope(const std::shared_ptr<Environment>& globals);
+
+// Namespace object bound by #import: the module's top-level definitions,
+// without the natives makeModuleScope() copied in
+Value moduleExports(const Environment& scope, const Environment& globals);
+
+// Name #import binds when no alias is given: the file name without its
+// extension, with characters that cannot appear in identifiers replaced
+std::string defaultModuleName(const std::string& path);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_MODULE_H
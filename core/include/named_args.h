@@ -0,0 +1,46 @@
+#ifndef ANDROIDSCRIPT_NAMED_ARGS_H
+#define ANDROIDSCRIPT_NAMED_ARGS_H
+
+#include "value.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Named arguments of one call site, e.g. Swipe(100, 200, x2: 300, y2: 400)
+//
+// Which parameter each name stands for is resolved against the callee's
+// parameter list (script functions) or declared signature (natives) the
+// first time the site calls it, then cached on the site. Later calls to the
+// same function only move values into positional slots. Parameter names
+// match with or without the leading '$'. Natives may skip parameters, which
+// are passed as nil; script functions must receive every parameter.
+class NamedArgCache {
+public:
+    // positional: number of arguments before the named ones
+    NamedArgCache(std::vector<std::string> names, size_t positional, std::string callee_name);
+
+    // args holds the positional arguments followed by the named ones in
+    // source order; returns them in parameter order. Throws for unknown,
+    // repeated or missing parameters.
+    std::vector<Value> bind(const Value& callee, std::vector<Value>&& args) const;
+
+private:
+    struct Binding;
+
+    std::vector<std::string> names_;
+    size_t positional_;
+    std::string callee_name_;  // For error messages; may be empty
+
+    // Shared by every thread running this call site; replaced whole with
+    // std::atomic_store when a different function is called
+    mutable std::shared_ptr<const Binding> binding_;
+
+    std::shared_ptr<const Binding> resolve(const Value& callee) const;
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_NAMED_ARGS_H
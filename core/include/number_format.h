@@ -0,0 +1,36 @@
+#ifndef ANDROIDSCRIPT_NUMBER_FORMAT_H
+#define ANDROIDSCRIPT_NUMBER_FORMAT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace androidscript {
+
+// Number <-> text conversion for Value, the Lexer and builtins
+//
+// Built on std::to_chars/std::from_chars: locale-independent, no stream or
+// exception overhead. Floats are written as the shortest text that parses
+// back to exactly the same double.
+
+void appendInt(std::string& out, int64_t value);
+void appendFloat(std::string& out, double value);
+
+std::string formatInt(int64_t value);
+std::string formatFloat(double value);
+
+// Parse all of text (no whitespace, sign is '-' only). Returns false on
+// empty input, trailing characters or overflow.
+bool parseInt(std::string_view text, int64_t& out);
+bool parseFloat(std::string_view text, double& out);
+
+// Parse a number at the start of text the way strtoll/strtod do: leading
+// whitespace and a '+' sign are skipped and parsing stops at the first
+// character that does not fit. Returns false if no number was found or it
+// is out of range.
+bool parseIntPrefix(std::string_view text, int64_t& out);
+bool parseFloatPrefix(std::string_view text, double& out);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_NUMBER_FORMAT_H
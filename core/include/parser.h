@@ -40,6 +40,7 @@ private:
     std::unique_ptr<Statement> continueStatement();
     std::unique_ptr<Statement> blockStatement();
     std::unique_ptr<Statement> tryStatement();
+    std::unique_ptr<Statement> directiveStatement();
 
     // Expression parsing (operator precedence)
     std::unique_ptr<Expression> expression();
@@ -54,13 +55,14 @@ private:
     std::unique_ptr<Expression> primary();
 
     // Helpers
-    Token advance();
-    Token peek() const;
-    Token previous() const;
+    std::unique_ptr<Statement> at(int line, std::unique_ptr<Statement> stmt);
+    const Token& advance();
+    const Token& peek() const;
+    const Token& previous() const;
     bool check(TokenType type) const;
     bool match(TokenType type);
     bool match(const std::vector<TokenType>& types);
-    Token consume(TokenType type, const std::string& message);
+    const Token& consume(TokenType type, const std::string& message);
     bool isAtEnd() const;
 
     // Error handling
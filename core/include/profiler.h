@@ -0,0 +1,86 @@
+#ifndef ANDROIDSCRIPT_PROFILER_H
+#define ANDROIDSCRIPT_PROFILER_H
+
+#include "execution_hooks.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace androidscript {
+
+// Sampling profiler (androidscript --profile=out.folded)
+//
+// The hooks keep a shadow stack of the script's top level, script function
+// calls (each with the line it is running) and builtin calls, plus an
+// "adb spawn" or "adb wait" frame while an adb command runs. A sampler
+// thread copies the stack at a fixed interval. The samples are written as
+// folded stacks for flamegraph.pl. A sample taken while a frame is being
+// pushed or popped may show the stack just before or after the change.
+class SamplingProfiler : public ExecutionHooks {
+public:
+    explicit SamplingProfiler(const std::string& script_name,
+                              std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    ~SamplingProfiler() override;
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    // Sample the interpreter the hooks are attached to. Call start() on the
+    // thread that runs it, so adb commands on that thread are attributed.
+    void start();
+    void stop();
+
+    // Results, once stopped
+    uint64_t samples() const { return samples_; }
+    void writeFolded(std::ostream& out) const;
+
+    void onStatement(Interpreter& interpreter, Statement& stmt) override;
+    void onCall(Interpreter& interpreter, const FunctionObject& fn) override;
+    void onReturn(Interpreter& interpreter, const FunctionObject& fn) override;
+    void onNativeCall(Interpreter& interpreter, const CallExpr& call) override;
+    void onNativeReturn(Interpreter& interpreter, const CallExpr& call) override;
+
+private:
+    static constexpr size_t kMaxDepth = 256;  // Deeper frames are not sampled
+
+    struct Frame {
+        std::atomic<uint32_t> name{0};
+        std::atomic<int32_t> line{0};  // 0: no line (builtins, adb)
+    };
+
+    std::chrono::microseconds interval_;
+
+    // Written by the interpreter thread, read by the sampler
+    std::array<Frame, kMaxDepth> frames_;
+    std::atomic<size_t> depth_{1};  // Frame 0 is the script's top level
+    bool in_phase_ = false;         // Top frame is an adb phase
+
+    // Frame names, interned by the AST node or literal they come from
+    std::unordered_map<const void*, uint32_t> ids_;
+    std::vector<std::string> names_;
+    mutable std::mutex names_mutex_;
+
+    // Sampler thread
+    std::thread sampler_;
+    std::atomic<bool> running_{false};
+    std::map<std::vector<uint64_t>, uint64_t> stacks_;
+    uint64_t samples_ = 0;
+
+    uint32_t intern(const void* key, const std::string& name);
+    void push(uint32_t name);
+    void pop();
+    void sample(std::vector<uint64_t>& stack);
+    static void onPhase(const char* phase);
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_PROFILER_H
@@ -0,0 +1,53 @@
+#ifndef ANDROIDSCRIPT_REGEX_H
+#define ANDROIDSCRIPT_REGEX_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace androidscript {
+
+struct RegexProgram;
+
+// Regular expressions for Match/MatchAll/RegexReplace/Split
+//
+// Patterns compile to a small NFA program run by a Pike VM: every possible
+// match is followed in lockstep, so matching is linear in the text (times
+// the pattern size) and no pattern can backtrack catastrophically. The
+// leftmost match wins; among matches starting there, the first alternative
+// and greedy/lazy quantifiers decide, as in Perl.
+//
+// Syntax: literals, ., [...] classes with ranges and negation, \d \w \s
+// (and \D \W \S), \b \B, ^ $, (...) groups, (?:...), |, * + ? {m} {m,}
+// {m,n} and their lazy forms. Flags (?i) (?m) (?s) may lead the pattern.
+class Regex {
+public:
+    static constexpr size_t kNoGroup = static_cast<size_t>(-1);
+
+    // Throws std::runtime_error for a malformed pattern
+    explicit Regex(const std::string& pattern);
+    ~Regex();
+
+    Regex(const Regex&) = delete;
+    Regex& operator=(const Regex&) = delete;
+
+    // Compiled pattern from a process-wide cache keyed by source text
+    static std::shared_ptr<const Regex> compile(const std::string& pattern);
+
+    // Number of capturing groups, not counting the whole match
+    size_t groupCount() const;
+
+    // Find the leftmost match starting at or after from. On success groups
+    // holds start/end offsets for the whole match and then each group, or
+    // kNoGroup for groups that did not take part.
+    bool search(std::string_view text, size_t from, std::vector<size_t>& groups) const;
+
+private:
+    std::unique_ptr<RegexProgram> program_;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_REGEX_H
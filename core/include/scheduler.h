@@ -0,0 +1,110 @@
+#ifndef ANDROIDSCRIPT_SCHEDULER_H
+#define ANDROIDSCRIPT_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace androidscript {
+
+// Cooperative scheduler that multiplexes many scripts on a few OS threads
+//
+// Each task runs as a stackful coroutine pinned to one worker thread. When
+// a task calls Sleep() or waits on adb output it is parked (in the worker's
+// timer wheel or its poll set) and the worker runs other tasks, so a farm
+// of scripts that mostly sleep needs only a handful of threads.
+//
+// The static helpers are safe to call from anywhere: outside a scheduler
+// task they simply block the calling thread.
+class Scheduler {
+public:
+    // workers == 0 picks the number of hardware threads
+    explicit Scheduler(size_t workers = 0);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Queue a task. May be called before run() or from a running task.
+    void spawn(std::function<void()> task);
+
+    // Run until every task (including ones spawned while running) is done
+    void run();
+
+    // Start the workers in the background; they keep running until the
+    // scheduler is destroyed
+    void start();
+
+    // Block the calling thread until no tasks are left (not from a task)
+    void waitIdle();
+
+    // Scheduler running the calling task, or nullptr on a plain thread
+    static Scheduler* current();
+
+    // Process-wide background scheduler, started on first use
+    static Scheduler& shared();
+
+    // waitIdle() on the shared scheduler if it was ever started
+    static void drainShared();
+
+    size_t workerCount() const { return workers_.size(); }
+
+    // Cooperative blocking points
+    static bool inTask();
+    static void sleepFor(std::chrono::milliseconds duration);
+    static void waitReadable(int fd);
+    static void yield();
+
+    // One pointer of per-task storage (used for the running Interpreter).
+    // Saved with the task across context switches; per thread outside tasks.
+    static void*& taskLocal();
+
+    struct Worker;
+    struct Task;
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_;
+    std::atomic<size_t> live_tasks_;
+    std::atomic<bool> running_;
+    std::atomic<bool> exit_when_idle_;
+    std::atomic<bool> stopping_;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+
+    friend struct Worker;
+    void startWorkers(bool exit_when_idle);
+    void taskFinished();
+};
+
+// Wait list usable from scheduler tasks and plain threads alike. A waiting
+// task is parked so its worker keeps running other tasks; a plain thread
+// blocks on a condition variable.
+class WaitQueue {
+public:
+    WaitQueue() : waiters_(0) {}
+
+    // Block until ready() returns true. ready() may have side effects (e.g.
+    // a try-pop) and is re-run after every notification.
+    void waitUntil(const std::function<bool()>& ready);
+
+    // Wake every waiter so it re-checks its condition. Cheap when nobody
+    // is waiting.
+    void notifyAll();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::pair<Scheduler::Worker*, Scheduler::Task*>> parked_;
+    std::atomic<size_t> waiters_;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_SCHEDULER_H
@@ -0,0 +1,50 @@
+#ifndef ANDROIDSCRIPT_STRING_KERNELS_H
+#define ANDROIDSCRIPT_STRING_KERNELS_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace androidscript {
+
+// Byte-string kernels behind the string builtins
+//
+// On x86 the search and case-mapping loops use SSE2, switching to AVX2 at
+// startup when the CPU has it; other targets use scalar code. Everything
+// works on raw bytes: case mapping only touches ASCII letters, so UTF-8
+// text passes through unchanged.
+
+constexpr size_t kNotFound = std::string_view::npos;
+
+// Position of the first needle at or after from, or kNotFound. An empty
+// needle matches at from.
+size_t findSubstring(std::string_view haystack, std::string_view needle, size_t from = 0);
+
+// Position of the earliest match of any needle, or kNotFound. When several
+// needles match there, *which gets the index of the first one listed.
+size_t findAny(std::string_view haystack, const std::vector<std::string_view>& needles,
+               size_t* which = nullptr);
+
+// Write text with every from replaced by to into out, sized up front, and
+// return the number of replacements. out is left alone when there are none.
+// from must not be empty.
+size_t replaceAll(std::string_view text, std::string_view from, std::string_view to,
+                  std::string& out);
+
+// Position of the first '"', '\\' or control byte (< 0x20) at or after
+// from, or kNotFound. JSON strings run until one of these.
+size_t findJsonSpecial(std::string_view text, size_t from = 0);
+
+// Map ASCII letters in place
+void asciiToUpper(char* data, size_t size);
+void asciiToLower(char* data, size_t size);
+
+std::string joinStrings(const std::vector<std::string_view>& parts, std::string_view separator);
+
+// "avx2", "sse2" or "scalar"
+const char* stringKernelLevel();
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_STRING_KERNELS_H
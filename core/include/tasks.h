@@ -0,0 +1,84 @@
+#ifndef ANDROIDSCRIPT_TASKS_H
+#define ANDROIDSCRIPT_TASKS_H
+
+#include "bounded_queue.h"
+#include "scheduler.h"
+#include "value.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace androidscript {
+
+// Script-level concurrency: Spawn/Await tasks and channels
+//
+// A spawned task runs in its own Interpreter on the scheduler of the
+// spawning script (or the shared background scheduler). Values handed to a
+// task or sent through a channel are deep-copied first, including the
+// environments captured by functions, so tasks never share mutable state.
+// Task handles and channels themselves are shared and thread-safe.
+
+// Handle returned by Spawn()
+class TaskHandle : public NativeObject {
+public:
+    TaskHandle() : done_(false), failed_(false) {}
+
+    std::string typeName() const override { return "task"; }
+
+    void finish(const Value& result);
+    void fail(const std::string& error);
+
+    // Block (or park the calling task) until done; rethrows task errors
+    Value await();
+
+private:
+    std::atomic<bool> done_;
+    bool failed_;
+    Value result_;
+    std::string error_;
+    WaitQueue waiters_;
+};
+
+// Bounded channel returned by Channel(). Holds exactly `capacity` values:
+// senders reserve a slot in count_ before pushing, since the queue itself
+// rounds its size up to a power of two.
+class Channel : public NativeObject {
+public:
+    explicit Channel(size_t capacity)
+        : queue_(capacity), capacity_(capacity), count_(0), closed_(false) {}
+
+    std::string typeName() const override { return "channel"; }
+
+    // Blocks while the channel is full; throws once closed
+    void send(const Value& value);
+
+    // Blocks while the channel is empty; returns nil once closed and drained
+    Value receive();
+
+    void close();
+
+private:
+    BoundedQueue<Value> queue_;
+    const size_t capacity_;
+    std::atomic<size_t> count_;  // Values queued or being sent
+    std::atomic<bool> closed_;
+    WaitQueue not_empty_;
+    WaitQueue not_full_;
+};
+
+// Deep copy used when values cross into another task
+Value isolateValue(const Value& value);
+
+// Start fn(args...) as a task and return its handle
+Value spawnTask(const Value& fn, const std::vector<Value>& args);
+
+// Call fn(item) for every array element on the work-stealing pool. Each
+// pool thread gets its own interpreter and copy of fn; strings and scalars
+// are shared, mutable containers are copied. Returns the results in input
+// order when collect is set, otherwise nil.
+Value parallelMap(const Value& array, const Value& fn, bool collect);
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_TASKS_H
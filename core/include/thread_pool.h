@@ -0,0 +1,81 @@
+#ifndef ANDROIDSCRIPT_THREAD_POOL_H
+#define ANDROIDSCRIPT_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace androidscript {
+
+// Work-stealing pool for data-parallel loops
+//
+// parallelFor() hands every worker one slice of the index range. A worker
+// keeps splitting its slice in half, pushing the upper half onto the back of
+// its own deque and working on the lower half, until the piece is small
+// enough to run. Idle workers steal from the front of other deques, which
+// holds the largest remaining pieces, so uneven per-item cost balances out
+// without a central queue.
+class WorkStealingPool {
+public:
+    // threads == 0 picks the number of hardware threads
+    explicit WorkStealingPool(size_t threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t threadCount() const { return workers_.size(); }
+
+    // Call body(slot, begin, end) over disjoint ranges covering [0, count)
+    // and block until all of them have returned. slot (< threadCount())
+    // identifies the pool thread, so callers can keep per-thread state
+    // without locking. body must not throw.
+    void parallelFor(size_t count,
+                     const std::function<void(size_t slot, size_t begin, size_t end)>& body);
+
+    // Process-wide pool, created on first use
+    static WorkStealingPool& shared();
+
+private:
+    struct Job {
+        const std::function<void(size_t, size_t, size_t)>* body;
+        size_t grain;
+        std::atomic<size_t> remaining;  // Items not yet processed
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    struct Range {
+        Job* job;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Range> deque;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> queued_;   // Ranges sitting in any deque
+    bool stopping_;
+
+    void push(size_t slot, const Range& range);
+    bool popLocal(size_t slot, Range& range);
+    bool steal(size_t slot, Range& range);
+    void execute(size_t slot, Range range);
+    void workerLoop(size_t slot);
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_THREAD_POOL_H
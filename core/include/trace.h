@@ -0,0 +1,73 @@
+#ifndef ANDROIDSCRIPT_TRACE_H
+#define ANDROIDSCRIPT_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace androidscript {
+
+// Chrome trace-event timeline (androidscript --trace=run.json), readable by
+// chrome://tracing and ui.perfetto.dev
+//
+// Spans cover builtin calls, script function calls, device commands and adb
+// processes in every interpreter of the process, including spawned tasks.
+// Each device serial is shown as a process ("host" for work not tied to a
+// device) with a row per interpreter. Finished spans go into a ring buffer
+// owned by the recording thread without taking a lock; a writer thread
+// drains the buffers into the file. Spans recorded while a buffer is full
+// are dropped and counted.
+class Tracer {
+public:
+    // Throws if the file cannot be created or tracing is already on
+    static void start(const std::string& path);
+
+    // Write out everything recorded and close the file
+    static void stop();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since start()
+    static int64_t now();
+
+    // A finished span. category must be a string literal; name and track
+    // (a device serial, or empty) are copied, names up to 47 bytes.
+    static void record(const char* category, std::string_view name, std::string_view track,
+                       int64_t begin, int64_t end);
+
+    // Totals of the last run, once stopped
+    static uint64_t eventsWritten();
+    static uint64_t eventsDropped();
+
+private:
+    static inline std::atomic<bool> enabled_{false};
+};
+
+// Records a span from construction to destruction while tracing is on.
+// name and track must outlive the span.
+class TraceSpan {
+public:
+    TraceSpan(const char* category, std::string_view name, std::string_view track)
+        : category_(Tracer::enabled() ? category : nullptr), name_(name), track_(track),
+          begin_(category_ ? Tracer::now() : 0) {}
+
+    ~TraceSpan() {
+        if (category_ && Tracer::enabled()) {
+            Tracer::record(category_, name_, track_, begin_, Tracer::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* category_;  // Null when tracing was off at the start
+    std::string_view name_;
+    std::string_view track_;
+    int64_t begin_;
+};
+
+} // namespace androidscript
+
+#endif // ANDROIDSCRIPT_TRACE_H
@@ -7,12 +7,15 @@
 #include <memory>
 #include <functional>
 #include <ostream>
+#include <cstdint>
 
 namespace androidscript {
 
 // Forward declarations
 class Value;
 class Environment;
+class ValueHashTable;
+class DeviceSession;
 
 // Type aliases
 using NativeFunction = std::function<Value(const std::vector<Value>&)>;
@@ -30,7 +33,10 @@ enum class ValueType {
     OBJECT,
     FUNCTION,
     NATIVE_FUNCTION,
-    DEVICE
+    DEVICE,
+    MAP,
+    SET,
+    NATIVE_OBJECT
 };
 
 // Device reference (for multi-device support)
@@ -40,18 +46,22 @@ struct DeviceRef {
     int screen_width;
     int screen_height;
     std::string android_version;
-    void* native_handle;  // Platform-specific handle
+    std::shared_ptr<DeviceSession> session;  // Session its methods act on
 
-    DeviceRef() : screen_width(0), screen_height(0), native_handle(nullptr) {}
-    DeviceRef(const std::string& ser) : serial(ser), screen_width(0), screen_height(0), native_handle(nullptr) {}
+    DeviceRef() : screen_width(0), screen_height(0) {}
+    DeviceRef(const std::string& ser) : serial(ser), screen_width(0), screen_height(0) {}
 };
 
 // Function object (user-defined functions)
 struct FunctionObject {
+    std::string name;  // As declared; used by debugging and profiling tools
     std::vector<std::string> parameters;
     std::shared_ptr<class Statement> body;  // AST node for function body
     std::shared_ptr<Environment> closure;   // Captured environment
 
+    // Set for functions compiled with --emit-cpp; called instead of body
+    Value (*compiled)(const std::vector<Value>&, const std::shared_ptr<Environment>&) = nullptr;
+
     FunctionObject() = default;
     FunctionObject(const std::vector<std::string>& params,
                    std::shared_ptr<class Statement> b,
@@ -59,6 +69,26 @@ struct FunctionObject {
         : parameters(params), body(b), closure(env) {}
 };
 
+// Native function, with the parameter names it accepts as named arguments
+// (empty: positional only)
+struct NativeFunctionObject {
+    NativeFunction function;
+    std::vector<std::string> parameters;
+};
+
+// Host-side object exposed to scripts as an opaque handle (tasks, channels)
+class NativeObject {
+public:
+    virtual ~NativeObject() = default;
+    virtual std::string typeName() const = 0;
+    virtual std::string toString() const { return "<" + typeName() + ">"; }
+
+    // Objects ForEach can walk (streams, readers) override both; next()
+    // hands out one item per call until it returns false
+    virtual bool isIterable() const { return false; }
+    virtual bool next(Value& item);
+};
+
 // Main Value class
 class Value {
 public:
@@ -69,9 +99,12 @@ public:
     Value(int i);  // Convenience for int literals
     Value(double d);
     Value(const std::string& s);
+    Value(std::string&& s);
     Value(const char* s);  // Convenience for string literals
     Value(const ValueArray& arr);
+    Value(ValueArray&& arr);
     Value(const ValueMap& obj);
+    Value(ValueMap&& obj);
     Value(const DeviceRef& dev);
     Value(const FunctionObject& func);
     Value(NativeFunction func);
@@ -96,6 +129,9 @@ public:
     bool isFunction() const { return type_ == ValueType::FUNCTION; }
     bool isNativeFunction() const { return type_ == ValueType::NATIVE_FUNCTION; }
     bool isDevice() const { return type_ == ValueType::DEVICE; }
+    bool isMap() const { return type_ == ValueType::MAP; }
+    bool isSet() const { return type_ == ValueType::SET; }
+    bool isNativeObject() const { return type_ == ValueType::NATIVE_OBJECT; }
     bool isCallable() const { return isFunction() || isNativeFunction(); }
 
     // Type conversions
@@ -103,6 +139,7 @@ public:
     int64_t asInt() const;
     double asFloat() const;
     std::string asString() const;
+    const std::string& asStringRef() const;
     ValueArray& asArray();
     const ValueArray& asArray() const;
     ValueMap& asObject();
@@ -113,6 +150,10 @@ public:
     const FunctionObject& asFunction() const;
     NativeFunction& asNativeFunction();
     const NativeFunction& asNativeFunction() const;
+    const std::vector<std::string>& nativeParameters() const;
+    ValueHashTable& asTable();
+    const ValueHashTable& asTable() const;
+    const std::shared_ptr<NativeObject>& asNativeObject() const;
 
     // Factory methods
     static Value makeNil();
@@ -121,10 +162,16 @@ public:
     static Value makeFloat(double d);
     static Value makeString(const std::string& s);
     static Value makeArray(const ValueArray& arr = ValueArray());
+    static Value makeArray(ValueArray&& arr);
     static Value makeObject(const ValueMap& obj = ValueMap());
+    static Value makeObject(ValueMap&& obj);
     static Value makeDevice(const DeviceRef& dev);
     static Value makeFunction(const FunctionObject& func);
     static Value makeNativeFunction(NativeFunction func);
+    static Value makeNativeFunction(NativeFunction func, std::vector<std::string> parameters);
+    static Value makeMap();
+    static Value makeSet();
+    static Value makeNativeObject(std::shared_ptr<NativeObject> obj);
 
     // Operators
     Value operator+(const Value& other) const;
@@ -156,6 +203,12 @@ public:
     // Truthiness (for conditionals)
     bool isTruthy() const;
 
+    // Hashing (consistent with valueKeyEquals in hash_table.h)
+    uint64_t hash() const;
+
+    // Reference identity for heap types, serial for devices
+    bool identityEquals(const Value& other) const;
+
     // Array operations
     void push(const Value& val);
     Value pop();
@@ -183,7 +236,9 @@ private:
     std::shared_ptr<ValueMap> object_val;
     std::shared_ptr<DeviceRef> device_val;
     std::shared_ptr<FunctionObject> function_val;
-    std::shared_ptr<NativeFunction> native_function_val;
+    std::shared_ptr<NativeFunctionObject> native_function_val;
+    std::shared_ptr<ValueHashTable> table_val;  // MAP and SET
+    std::shared_ptr<NativeObject> native_object_val;
 
     // Helper methods
     void cleanup();
@@ -193,6 +248,24 @@ private:
 // Output operator
 std::ostream& operator<<(std::ostream& os, const Value& val);
 
+// What ForEach visits, shared by the interpreter and compiled scripts:
+// array elements (the size is re-read every step, so the body may push),
+// a snapshot of map and set keys, or the items of an iterable native object
+class ForEachCursor {
+public:
+    // Throws if the value cannot be iterated
+    explicit ForEachCursor(const Value& iterable);
+
+    bool next(Value& item);
+
+private:
+    Value iterable_;
+    ValueArray keys_;
+    const ValueArray* items_;
+    size_t index_;
+    NativeObject* native_;
+};
+
 // Type checking helpers
 inline bool isNil(const Value& val) { return val.isNil(); }
 inline bool isBool(const Value& val) { return val.isBool(); }
@@ -202,6 +275,8 @@ inline bool isNumber(const Value& val) { return val.isNumber(); }
 inline bool isString(const Value& val) { return val.isString(); }
 inline bool isArray(const Value& val) { return val.isArray(); }
 inline bool isObject(const Value& val) { return val.isObject(); }
+inline bool isMap(const Value& val) { return val.isMap(); }
+inline bool isSet(const Value& val) { return val.isSet(); }
 
 } // namespace androidscript
 
@@ -24,5 +24,6 @@ void FunctionStmt::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void ReturnStmt::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void BreakStmt::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 void ContinueStmt::accept(ASTVisitor& visitor) { visitor.visit(*this); }
+void ImportStmt::accept(ASTVisitor& visitor) { visitor.visit(*this); }
 
 } // namespace androidscript
@@ -1,6 +1,18 @@
 #include "builtins.h"
 #include "interpreter.h"
-#include "adb_client.h"
+#include "hash_table.h"
+#include "extension_loader.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "device_session.h"
+#include "clock.h"
+#include "number_format.h"
+#include "string_kernels.h"
+#include "regex.h"
+#include "json.h"
+#include "file_handle.h"
+#include "csv.h"
+#include "memoize.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -17,39 +29,104 @@
 
 namespace androidscript {
 
-// Global ADB client and current device context
-static AdbClient g_adb_client;
-static std::string g_current_device_serial;
+namespace {
+
+// Device chosen with Device() in the calling interpreter
+DeviceSession& currentDevice() {
+    auto device = selectedDevice();
+    if (!device) {
+        throw std::runtime_error("No device selected. Call Device() first.");
+    }
+    return *device;
+}
+
+} // namespace
 
 void registerBuiltins(Interpreter& interpreter) {
-    auto env = interpreter.getGlobalEnvironment();
+    registerBuiltins(interpreter.getGlobalEnvironment());
+}
 
+std::shared_ptr<Environment> sharedBuiltins() {
+    static const std::shared_ptr<Environment> builtins = []() {
+        auto env = std::make_shared<Environment>();
+        registerBuiltins(env);
+        env->freeze();
+        return env;
+    }();
+    return builtins;
+}
+
+void registerBuiltins(const std::shared_ptr<Environment>& env) {
     // Utility functions
     env->define("Print", Value::makeNativeFunction(builtin_Print));
     env->define("Log", Value::makeNativeFunction(builtin_Log));
     env->define("LogError", Value::makeNativeFunction(builtin_LogError));
-    env->define("Sleep", Value::makeNativeFunction(builtin_Sleep));
+    env->define("Sleep", Value::makeNativeFunction(builtin_Sleep, {"milliseconds"}));
+    env->define("Now", Value::makeNativeFunction(builtin_Now));
     env->define("Assert", Value::makeNativeFunction(builtin_Assert));
 
     // String functions
     env->define("Length", Value::makeNativeFunction(builtin_Length));
-    env->define("Substring", Value::makeNativeFunction(builtin_Substring));
+    env->define("Substring", Value::makeNativeFunction(builtin_Substring, {"str", "start", "end"}));
     env->define("ToUpper", Value::makeNativeFunction(builtin_ToUpper));
     env->define("ToLower", Value::makeNativeFunction(builtin_ToLower));
     env->define("Contains", Value::makeNativeFunction(builtin_Contains));
-    env->define("Replace", Value::makeNativeFunction(builtin_Replace));
+    env->define("Replace", Value::makeNativeFunction(builtin_Replace, {"str", "old", "new"}));
+
+    // Regular expressions
+    env->define("Match", Value::makeNativeFunction(builtin_Match));
+    env->define("MatchAll", Value::makeNativeFunction(builtin_MatchAll));
+    env->define("RegexReplace", Value::makeNativeFunction(builtin_RegexReplace));
+    env->define("Split", Value::makeNativeFunction(builtin_Split, {"str", "pattern"}));
 
     // Array functions
     env->define("Count", Value::makeNativeFunction(builtin_Count));
     env->define("Push", Value::makeNativeFunction(builtin_Push));
     env->define("Pop", Value::makeNativeFunction(builtin_Pop));
-    env->define("Join", Value::makeNativeFunction(builtin_Join));
+    env->define("Join", Value::makeNativeFunction(builtin_Join, {"array", "separator"}));
+
+    // Higher-order array functions
+    env->define("Sort", Value::makeNativeFunction(builtin_Sort));
+    env->define("MapArray", Value::makeNativeFunction(builtin_MapArray));
+    env->define("Filter", Value::makeNativeFunction(builtin_Filter));
+    env->define("Reduce", Value::makeNativeFunction(builtin_Reduce, {"array", "fn", "initial"}));
+    env->define("Find", Value::makeNativeFunction(builtin_Find));
+    env->define("Unique", Value::makeNativeFunction(builtin_Unique));
+
+    // Memoization
+    env->define("Memoize", Value::makeNativeFunction(builtin_Memoize, {"fn", "maxEntries"}));
+    env->define("MemoStats", Value::makeNativeFunction(builtin_MemoStats));
+
+    // Hash map and set
+    env->define("Map", Value::makeNativeFunction(builtin_Map));
+    env->define("Set", Value::makeNativeFunction(builtin_Set));
+    env->define("Has", Value::makeNativeFunction(builtin_Has));
+    env->define("Get", Value::makeNativeFunction(builtin_Get));
+    env->define("Put", Value::makeNativeFunction(builtin_Put));
+    env->define("Delete", Value::makeNativeFunction(builtin_Delete));
+    env->define("Keys", Value::makeNativeFunction(builtin_Keys));
+
+    // Tasks and channels
+    env->define("Spawn", Value::makeNativeFunction(builtin_Spawn));
+    env->define("Await", Value::makeNativeFunction(builtin_Await));
+    env->define("AwaitAll", Value::makeNativeFunction(builtin_AwaitAll));
+    env->define("Channel", Value::makeNativeFunction(builtin_Channel, {"capacity"}));
+    env->define("Send", Value::makeNativeFunction(builtin_Send));
+    env->define("Receive", Value::makeNativeFunction(builtin_Receive));
+    env->define("Close", Value::makeNativeFunction(builtin_Close));
+    env->define("ParallelMap", Value::makeNativeFunction(builtin_ParallelMap));
+    env->define("ParallelForEach", Value::makeNativeFunction(builtin_ParallelForEach));
 
     // Type conversion
     env->define("ToString", Value::makeNativeFunction(builtin_ToString));
     env->define("ToInt", Value::makeNativeFunction(builtin_ToInt));
     env->define("ToFloat", Value::makeNativeFunction(builtin_ToFloat));
 
+    // JSON
+    env->define("JsonParse", Value::makeNativeFunction(builtin_JsonParse));
+    env->define("JsonStringify", Value::makeNativeFunction(builtin_JsonStringify, {"value", "indent"}));
+    env->define("JsonStream", Value::makeNativeFunction(builtin_JsonStream));
+
     // Device management
     env->define("Device", Value::makeNativeFunction(builtin_Device));
     env->define("GetAllDevices", Value::makeNativeFunction(builtin_GetAllDevices));
@@ -57,11 +134,17 @@ void registerBuiltins(Interpreter& interpreter) {
     // File operations
     env->define("FileExists", Value::makeNativeFunction(builtin_FileExists));
     env->define("ReadFile", Value::makeNativeFunction(builtin_ReadFile));
-    env->define("WriteFile", Value::makeNativeFunction(builtin_WriteFile));
+    env->define("WriteFile", Value::makeNativeFunction(builtin_WriteFile, {"path", "content"}));
+    env->define("Open", Value::makeNativeFunction(builtin_Open, {"path", "mode"}));
+    env->define("ReadLine", Value::makeNativeFunction(builtin_ReadLine));
+    env->define("Read", Value::makeNativeFunction(builtin_Read, {"file", "count"}));
+    env->define("Write", Value::makeNativeFunction(builtin_Write));
+    env->define("Flush", Value::makeNativeFunction(builtin_Flush));
+    env->define("CsvRows", Value::makeNativeFunction(builtin_CsvRows, {"path", "header"}));
 
     // UI Automation
-    env->define("Tap", Value::makeNativeFunction(builtin_Tap));
-    env->define("Swipe", Value::makeNativeFunction(builtin_Swipe));
+    env->define("Tap", Value::makeNativeFunction(builtin_Tap, {"x", "y"}));
+    env->define("Swipe", Value::makeNativeFunction(builtin_Swipe, {"x1", "y1", "x2", "y2", "duration"}));
     env->define("Input", Value::makeNativeFunction(builtin_Input));
     env->define("KeyEvent", Value::makeNativeFunction(builtin_KeyEvent));
     env->define("Screenshot", Value::makeNativeFunction(builtin_Screenshot));
@@ -74,8 +157,11 @@ void registerBuiltins(Interpreter& interpreter) {
     env->define("ClearAppData", Value::makeNativeFunction(builtin_ClearAppData));
 
     // Device File Operations
-    env->define("PushFile", Value::makeNativeFunction(builtin_PushFile));
-    env->define("PullFile", Value::makeNativeFunction(builtin_PullFile));
+    env->define("PushFile", Value::makeNativeFunction(builtin_PushFile, {"local_path", "remote_path"}));
+    env->define("PullFile", Value::makeNativeFunction(builtin_PullFile, {"remote_path", "local_path"}));
+
+    // Native extensions
+    env->define("LoadExtension", Value::makeNativeFunction(builtin_LoadExtension));
 }
 
 // Utility functions
@@ -119,10 +205,16 @@ Value builtin_Sleep(const std::vector<Value>& args) {
         throw std::runtime_error("Sleep() duration cannot be negative");
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    // Parks the task instead of the thread when running under a Scheduler
+    Scheduler::sleepFor(std::chrono::milliseconds(ms));
     return Value::makeNil();
 }
 
+Value builtin_Now(const std::vector<Value>&) {
+    // Follows the virtual clock under --virtual-time
+    return Value(Clock::epochMs());
+}
+
 Value builtin_Assert(const std::vector<Value>& args) {
     if (args.empty()) {
         throw std::runtime_error("Assert() requires at least 1 argument");
@@ -171,8 +263,8 @@ Value builtin_ToUpper(const std::vector<Value>& args) {
     }
 
     std::string str = args[0].asString();
-    std::transform(str.begin(), str.end(), str.begin(), ::toupper);
-    return Value(str);
+    asciiToUpper(&str[0], str.size());
+    return Value(std::move(str));
 }
 
 Value builtin_ToLower(const std::vector<Value>& args) {
@@ -181,8 +273,8 @@ Value builtin_ToLower(const std::vector<Value>& args) {
     }
 
     std::string str = args[0].asString();
-    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-    return Value(str);
+    asciiToLower(&str[0], str.size());
+    return Value(std::move(str));
 }
 
 Value builtin_Contains(const std::vector<Value>& args) {
@@ -190,10 +282,20 @@ Value builtin_Contains(const std::vector<Value>& args) {
         throw std::runtime_error("Contains() requires 2 arguments (string, substring)");
     }
 
-    std::string str = args[0].asString();
-    std::string substr = args[1].asString();
+    const std::string& str = args[0].asStringRef();
+
+    // Contains(str, [a, b, ...]) is true if any of them occurs
+    if (args[1].isArray()) {
+        const ValueArray& items = args[1].asArray();
+        std::vector<std::string_view> needles;
+        needles.reserve(items.size());
+        for (const auto& item : items) {
+            needles.push_back(item.asStringRef());
+        }
+        return Value(findAny(str, needles) != kNotFound);
+    }
 
-    return Value(str.find(substr) != std::string::npos);
+    return Value(findSubstring(str, args[1].asStringRef()) != kNotFound);
 }
 
 Value builtin_Replace(const std::vector<Value>& args) {
@@ -201,17 +303,168 @@ Value builtin_Replace(const std::vector<Value>& args) {
         throw std::runtime_error("Replace() requires 3 arguments (string, old, new)");
     }
 
-    std::string str = args[0].asString();
-    std::string old_str = args[1].asString();
-    std::string new_str = args[2].asString();
+    const std::string& str = args[0].asStringRef();
+    const std::string& old_str = args[1].asStringRef();
+    const std::string& new_str = args[2].asStringRef();
+
+    // Nothing to replace: hand back the same string without copying
+    std::string result;
+    if (old_str.empty() || replaceAll(str, old_str, new_str, result) == 0) {
+        return args[0];
+    }
+    return Value(std::move(result));
+}
+
+// Regular expressions
+
+namespace {
+
+// Group g of a match, or nil if it did not take part
+Value groupValue(const std::string& text, const std::vector<size_t>& groups, size_t g) {
+    size_t start = groups[2 * g];
+    if (start == Regex::kNoGroup) return Value::makeNil();
+    return Value(text.substr(start, groups[2 * g + 1] - start));
+}
 
-    size_t pos = 0;
-    while ((pos = str.find(old_str, pos)) != std::string::npos) {
-        str.replace(pos, old_str.length(), new_str);
-        pos += new_str.length();
+// Where to look for the next match after [start, end): an empty match
+// moves one byte on so the search cannot get stuck
+size_t nextSearchStart(const std::vector<size_t>& groups) {
+    return groups[1] > groups[0] ? groups[1] : groups[1] + 1;
+}
+
+} // namespace
+
+Value builtin_Match(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Match() requires 2 arguments (string, pattern)");
+    }
+
+    const std::string& text = args[0].asStringRef();
+    auto regex = Regex::compile(args[1].asStringRef());
+
+    // [whole match, group 1, group 2, ...] or nil
+    std::vector<size_t> groups;
+    if (!regex->search(text, 0, groups)) return Value::makeNil();
+
+    ValueArray result;
+    for (size_t g = 0; g <= regex->groupCount(); ++g) {
+        result.push_back(groupValue(text, groups, g));
+    }
+    return Value::makeArray(result);
+}
+
+Value builtin_MatchAll(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("MatchAll() requires 2 arguments (string, pattern)");
+    }
+
+    const std::string& text = args[0].asStringRef();
+    auto regex = Regex::compile(args[1].asStringRef());
+    size_t group_count = regex->groupCount();
+
+    // One entry per match: the match itself without groups, the group with
+    // one, an array of the groups with several
+    ValueArray results;
+    std::vector<size_t> groups;
+    for (size_t from = 0; from <= text.size() && regex->search(text, from, groups);
+         from = nextSearchStart(groups)) {
+        if (group_count <= 1) {
+            results.push_back(groupValue(text, groups, group_count));
+        } else {
+            ValueArray entry;
+            for (size_t g = 1; g <= group_count; ++g) {
+                entry.push_back(groupValue(text, groups, g));
+            }
+            results.push_back(Value::makeArray(entry));
+        }
     }
+    return Value::makeArray(results);
+}
+
+Value builtin_RegexReplace(const std::vector<Value>& args) {
+    if (args.size() < 3) {
+        throw std::runtime_error("RegexReplace() requires 3 arguments (string, pattern, replacement)");
+    }
+
+    const std::string& text = args[0].asStringRef();
+    auto regex = Regex::compile(args[1].asStringRef());
+    const std::string& replacement = args[2].asStringRef();
+    size_t group_count = regex->groupCount();
+
+    std::string result;
+    size_t copied = 0;
+    size_t matches = 0;
+    std::vector<size_t> groups;
+    for (size_t from = 0; from <= text.size() && regex->search(text, from, groups);
+         from = nextSearchStart(groups)) {
+        ++matches;
+        result.append(text, copied, groups[0] - copied);
+        copied = groups[1];
+
+        // $0-$9 and ${n} insert groups, $$ is a literal $
+        for (size_t i = 0; i < replacement.size(); ++i) {
+            char c = replacement[i];
+            if (c != '$' || i + 1 == replacement.size()) {
+                result += c;
+                continue;
+            }
+
+            size_t g = Regex::kNoGroup;
+            char next = replacement[i + 1];
+            if (next == '$') {
+                result += '$';
+                ++i;
+                continue;
+            } else if (std::isdigit(static_cast<unsigned char>(next))) {
+                g = static_cast<size_t>(next - '0');
+                ++i;
+            } else if (next == '{') {
+                size_t close = replacement.find('}', i + 2);
+                int64_t index;
+                if (close != std::string::npos &&
+                    parseInt(std::string_view(replacement).substr(i + 2, close - i - 2), index) &&
+                    index >= 0) {
+                    g = static_cast<size_t>(index);
+                    i = close;
+                }
+            }
 
-    return Value(str);
+            if (g == Regex::kNoGroup) {
+                result += c;
+            } else if (g > group_count) {
+                throw std::runtime_error("RegexReplace() replacement refers to missing group " +
+                                         std::to_string(g));
+            } else if (groups[2 * g] != Regex::kNoGroup) {
+                result.append(text, groups[2 * g], groups[2 * g + 1] - groups[2 * g]);
+            }
+        }
+    }
+
+    if (matches == 0) return args[0];
+    result.append(text, copied, std::string::npos);
+    return Value(std::move(result));
+}
+
+Value builtin_Split(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Split() requires 2 arguments (string, pattern)");
+    }
+
+    const std::string& text = args[0].asStringRef();
+    auto regex = Regex::compile(args[1].asStringRef());
+
+    // Empty matches do not split
+    ValueArray pieces;
+    size_t piece_start = 0;
+    std::vector<size_t> groups;
+    for (size_t from = 0; from <= text.size() && regex->search(text, from, groups);
+         from = nextSearchStart(groups)) {
+        if (groups[1] == groups[0]) continue;
+        pieces.push_back(Value(text.substr(piece_start, groups[0] - piece_start)));
+        piece_start = groups[1];
+    }
+    pieces.push_back(Value(text.substr(piece_start)));
+    return Value::makeArray(pieces);
 }
 
 // Array functions
@@ -251,448 +504,886 @@ Value builtin_Join(const std::vector<Value>& args) {
     }
 
     const ValueArray& arr = args[0].asArray();
-    std::string sep = args[1].asString();
-    std::ostringstream oss;
 
-    for (size_t i = 0; i < arr.size(); ++i) {
-        if (i > 0) oss << sep;
-        oss << arr[i].toString();
+    // Strings are joined in place; other values are converted first
+    std::vector<std::string> converted;
+    converted.reserve(arr.size());
+    std::vector<std::string_view> parts;
+    parts.reserve(arr.size());
+    for (const auto& item : arr) {
+        if (item.isString()) {
+            parts.push_back(item.asStringRef());
+        } else {
+            converted.push_back(item.toString());
+            parts.push_back(converted.back());
+        }
     }
 
-    return Value(oss.str());
+    return Value(joinStrings(parts, args[1].asStringRef()));
 }
 
-// Type conversion
 
-Value builtin_ToString(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("ToString() requires 1 argument");
+// Higher-order array functions
+
+namespace {
+
+// Script or native callable invoked from native code. Runs on the
+// interpreter that called the builtin; AOT programs and host threads
+// without one get a private interpreter.
+class Callback {
+public:
+    Callback(const Value& fn, const char* function) : fn_(fn) {
+        if (!fn.isCallable()) {
+            throw std::runtime_error(std::string(function) + "() requires a function");
+        }
+        interpreter_ = Interpreter::current();
+        if (!interpreter_) {
+            fallback_ = std::make_unique<Interpreter>();
+            interpreter_ = fallback_.get();
+        }
     }
 
-    return Value(args[0].toString());
-}
+    Value operator()(const std::vector<Value>& args) const {
+        return interpreter_->callFunction(fn_, args);
+    }
 
-Value builtin_ToInt(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("ToInt() requires 1 argument");
+private:
+    Value fn_;
+    Interpreter* interpreter_;
+    std::unique_ptr<Interpreter> fallback_;
+};
+
+const ValueArray& arrayArg(const std::vector<Value>& args, const char* function,
+                           const char* usage) {
+    if (args.empty() || !args[0].isArray()) {
+        throw std::runtime_error(std::string(function) + "() requires " + usage);
     }
+    return args[0].asArray();
+}
 
-    if (args[0].isInt()) {
-        return args[0];
-    } else if (args[0].isFloat()) {
-        return Value(static_cast<int64_t>(args[0].asFloat()));
-    } else if (args[0].isString()) {
-        try {
-            return Value(static_cast<int64_t>(std::stoll(args[0].asString())));
-        } catch (...) {
-            throw std::runtime_error("Cannot convert string to integer");
+// Introsort: quicksort with median-of-three pivots, falling back to heapsort
+// when recursion gets too deep, with insertion sort for each small range.
+// Every scan is bounds-checked, so an inconsistent script comparator yields
+// some order instead of running off the array, and since insertion sort only
+// ever sees ranges of up to 16 elements, it stays O(n log n) calls too.
+constexpr ptrdiff_t kInsertionSortThreshold = 16;
+
+template <typename Less>
+void insertionSort(Value* first, Value* last, Less& less) {
+    for (Value* i = first + 1; i < last; ++i) {
+        Value item = std::move(*i);
+        Value* j = i;
+        while (j > first && less(item, *(j - 1))) {
+            *j = std::move(*(j - 1));
+            --j;
         }
+        *j = std::move(item);
     }
+}
 
-    throw std::runtime_error("Cannot convert to integer");
+template <typename Less>
+void siftDown(Value* heap, size_t root, size_t size, Less& less) {
+    while (true) {
+        size_t child = 2 * root + 1;
+        if (child >= size) return;
+        if (child + 1 < size && less(heap[child], heap[child + 1])) ++child;
+        if (!less(heap[root], heap[child])) return;
+        std::swap(heap[root], heap[child]);
+        root = child;
+    }
 }
 
-Value builtin_ToFloat(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("ToFloat() requires 1 argument");
+template <typename Less>
+void heapSort(Value* first, Value* last, Less& less) {
+    size_t size = static_cast<size_t>(last - first);
+    for (size_t i = size / 2; i-- > 0;) {
+        siftDown(first, i, size, less);
     }
+    for (size_t end = size; end-- > 1;) {
+        std::swap(first[0], first[end]);
+        siftDown(first, 0, end, less);
+    }
+}
 
-    if (args[0].isFloat()) {
-        return args[0];
-    } else if (args[0].isInt()) {
-        return Value(static_cast<double>(args[0].asInt()));
-    } else if (args[0].isString()) {
-        try {
-            return Value(std::stod(args[0].asString()));
-        } catch (...) {
-            throw std::runtime_error("Cannot convert string to float");
+template <typename Less>
+void introsortLoop(Value* first, Value* last, int depth, Less& less) {
+    while (last - first > kInsertionSortThreshold) {
+        if (depth == 0) {
+            heapSort(first, last, less);
+            return;
+        }
+        --depth;
+
+        // Median of three becomes the pivot at *first
+        Value* a = first + 1;
+        Value* b = first + (last - first) / 2;
+        Value* c = last - 1;
+        if (less(*b, *a)) std::swap(*a, *b);
+        if (less(*c, *b)) {
+            std::swap(*b, *c);
+            if (less(*b, *a)) std::swap(*a, *b);
+        }
+        std::swap(*first, *b);
+
+        // Hoare partition
+        const Value& pivot = *first;
+        Value* lo = first + 1;
+        Value* hi = last - 1;
+        while (true) {
+            while (lo <= hi && less(*lo, pivot)) ++lo;
+            while (hi >= lo && less(pivot, *hi)) --hi;
+            if (lo >= hi) break;
+            std::swap(*lo, *hi);
+            ++lo;
+            --hi;
+        }
+        std::swap(*first, *hi);
+
+        // Recurse into the smaller side, loop on the larger
+        if (hi - first < last - (hi + 1)) {
+            introsortLoop(first, hi, depth, less);
+            first = hi + 1;
+        } else {
+            introsortLoop(hi + 1, last, depth, less);
+            last = hi;
         }
     }
+    insertionSort(first, last, less);
+}
 
-    throw std::runtime_error("Cannot convert to float");
+template <typename Less>
+void introsort(ValueArray& items, Less less) {
+    if (items.size() < 2) return;
+
+    int depth = 0;
+    for (size_t n = items.size(); n > 1; n >>= 1) depth += 2;
+
+    Value* first = items.data();
+    Value* last = first + items.size();
+    introsortLoop(first, last, depth, less);
 }
 
-// Device management
+} // namespace
 
-Value builtin_Device(const std::vector<Value>& args) {
-    DeviceRef dev;
+Value builtin_Sort(const std::vector<Value>& args) {
+    ValueArray items = arrayArg(args, "Sort", "an array");
 
-    if (!args.empty()) {
-        // Use specified device serial
-        dev.serial = args[0].asString();
+    if (args.size() < 2) {
+        introsort(items, [](const Value& a, const Value& b) { return a < b; });
+        return Value::makeArray(items);
+    }
+
+    // cmp(a, b) returns true/false for "a before b", or a number < 0
+    Callback cmp(args[1], "Sort");
+    std::vector<Value> call_args(2);
+    introsort(items, [&](const Value& a, const Value& b) {
+        call_args[0] = a;
+        call_args[1] = b;
+        Value result = cmp(call_args);
+        if (result.isBool()) return result.asBool();
+        if (result.isNumber()) return result.asFloat() < 0;
+        throw std::runtime_error("Sort() comparator must return a boolean or number");
+    });
+    return Value::makeArray(items);
+}
+
+Value builtin_MapArray(const std::vector<Value>& args) {
+    // Copy: the callback may modify the array
+    const ValueArray items = arrayArg(args, "MapArray", "(array, function)");
+    if (args.size() < 2) {
+        throw std::runtime_error("MapArray() requires (array, function)");
+    }
+
+    Callback fn(args[1], "MapArray");
+    std::vector<Value> call_args(1);
+    ValueArray results;
+    results.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        call_args[0] = items[i];
+        results.push_back(fn(call_args));
+    }
+    return Value::makeArray(results);
+}
+
+Value builtin_Filter(const std::vector<Value>& args) {
+    // Copy: the callback may modify the array
+    const ValueArray items = arrayArg(args, "Filter", "(array, function)");
+    if (args.size() < 2) {
+        throw std::runtime_error("Filter() requires (array, function)");
+    }
 
-        // Verify device exists
-        if (!g_adb_client.deviceExists(dev.serial)) {
-            throw std::runtime_error("Device not found: " + dev.serial);
+    Callback fn(args[1], "Filter");
+    std::vector<Value> call_args(1);
+    ValueArray results;
+    for (size_t i = 0; i < items.size(); ++i) {
+        call_args[0] = items[i];
+        if (fn(call_args).isTruthy()) {
+            results.push_back(items[i]);
         }
+    }
+    return Value::makeArray(results);
+}
+
+Value builtin_Reduce(const std::vector<Value>& args) {
+    // Copy: the callback may modify the array
+    const ValueArray items = arrayArg(args, "Reduce", "(array, function, initial)");
+    if (args.size() < 2) {
+        throw std::runtime_error("Reduce() requires (array, function, initial)");
+    }
+
+    // Without an initial value the first element seeds the accumulator
+    size_t start = 0;
+    Value accumulator;
+    if (args.size() > 2) {
+        accumulator = args[2];
+    } else if (!items.empty()) {
+        accumulator = items[0];
+        start = 1;
     } else {
-        // Auto-detect first available device
-        auto devices = g_adb_client.getDevices();
-        if (devices.empty()) {
-            throw std::runtime_error("No Android devices found. Make sure USB debugging is enabled.");
+        throw std::runtime_error("Reduce() of an empty array needs an initial value");
+    }
+
+    Callback fn(args[1], "Reduce");
+    std::vector<Value> call_args(2);
+    for (size_t i = start; i < items.size(); ++i) {
+        call_args[0] = std::move(accumulator);
+        call_args[1] = items[i];
+        accumulator = fn(call_args);
+    }
+    return accumulator;
+}
+
+Value builtin_Find(const std::vector<Value>& args) {
+    // Copy: the callback may modify the array
+    const ValueArray items = arrayArg(args, "Find", "(array, function)");
+    if (args.size() < 2) {
+        throw std::runtime_error("Find() requires (array, function)");
+    }
+
+    Callback fn(args[1], "Find");
+    std::vector<Value> call_args(1);
+    for (size_t i = 0; i < items.size(); ++i) {
+        call_args[0] = items[i];
+        if (fn(call_args).isTruthy()) {
+            return items[i];
         }
+    }
+    return Value::makeNil();
+}
 
-        // Use first online device
-        bool found = false;
-        for (const auto& d : devices) {
-            if (d.isOnline()) {
-                dev.serial = d.serial;
-                found = true;
-                break;
-            }
+Value builtin_Unique(const std::vector<Value>& args) {
+    const ValueArray& items = arrayArg(args, "Unique", "an array");
+
+    // Same key equality as Map/Set: by value for scalars, by reference for
+    // containers
+    ValueHashTable seen;
+    seen.reserve(items.size());
+    ValueArray results;
+    for (const auto& item : items) {
+        if (seen.put(item, Value())) {
+            results.push_back(item);
         }
+    }
+    return Value::makeArray(results);
+}
+
+// Memoization
+
+namespace {
 
-        if (!found) {
-            throw std::runtime_error("No online devices found. Device state: " + devices[0].state);
+constexpr int64_t kDefaultMemoEntries = 1024;
+
+// Native function returned by Memoize; MemoStats finds it again through
+// std::function::target
+class Memoized {
+public:
+    Memoized(const Value& fn, size_t capacity)
+        : fn_(fn), cache_(std::make_shared<MemoCache>(capacity)) {}
+
+    Value operator()(const std::vector<Value>& args) const {
+        Value result;
+        if (cache_->find(args, result)) {
+            return result;
         }
+        // Not locked while the function runs, so it may recurse through
+        // the memoized version
+        result = call(args);
+        cache_->insert(args, result);
+        return result;
     }
 
-    // Set this as the current device for automation commands
-    g_current_device_serial = dev.serial;
+    const MemoCache& cache() const { return *cache_; }
 
-    // Get device info from ADB
-    dev.model = g_adb_client.getDeviceModel(dev.serial);
-    dev.android_version = g_adb_client.getAndroidVersion(dev.serial);
+private:
+    Value fn_;
+    std::shared_ptr<MemoCache> cache_;
 
-    auto screen_size = g_adb_client.getScreenSize(dev.serial);
-    dev.screen_width = screen_size.first;
-    dev.screen_height = screen_size.second;
+    Value call(const std::vector<Value>& args) const {
+        // Compiled scripts have no interpreter to go through
+        if (fn_.isFunction() && fn_.asFunction().compiled) {
+            const FunctionObject& func = fn_.asFunction();
+            return func.compiled(args, func.closure);
+        }
+        if (fn_.isNativeFunction()) {
+            return fn_.asNativeFunction()(args);
+        }
+        return Callback(fn_, "Memoize")(args);
+    }
+};
 
-    std::cout << "[DEVICE] Connected to " << dev.model
-              << " (Android " << dev.android_version << ")"
-              << " [" << dev.screen_width << "x" << dev.screen_height << "]" << std::endl;
+} // namespace
 
-    return Value::makeDevice(dev);
+Value builtin_Memoize(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isCallable()) {
+        throw std::runtime_error("Memoize() requires a function");
+    }
+    int64_t capacity = kDefaultMemoEntries;
+    if (args.size() > 1 && !args[1].isNil()) {
+        if (!args[1].isInt() || args[1].asInt() < 1) {
+            throw std::runtime_error("Memoize() maxEntries must be a positive integer");
+        }
+        capacity = args[1].asInt();
+    }
+    return Value::makeNativeFunction(Memoized(args[0], static_cast<size_t>(capacity)));
 }
 
-Value builtin_GetAllDevices(const std::vector<Value>& /* args */) {
-    auto adb_devices = g_adb_client.getDevices();
-    ValueArray devices;
+Value builtin_MemoStats(const std::vector<Value>& args) {
+    const Memoized* memoized = nullptr;
+    if (!args.empty() && args[0].isNativeFunction()) {
+        memoized = args[0].asNativeFunction().target<Memoized>();
+    }
+    if (!memoized) {
+        throw std::runtime_error("MemoStats() requires a function returned by Memoize()");
+    }
+
+    MemoCache::Stats stats = memoized->cache().stats();
+    ValueMap result;
+    result["hits"] = Value(static_cast<int64_t>(stats.hits));
+    result["misses"] = Value(static_cast<int64_t>(stats.misses));
+    result["evictions"] = Value(static_cast<int64_t>(stats.evictions));
+    result["entries"] = Value(static_cast<int64_t>(stats.entries));
+    result["capacity"] = Value(static_cast<int64_t>(stats.capacity));
+    return Value::makeObject(std::move(result));
+}
 
-    for (const auto& d : adb_devices) {
-        DeviceRef dev;
-        dev.serial = d.serial;
-        dev.model = d.model.empty() ? g_adb_client.getDeviceModel(d.serial) : d.model;
-        dev.android_version = g_adb_client.getAndroidVersion(d.serial);
+// Hash map and set
 
-        auto screen_size = g_adb_client.getScreenSize(d.serial);
-        dev.screen_width = screen_size.first;
-        dev.screen_height = screen_size.second;
+Value builtin_Map(const std::vector<Value>& /* args */) {
+    return Value::makeMap();
+}
 
-        devices.push_back(Value::makeDevice(dev));
+Value builtin_Set(const std::vector<Value>& args) {
+    Value set = Value::makeSet();
+
+    // Optional initial elements
+    if (!args.empty()) {
+        const ValueArray& items = args[0].asArray();
+        ValueHashTable& table = set.asTable();
+        table.reserve(items.size());
+        for (const auto& item : items) {
+            table.put(item, Value::makeNil());
+        }
     }
 
-    return Value::makeArray(devices);
+    return set;
 }
 
-// File operations
-
-Value builtin_FileExists(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("FileExists() requires 1 argument");
+Value builtin_Has(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Has() requires 2 arguments (collection, key)");
     }
 
-    std::string path = args[0].asString();
-    std::ifstream file(path);
-    return Value(file.good());
+    if (args[0].isObject()) {
+        return Value(args[0].hasKey(args[1].asStringRef()));
+    }
+    return Value(args[0].asTable().contains(args[1]));
 }
 
-Value builtin_ReadFile(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("ReadFile() requires 1 argument");
+Value builtin_Get(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Get() requires 2 arguments (map, key[, default])");
     }
 
-    std::string path = args[0].asString();
-    std::ifstream file(path);
+    Value fallback = args.size() > 2 ? args[2] : Value::makeNil();
 
-    if (!file) {
-        throw std::runtime_error("Cannot open file: " + path);
+    if (args[0].isObject()) {
+        const ValueMap& obj = args[0].asObject();
+        auto it = obj.find(args[1].asStringRef());
+        return it != obj.end() ? it->second : fallback;
     }
 
-    std::ostringstream oss;
-    oss << file.rdbuf();
-    return Value(oss.str());
+    if (!args[0].isMap()) {
+        throw std::runtime_error("Get() requires a map or object");
+    }
+
+    const Value* found = args[0].asTable().find(args[1]);
+    return found ? *found : fallback;
 }
 
-Value builtin_WriteFile(const std::vector<Value>& args) {
-    if (args.size() < 2) {
-        throw std::runtime_error("WriteFile() requires 2 arguments (path, content)");
+Value builtin_Put(const std::vector<Value>& args) {
+    // Note: This modifies the original collection
+    Value collection = args.empty() ? Value::makeNil() : args[0];
+
+    if (collection.isSet()) {
+        if (args.size() < 2) {
+            throw std::runtime_error("Put() requires 2 arguments (set, key)");
+        }
+        collection.asTable().put(args[1], Value::makeNil());
+        return collection;
     }
 
-    std::string path = args[0].asString();
-    std::string content = args[1].asString();
+    if (args.size() < 3) {
+        throw std::runtime_error("Put() requires 3 arguments (map, key, value)");
+    }
 
-    std::ofstream file(path);
-    if (!file) {
-        throw std::runtime_error("Cannot write to file: " + path);
+    if (collection.isObject()) {
+        collection.set(args[1].asStringRef(), args[2]);
+    } else if (collection.isMap()) {
+        collection.asTable().put(args[1], args[2]);
+    } else {
+        throw std::runtime_error("Put() requires a map, set or object");
+    }
+    return collection;
+}
+
+Value builtin_Delete(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Delete() requires 2 arguments (collection, key)");
     }
 
-    file << content;
-    return Value::makeNil();
+    // Note: This modifies the original collection
+    Value collection = args[0];
+    if (collection.isObject()) {
+        return Value(collection.asObject().erase(args[1].asStringRef()) > 0);
+    }
+    return Value(collection.asTable().remove(args[1]));
 }
 
-// UI Automation - Using real ADB commands
+Value builtin_Keys(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Keys() requires 1 argument");
+    }
 
-Value builtin_Tap(const std::vector<Value>& args) {
-    if (args.size() < 2) {
-        throw std::runtime_error("Tap() requires 2 arguments (x, y)");
+    if (args[0].isObject()) {
+        ValueArray result;
+        for (const auto& pair : args[0].asObject()) {
+            result.push_back(Value(pair.first));
+        }
+        return Value::makeArray(result);
     }
+    return Value::makeArray(args[0].asTable().keys());
+}
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+// Tasks and channels
+
+namespace {
+
+template <typename T>
+std::shared_ptr<T> nativeArg(const Value& value, const char* function, const char* kind) {
+    std::shared_ptr<T> object;
+    if (value.isNativeObject()) {
+        object = std::dynamic_pointer_cast<T>(value.asNativeObject());
     }
+    if (!object) {
+        throw std::runtime_error(std::string(function) + "() requires a " + kind);
+    }
+    return object;
+}
+
+} // namespace
 
-    int x = static_cast<int>(args[0].asInt());
-    int y = static_cast<int>(args[1].asInt());
+Value builtin_Spawn(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Spawn() requires at least 1 argument (function)");
+    }
 
-    std::cout << "[AUTOMATION] Tap(" << x << ", " << y << ") on " << g_current_device_serial << std::endl;
+    std::vector<Value> call_args(args.begin() + 1, args.end());
+    return spawnTask(args[0], call_args);
+}
 
-    auto result = g_adb_client.tap(g_current_device_serial, x, y);
-    if (!result.success()) {
-        throw std::runtime_error("Tap failed: " + result.error);
+Value builtin_Await(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Await() requires 1 argument (task)");
     }
 
-    return Value::makeNil();
+    return nativeArg<TaskHandle>(args[0], "Await", "task")->await();
 }
 
-Value builtin_Swipe(const std::vector<Value>& args) {
-    if (args.size() < 5) {
-        throw std::runtime_error("Swipe() requires 5 arguments (x1, y1, x2, y2, duration)");
+Value builtin_AwaitAll(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isArray()) {
+        throw std::runtime_error("AwaitAll() requires an array of tasks");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    // Copy first: the array may be modified by the caller's other tasks
+    ValueArray tasks = args[0].asArray();
+    ValueArray results;
+    results.reserve(tasks.size());
+    for (const auto& task : tasks) {
+        results.push_back(nativeArg<TaskHandle>(task, "AwaitAll", "task")->await());
     }
+    return Value::makeArray(results);
+}
 
-    int x1 = static_cast<int>(args[0].asInt());
-    int y1 = static_cast<int>(args[1].asInt());
-    int x2 = static_cast<int>(args[2].asInt());
-    int y2 = static_cast<int>(args[3].asInt());
-    int duration = static_cast<int>(args[4].asInt());
+Value builtin_Channel(const std::vector<Value>& args) {
+    int64_t capacity = args.empty() ? 64 : args[0].asInt();
+    if (capacity <= 0) {
+        throw std::runtime_error("Channel() capacity must be positive");
+    }
 
-    std::cout << "[AUTOMATION] Swipe(" << x1 << ", " << y1 << " -> "
-              << x2 << ", " << y2 << ", " << duration << "ms)" << std::endl;
+    return Value::makeNativeObject(std::make_shared<Channel>(static_cast<size_t>(capacity)));
+}
 
-    auto result = g_adb_client.swipe(g_current_device_serial, x1, y1, x2, y2, duration);
-    if (!result.success()) {
-        throw std::runtime_error("Swipe failed: " + result.error);
+Value builtin_Send(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Send() requires 2 arguments (channel, value)");
     }
 
+    nativeArg<Channel>(args[0], "Send", "channel")->send(args[1]);
     return Value::makeNil();
 }
 
-Value builtin_Input(const std::vector<Value>& args) {
+Value builtin_Receive(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("Input() requires 1 argument");
+        throw std::runtime_error("Receive() requires 1 argument (channel)");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
-    }
+    return nativeArg<Channel>(args[0], "Receive", "channel")->receive();
+}
 
-    std::string text = args[0].asString();
-    std::cout << "[AUTOMATION] Input(\"" << text << "\")" << std::endl;
+Value builtin_Close(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Close() requires 1 argument (channel or file)");
+    }
 
-    auto result = g_adb_client.input(g_current_device_serial, text);
-    if (!result.success()) {
-        throw std::runtime_error("Input failed: " + result.error);
+    // Shared by channels and file handles
+    if (args[0].isNativeObject()) {
+        if (auto file = std::dynamic_pointer_cast<FileHandle>(args[0].asNativeObject())) {
+            file->close();
+            return Value::makeNil();
+        }
     }
 
+    nativeArg<Channel>(args[0], "Close", "channel or file")->close();
     return Value::makeNil();
 }
 
-Value builtin_Screenshot(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("Screenshot() requires 1 argument (path)");
+Value builtin_ParallelMap(const std::vector<Value>& args) {
+    if (args.size() < 2 || !args[0].isArray()) {
+        throw std::runtime_error("ParallelMap() requires 2 arguments (array, function)");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    return parallelMap(args[0], args[1], true);
+}
+
+Value builtin_ParallelForEach(const std::vector<Value>& args) {
+    if (args.size() < 2 || !args[0].isArray()) {
+        throw std::runtime_error("ParallelForEach() requires 2 arguments (array, function)");
     }
 
-    std::string path = args[0].asString();
-    std::cout << "[AUTOMATION] Screenshot(\"" << path << "\")" << std::endl;
+    return parallelMap(args[0], args[1], false);
+}
 
-    auto result = g_adb_client.screenshot(g_current_device_serial, path);
-    if (!result.success()) {
-        throw std::runtime_error("Screenshot failed: " + result.error);
+// Type conversion
+
+Value builtin_ToString(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("ToString() requires 1 argument");
     }
 
-    std::cout << "[AUTOMATION] Screenshot saved to: " << path << std::endl;
-    return Value::makeNil();
+    return Value(args[0].toString());
 }
 
-Value builtin_KeyEvent(const std::vector<Value>& args) {
+Value builtin_ToInt(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("KeyEvent() requires 1 argument (keycode)");
+        throw std::runtime_error("ToInt() requires 1 argument");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    if (args[0].isInt()) {
+        return args[0];
+    } else if (args[0].isFloat()) {
+        return Value(static_cast<int64_t>(args[0].asFloat()));
+    } else if (args[0].isString()) {
+        int64_t result;
+        if (!parseIntPrefix(args[0].asString(), result)) {
+            throw std::runtime_error("Cannot convert string to integer");
+        }
+        return Value(result);
     }
 
-    std::string keycode = args[0].asString();
-    std::cout << "[AUTOMATION] KeyEvent(\"" << keycode << "\")" << std::endl;
+    throw std::runtime_error("Cannot convert to integer");
+}
 
-    auto result = g_adb_client.keyevent(g_current_device_serial, keycode);
-    if (!result.success()) {
-        throw std::runtime_error("KeyEvent failed: " + result.error);
+Value builtin_ToFloat(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("ToFloat() requires 1 argument");
     }
 
-    return Value::makeNil();
+    if (args[0].isFloat()) {
+        return args[0];
+    } else if (args[0].isInt()) {
+        return Value(static_cast<double>(args[0].asInt()));
+    } else if (args[0].isString()) {
+        double result;
+        if (!parseFloatPrefix(args[0].asString(), result)) {
+            throw std::runtime_error("Cannot convert string to float");
+        }
+        return Value(result);
+    }
+
+    throw std::runtime_error("Cannot convert to float");
 }
 
-// App Management
+// JSON
 
-Value builtin_LaunchApp(const std::vector<Value>& args) {
+Value builtin_JsonParse(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isString()) {
+        throw std::runtime_error("JsonParse() requires a string argument");
+    }
+
+    return parseJson(args[0].asStringRef());
+}
+
+Value builtin_JsonStringify(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("LaunchApp() requires 1 argument (package)");
+        throw std::runtime_error("JsonStringify() requires at least 1 argument");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    int indent = 0;
+    if (args.size() > 1) {
+        if (!args[1].isInt() || args[1].asInt() < 0 || args[1].asInt() > 16) {
+            throw std::runtime_error("JsonStringify() indent must be an integer from 0 to 16");
+        }
+        indent = static_cast<int>(args[1].asInt());
     }
 
-    std::string package = args[0].asString();
-    std::cout << "[APP] LaunchApp(\"" << package << "\")" << std::endl;
+    return Value(stringifyJson(args[0], indent));
+}
 
-    auto result = g_adb_client.launchApp(g_current_device_serial, package);
-    if (!result.success()) {
-        throw std::runtime_error("LaunchApp failed: " + result.error);
+Value builtin_JsonStream(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isString()) {
+        throw std::runtime_error("JsonStream() requires a file path");
     }
 
-    return Value::makeNil();
+    return Value::makeNativeObject(std::make_shared<JsonStream>(args[0].asStringRef()));
 }
 
-Value builtin_StopApp(const std::vector<Value>& args) {
-    if (args.empty()) {
-        throw std::runtime_error("StopApp() requires 1 argument (package)");
-    }
+// Device management
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+Value builtin_Device(const std::vector<Value>& args) {
+    auto device = DeviceSession::connect(args.empty() ? std::string() : args[0].asString());
+
+    // Set this as the current device for automation commands
+    selectDevice(device);
+
+    const DeviceRef& dev = device->info();
+    std::cout << "[DEVICE] Connected to " << dev.model
+              << " (Android " << dev.android_version << ")"
+              << " [" << dev.screen_width << "x" << dev.screen_height << "]" << std::endl;
+
+    return device->value();
+}
+
+Value builtin_GetAllDevices(const std::vector<Value>& /* args */) {
+    ValueArray devices;
+    for (const auto& device : DeviceSession::connectAll()) {
+        devices.push_back(device->value());
     }
+    return Value::makeArray(devices);
+}
 
-    std::string package = args[0].asString();
-    std::cout << "[APP] StopApp(\"" << package << "\")" << std::endl;
+// File operations
 
-    auto result = g_adb_client.stopApp(g_current_device_serial, package);
-    if (!result.success()) {
-        throw std::runtime_error("StopApp failed: " + result.error);
+Value builtin_FileExists(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("FileExists() requires 1 argument");
     }
 
-    return Value::makeNil();
+    std::string path = args[0].asString();
+    std::ifstream file(path);
+    return Value(file.good());
 }
 
-Value builtin_InstallApp(const std::vector<Value>& args) {
+Value builtin_ReadFile(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("InstallApp() requires 1 argument (apk_path)");
+        throw std::runtime_error("ReadFile() requires 1 argument");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    std::string path = args[0].asString();
+    std::ifstream file(path);
+
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + path);
     }
 
-    std::string apk_path = args[0].asString();
-    std::cout << "[APP] InstallApp(\"" << apk_path << "\")" << std::endl;
+    std::ostringstream oss;
+    oss << file.rdbuf();
+    return Value(oss.str());
+}
 
-    auto result = g_adb_client.installApk(g_current_device_serial, apk_path);
-    if (!result.success()) {
-        throw std::runtime_error("InstallApp failed: " + result.error);
+Value builtin_WriteFile(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("WriteFile() requires 2 arguments (path, content)");
     }
 
-    std::cout << "[APP] App installed successfully" << std::endl;
+    std::string path = args[0].asString();
+    std::string content = args[1].asString();
+
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot write to file: " + path);
+    }
+
+    file << content;
     return Value::makeNil();
 }
 
-Value builtin_UninstallApp(const std::vector<Value>& args) {
+Value builtin_Open(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isString()) {
+        throw std::runtime_error("Open() requires a file path");
+    }
+
+    std::string mode = args.size() > 1 ? args[1].toString() : "r";
+    return Value::makeNativeObject(std::make_shared<FileHandle>(args[0].asStringRef(), mode));
+}
+
+Value builtin_ReadLine(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("UninstallApp() requires 1 argument (package)");
+        throw std::runtime_error("ReadLine() requires 1 argument (file)");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    std::string line;
+    if (!nativeArg<FileHandle>(args[0], "ReadLine", "file")->readLine(line)) {
+        return Value::makeNil();
     }
+    return Value(std::move(line));
+}
 
-    std::string package = args[0].asString();
-    std::cout << "[APP] UninstallApp(\"" << package << "\")" << std::endl;
+Value builtin_Read(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Read() requires at least 1 argument (file)");
+    }
 
-    auto result = g_adb_client.uninstallApp(g_current_device_serial, package);
-    if (!result.success()) {
-        throw std::runtime_error("UninstallApp failed: " + result.error);
+    size_t count = 0;
+    if (args.size() > 1) {
+        if (!args[1].isInt() || args[1].asInt() <= 0) {
+            throw std::runtime_error("Read() byte count must be a positive integer");
+        }
+        count = static_cast<size_t>(args[1].asInt());
     }
 
-    std::cout << "[APP] App uninstalled successfully" << std::endl;
-    return Value::makeNil();
+    std::string data;
+    if (!nativeArg<FileHandle>(args[0], "Read", "file")->read(count, data)) {
+        return Value::makeNil();
+    }
+    return Value(std::move(data));
 }
 
-Value builtin_ClearAppData(const std::vector<Value>& args) {
+Value builtin_Write(const std::vector<Value>& args) {
     if (args.empty()) {
-        throw std::runtime_error("ClearAppData() requires 1 argument (package)");
+        throw std::runtime_error("Write() requires at least 1 argument (file)");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    auto file = nativeArg<FileHandle>(args[0], "Write", "file");
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i].isString()) {
+            file->write(args[i].asStringRef());
+        } else {
+            file->write(args[i].toString());
+        }
     }
+    return Value::makeNil();
+}
 
-    std::string package = args[0].asString();
-    std::cout << "[APP] ClearAppData(\"" << package << "\")" << std::endl;
-
-    auto result = g_adb_client.clearAppData(g_current_device_serial, package);
-    if (!result.success()) {
-        throw std::runtime_error("ClearAppData failed: " + result.error);
+Value builtin_Flush(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Flush() requires 1 argument (file)");
     }
 
-    std::cout << "[APP] App data cleared successfully" << std::endl;
+    nativeArg<FileHandle>(args[0], "Flush", "file")->flush();
     return Value::makeNil();
 }
 
-// Device File Operations
-
-Value builtin_PushFile(const std::vector<Value>& args) {
-    if (args.size() < 2) {
-        throw std::runtime_error("PushFile() requires 2 arguments (local_path, remote_path)");
+Value builtin_CsvRows(const std::vector<Value>& args) {
+    if (args.empty() || !args[0].isString()) {
+        throw std::runtime_error("CsvRows() requires a file path");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
-    }
+    bool header = args.size() < 2 || args[1].isTruthy();
+    return Value::makeNativeObject(std::make_shared<CsvRows>(args[0].asStringRef(), header));
+}
 
-    std::string local_path = args[0].asString();
-    std::string remote_path = args[1].asString();
+// UI Automation - Using real ADB commands
 
-    std::cout << "[FILE] PushFile(\"" << local_path << "\" -> \"" << remote_path << "\")" << std::endl;
+Value builtin_Tap(const std::vector<Value>& args) {
+    return currentDevice().tap(args);
+}
 
-    auto result = g_adb_client.push(g_current_device_serial, local_path, remote_path);
-    if (!result.success()) {
-        throw std::runtime_error("PushFile failed: " + result.error);
-    }
+Value builtin_Swipe(const std::vector<Value>& args) {
+    return currentDevice().swipe(args);
+}
 
-    std::cout << "[FILE] File pushed successfully" << std::endl;
-    return Value::makeNil();
+Value builtin_Input(const std::vector<Value>& args) {
+    return currentDevice().input(args);
 }
 
-Value builtin_PullFile(const std::vector<Value>& args) {
-    if (args.size() < 2) {
-        throw std::runtime_error("PullFile() requires 2 arguments (remote_path, local_path)");
+Value builtin_Screenshot(const std::vector<Value>& args) {
+    return currentDevice().screenshot(args);
+}
+
+Value builtin_KeyEvent(const std::vector<Value>& args) {
+    return currentDevice().keyEvent(args);
+}
+
+// App Management
+
+Value builtin_LaunchApp(const std::vector<Value>& args) {
+    return currentDevice().launchApp(args);
+}
+
+Value builtin_StopApp(const std::vector<Value>& args) {
+    return currentDevice().stopApp(args);
+}
+
+Value builtin_InstallApp(const std::vector<Value>& args) {
+    return currentDevice().installApp(args);
+}
+
+Value builtin_UninstallApp(const std::vector<Value>& args) {
+    return currentDevice().uninstallApp(args);
+}
+
+Value builtin_ClearAppData(const std::vector<Value>& args) {
+    return currentDevice().clearAppData(args);
+}
+
+// Native extensions
+
+Value builtin_LoadExtension(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("LoadExtension() requires 1 argument (library path)");
     }
 
-    if (g_current_device_serial.empty()) {
-        throw std::runtime_error("No device selected. Call Device() first.");
+    // Register into the globals of the calling script
+    Interpreter* interpreter = Interpreter::current();
+    if (!interpreter) {
+        throw std::runtime_error("LoadExtension() must be called from a script");
     }
 
-    std::string remote_path = args[0].asString();
-    std::string local_path = args[1].asString();
+    ValueArray names;
+    for (const auto& name : loadExtension(args[0].asString(), *interpreter->getGlobalEnvironment())) {
+        names.push_back(Value(name));
+    }
+    return Value::makeArray(names);
+}
 
-    std::cout << "[FILE] PullFile(\"" << remote_path << "\" -> \"" << local_path << "\")" << std::endl;
+// Device File Operations
 
-    auto result = g_adb_client.pull(g_current_device_serial, remote_path, local_path);
-    if (!result.success()) {
-        throw std::runtime_error("PullFile failed: " + result.error);
-    }
+Value builtin_PushFile(const std::vector<Value>& args) {
+    return currentDevice().pushFile(args);
+}
 
-    std::cout << "[FILE] File pulled successfully" << std::endl;
-    return Value::makeNil();
+Value builtin_PullFile(const std::vector<Value>& args) {
+    return currentDevice().pullFile(args);
 }
 
 } // namespace androidscript
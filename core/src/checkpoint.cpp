@@ -0,0 +1,669 @@
+#include "checkpoint.h"
+#include "ast.h"
+#include "device_session.h"
+#include "environment.h"
+#include "hash_table.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[8] = {'A', 'S', 'C', 'K', 'P', 'T', '1', '\n'};
+
+// Bounds recursion into nested (or self-containing) arrays and objects
+constexpr int kMaxDepth = 64;
+
+// Compact once the log is this many times the live state (plus some slack)
+constexpr uint64_t kCompactFactor = 4;
+constexpr uint64_t kCompactSlack = 1 << 20;
+
+// Value tags
+enum : uint8_t {
+    kNil, kFalse, kTrue, kInt, kFloat, kString, kArray, kObject, kMap, kSet, kDevice
+};
+
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+std::string readWholeFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Host byte order; checkpoints are resumed on the machine that wrote them
+template <typename T>
+void put(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+void putString(std::string& out, const std::string& text) {
+    put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+class Reader {
+public:
+    Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+    template <typename T>
+    T get() {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, p_, sizeof(T));
+        p_ += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t size = get<uint32_t>();
+        need(size);
+        std::string text(p_, size);
+        p_ += size;
+        return text;
+    }
+
+    // Skips one encoded value, returning its bytes
+    std::string getValueBytes();
+
+private:
+    const char* p_;
+    const char* end_;
+
+    void need(size_t size) const {
+        if (static_cast<size_t>(end_ - p_) < size) {
+            throw std::runtime_error("Corrupt checkpoint record");
+        }
+    }
+    void skipValue(int depth);
+};
+
+void Reader::skipValue(int depth) {
+    if (depth > kMaxDepth) throw std::runtime_error("Corrupt checkpoint record");
+    switch (get<uint8_t>()) {
+        case kNil: case kFalse: case kTrue: return;
+        case kInt: case kFloat: get<uint64_t>(); return;
+        case kString: getString(); return;
+        case kArray: case kSet: {
+            uint32_t count = get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) skipValue(depth + 1);
+            return;
+        }
+        case kObject: {
+            uint32_t count = get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) {
+                getString();
+                skipValue(depth + 1);
+            }
+            return;
+        }
+        case kMap: {
+            uint32_t count = get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) {
+                skipValue(depth + 1);
+                skipValue(depth + 1);
+            }
+            return;
+        }
+        case kDevice:
+            getString(); getString(); getString();
+            get<int32_t>(); get<int32_t>();
+            return;
+        default:
+            throw std::runtime_error("Corrupt checkpoint record");
+    }
+}
+
+std::string Reader::getValueBytes() {
+    const char* start = p_;
+    skipValue(0);
+    return std::string(start, p_);
+}
+
+// False if the value holds something that cannot be saved (functions,
+// native handles) or is nested too deeply
+bool encode(const Value& value, std::string& out, int depth) {
+    if (depth > kMaxDepth) return false;
+
+    switch (value.type()) {
+        case ValueType::NIL:
+            out += static_cast<char>(kNil);
+            return true;
+        case ValueType::BOOLEAN:
+            out += static_cast<char>(value.asBool() ? kTrue : kFalse);
+            return true;
+        case ValueType::INTEGER:
+            out += static_cast<char>(kInt);
+            put<int64_t>(out, value.asInt());
+            return true;
+        case ValueType::FLOAT:
+            out += static_cast<char>(kFloat);
+            put<double>(out, value.asFloat());
+            return true;
+        case ValueType::STRING:
+            out += static_cast<char>(kString);
+            putString(out, value.asStringRef());
+            return true;
+        case ValueType::ARRAY: {
+            out += static_cast<char>(kArray);
+            put<uint32_t>(out, static_cast<uint32_t>(value.asArray().size()));
+            for (const Value& item : value.asArray()) {
+                if (!encode(item, out, depth + 1)) return false;
+            }
+            return true;
+        }
+        case ValueType::OBJECT: {
+            out += static_cast<char>(kObject);
+            put<uint32_t>(out, static_cast<uint32_t>(value.asObject().size()));
+            for (const auto& field : value.asObject()) {
+                putString(out, field.first);
+                if (!encode(field.second, out, depth + 1)) return false;
+            }
+            return true;
+        }
+        case ValueType::MAP:
+        case ValueType::SET: {
+            bool is_map = value.isMap();
+            out += static_cast<char>(is_map ? kMap : kSet);
+            put<uint32_t>(out, static_cast<uint32_t>(value.asTable().size()));
+            bool ok = true;
+            value.asTable().forEach([&](const Value& key, const Value& item) {
+                ok = ok && encode(key, out, depth + 1);
+                if (is_map) ok = ok && encode(item, out, depth + 1);
+            });
+            return ok;
+        }
+        case ValueType::DEVICE: {
+            const DeviceRef& dev = value.asDevice();
+            out += static_cast<char>(kDevice);
+            putString(out, dev.serial);
+            putString(out, dev.model);
+            putString(out, dev.android_version);
+            put<int32_t>(out, dev.screen_width);
+            put<int32_t>(out, dev.screen_height);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+Value decode(Reader& in, int depth) {
+    if (depth > kMaxDepth) throw std::runtime_error("Corrupt checkpoint record");
+
+    switch (in.get<uint8_t>()) {
+        case kNil: return Value();
+        case kFalse: return Value(false);
+        case kTrue: return Value(true);
+        case kInt: return Value(in.get<int64_t>());
+        case kFloat: return Value(in.get<double>());
+        case kString: return Value(in.getString());
+        case kArray: {
+            uint32_t count = in.get<uint32_t>();
+            ValueArray items;
+            items.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) items.push_back(decode(in, depth + 1));
+            return Value::makeArray(std::move(items));
+        }
+        case kObject: {
+            uint32_t count = in.get<uint32_t>();
+            ValueMap fields;
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string key = in.getString();
+                fields.emplace(std::move(key), decode(in, depth + 1));
+            }
+            return Value::makeObject(std::move(fields));
+        }
+        case kMap: {
+            uint32_t count = in.get<uint32_t>();
+            Value map = Value::makeMap();
+            map.asTable().reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                Value key = decode(in, depth + 1);
+                map.asTable().put(key, decode(in, depth + 1));
+            }
+            return map;
+        }
+        case kSet: {
+            uint32_t count = in.get<uint32_t>();
+            Value set = Value::makeSet();
+            set.asTable().reserve(count);
+            for (uint32_t i = 0; i < count; ++i) set.asTable().put(decode(in, depth + 1), Value());
+            return set;
+        }
+        case kDevice: {
+            DeviceRef dev(in.getString());
+            dev.model = in.getString();
+            dev.android_version = in.getString();
+            dev.screen_width = in.get<int32_t>();
+            dev.screen_height = in.get<int32_t>();
+            dev.session = DeviceSession::attach(dev);
+            return Value::makeDevice(dev);
+        }
+        default:
+            throw std::runtime_error("Corrupt checkpoint record");
+    }
+}
+
+Value decodeBytes(const std::string& bytes) {
+    Reader in(bytes.data(), bytes.size());
+    return decode(in, 0);
+}
+
+// Saved ForEach iterables sort before every variable name
+std::string iterableName(size_t level) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "\x01%04u", static_cast<unsigned>(level));
+    return name;
+}
+
+bool isIterableName(const std::string& name) {
+    return !name.empty() && name[0] == '\x01';
+}
+
+bool saveable(const Value& value) {
+    return !value.isFunction() && !value.isNativeFunction() && !value.isNativeObject();
+}
+
+// Declarations re-run for statements skipped while resuming
+bool isDeclaration(const Statement* stmt) {
+    return dynamic_cast<const FunctionStmt*>(stmt) || dynamic_cast<const ImportStmt*>(stmt);
+}
+
+} // namespace
+
+std::unique_ptr<Checkpointer> Checkpointer::create(const std::string& path,
+                                                   const std::string& script_path) {
+    std::unique_ptr<Checkpointer> checkpointer(new Checkpointer());
+    checkpointer->path_ = path;
+    checkpointer->script_path_ = fs::absolute(script_path).string();
+    std::string source = readWholeFile(script_path);
+    checkpointer->script_hash_ = fnv1a(source.data(), source.size());
+
+    checkpointer->openForAppend("wb");
+    std::string header(kMagic, sizeof(kMagic));
+    putString(header, checkpointer->script_path_);
+    put<uint64_t>(header, checkpointer->script_hash_);
+    if (std::fwrite(header.data(), 1, header.size(), checkpointer->file_) != header.size() ||
+        std::fflush(checkpointer->file_) != 0) {
+        throw std::runtime_error("Cannot write checkpoint: " + path);
+    }
+    checkpointer->file_bytes_ = header.size();
+    return checkpointer;
+}
+
+std::unique_ptr<Checkpointer> Checkpointer::open(const std::string& path) {
+    std::string data = readWholeFile(path);
+    std::unique_ptr<Checkpointer> checkpointer(new Checkpointer());
+    checkpointer->path_ = path;
+
+    Reader header(data.data(), data.size());
+    try {
+        for (char c : kMagic) {
+            if (header.get<char>() != c) throw std::runtime_error("");
+        }
+        checkpointer->script_path_ = header.getString();
+        checkpointer->script_hash_ = header.get<uint64_t>();
+    } catch (const std::exception&) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    size_t offset = sizeof(kMagic) + 4 + checkpointer->script_path_.size() + 8;
+
+    std::string source = readWholeFile(checkpointer->script_path_);
+    if (fnv1a(source.data(), source.size()) != checkpointer->script_hash_) {
+        throw std::runtime_error("Script changed since the checkpoint was written: " +
+                                 checkpointer->script_path_);
+    }
+
+    // Replay records up to the first incomplete one (a write cut short by
+    // the crash)
+    while (data.size() - offset >= 12) {
+        uint32_t size;
+        uint64_t checksum;
+        std::memcpy(&size, data.data() + offset, 4);
+        std::memcpy(&checksum, data.data() + offset + 4, 8);
+        if (data.size() - offset - 12 < size) break;
+        const char* payload = data.data() + offset + 12;
+        if (fnv1a(payload, size) != checksum) break;
+
+        Reader in(payload, size);
+        uint32_t count = in.get<uint32_t>();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string name = in.getString();
+            if (in.get<uint8_t>()) {
+                checkpointer->saved_[name] = in.getValueBytes();
+            } else {
+                checkpointer->saved_.erase(name);
+            }
+        }
+        checkpointer->device_ = in.getString();
+        checkpointer->target_.assign(in.get<uint32_t>(), Frame());
+        for (Frame& frame : checkpointer->target_) {
+            frame.index = in.get<uint32_t>();
+            frame.in_loop = in.get<uint8_t>() != 0;
+            frame.iteration = in.get<uint64_t>();
+        }
+        offset += 12 + size;
+    }
+
+    for (const auto& entry : checkpointer->saved_) {
+        checkpointer->saved_bytes_ += entry.first.size() + entry.second.size();
+    }
+    checkpointer->resuming_ = !checkpointer->target_.empty();
+
+    // Drop a torn tail so new records follow the last good one
+    fs::resize_file(path, offset);
+    checkpointer->openForAppend("ab");
+    checkpointer->file_bytes_ = offset;
+
+    if (checkpointer->resuming_) {
+        std::cout << "[CHECKPOINT] Resuming " << checkpointer->script_path_ << " at statement "
+                  << checkpointer->target_[0].index + 1;
+        if (checkpointer->target_.back().in_loop) {
+            std::cout << ", loop iteration " << checkpointer->target_.back().iteration + 1;
+        }
+        std::cout << std::endl;
+    }
+    return checkpointer;
+}
+
+Checkpointer::~Checkpointer() {
+    if (file_) std::fclose(file_);
+}
+
+void Checkpointer::attach(std::shared_ptr<Environment> globals) {
+    globals_ = std::move(globals);
+}
+
+void Checkpointer::finish() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    std::remove(path_.c_str());
+}
+
+void Checkpointer::enterList() {
+    live_.emplace_back();
+}
+
+void Checkpointer::leaveList() {
+    live_.pop_back();
+}
+
+bool Checkpointer::beginStatement(size_t index, Statement* stmt) {
+    size_t level = live_.size() - 1;
+    Frame& frame = live_[level];
+    frame = Frame();
+    frame.statement = stmt;
+    frame.index = static_cast<uint32_t>(index);
+
+    if (!resuming_) {
+        if (level == 0) save();
+        return true;
+    }
+
+    // Fast-forward along the saved path
+    const Frame& target = target_[level];
+    if (index < target.index) {
+        return isDeclaration(stmt);
+    }
+    if (level == 0) {
+        restore();
+    }
+    if (index > target.index || (level + 1 == target_.size() && !target.in_loop)) {
+        resuming_ = false;
+    }
+    return true;
+}
+
+bool Checkpointer::enterLoop(const Statement* loop) {
+    // Only the statement currently running at the innermost safe level
+    if (live_.empty() || live_.back().statement != loop || live_.back().in_loop) {
+        return false;
+    }
+    live_.back().in_loop = true;
+    return true;
+}
+
+void Checkpointer::setIterable(const Value& iterable) {
+    live_.back().iterable = iterable;
+}
+
+void Checkpointer::beginIteration() {
+    Frame& frame = live_.back();
+    frame.iteration = frame.started++;
+    if (!resuming_) save();
+}
+
+void Checkpointer::leaveLoop() {
+    Frame& frame = live_.back();
+    frame.in_loop = false;
+    frame.iterable = Value();
+}
+
+Value Checkpointer::savedIterable() const {
+    auto it = saved_.find(iterableName(live_.size() - 1));
+    return it == saved_.end() ? Value() : decodeBytes(it->second);
+}
+
+void Checkpointer::restore() {
+    for (const auto& entry : saved_) {
+        if (!isIterableName(entry.first)) {
+            globals_->define(entry.first, decodeBytes(entry.second));
+        }
+    }
+    if (!device_.empty()) {
+        selectDevice(DeviceSession::connect(device_));
+    }
+}
+
+void Checkpointer::save() {
+    std::string vars;
+    uint32_t changed = 0;
+    std::string scratch;
+
+    auto it = saved_.begin();
+    auto removeUntil = [&](const std::string* name) {
+        while (it != saved_.end() && (!name || it->first < *name)) {
+            putString(vars, it->first);
+            vars += '\0';
+            saved_bytes_ -= it->first.size() + it->second.size();
+            it = saved_.erase(it);
+            changed++;
+        }
+    };
+    auto keep = [&](const std::string& name) {
+        removeUntil(&name);
+        if (it != saved_.end() && it->first == name) ++it;
+    };
+    auto offer = [&](const std::string& name, const std::string& bytes) {
+        removeUntil(&name);
+        if (it != saved_.end() && it->first == name) {
+            if (it->second == bytes) {
+                ++it;
+                return;
+            }
+            saved_bytes_ += bytes.size() - it->second.size();
+            it->second = bytes;
+            ++it;
+        } else {
+            saved_bytes_ += name.size() + bytes.size();
+            it = std::next(saved_.emplace_hint(it, name, bytes));
+        }
+        putString(vars, name);
+        vars += '\1';
+        vars += bytes;
+        changed++;
+    };
+
+    // ForEach iterables first (their names sort first), then globals
+    for (size_t level = 0; level < live_.size(); ++level) {
+        Frame& frame = live_[level];
+        if (!frame.in_loop || !frame.iterable.isArray()) continue;
+        std::string name = iterableName(level);
+
+        // Re-encoded only when the array was replaced or resized, so long
+        // ForEach loops do not pay for their whole array every iteration
+        const ValueArray* array = &frame.iterable.asArray();
+        if (array == frame.encoded_array && array->size() == frame.encoded_size) {
+            keep(name);
+            continue;
+        }
+        scratch.clear();
+        if (!encode(frame.iterable, scratch, 0)) {
+            keep(name);  // Keep the last good copy
+            continue;
+        }
+        frame.encoded_array = array;
+        frame.encoded_size = array->size();
+        offer(name, scratch);
+    }
+    for (const auto& var : globals_->variables()) {
+        if (!saveable(var.second)) continue;
+        scratch.clear();
+        if (!encode(var.second, scratch, 0)) continue;
+        offer(var.first, scratch);
+    }
+    removeUntil(nullptr);
+
+    std::string payload;
+    put<uint32_t>(payload, changed);
+    payload += vars;
+    auto device = selectedDevice();
+    device_ = device ? device->serial() : std::string();
+    putString(payload, device_);
+    put<uint32_t>(payload, static_cast<uint32_t>(live_.size()));
+    for (const Frame& frame : live_) {
+        put<uint32_t>(payload, frame.index);
+        payload += static_cast<char>(frame.in_loop ? 1 : 0);
+        put<uint64_t>(payload, frame.iteration);
+    }
+    writeRecord(payload);
+
+    if (file_bytes_ > kCompactFactor * saved_bytes_ + kCompactSlack) {
+        compact();
+    }
+}
+
+void Checkpointer::writeRecord(const std::string& payload) {
+    std::string record;
+    put<uint32_t>(record, static_cast<uint32_t>(payload.size()));
+    put<uint64_t>(record, fnv1a(payload.data(), payload.size()));
+    record += payload;
+    if (std::fwrite(record.data(), 1, record.size(), file_) != record.size() ||
+        std::fflush(file_) != 0) {
+        throw std::runtime_error("Cannot write checkpoint: " + path_);
+    }
+    file_bytes_ += record.size();
+}
+
+// Rewrite the log as a single record holding the live state, replacing the
+// old file atomically
+void Checkpointer::compact() {
+    std::string payload;
+    put<uint32_t>(payload, static_cast<uint32_t>(saved_.size()));
+    for (const auto& entry : saved_) {
+        putString(payload, entry.first);
+        payload += '\1';
+        payload += entry.second;
+    }
+    putString(payload, device_);
+    put<uint32_t>(payload, static_cast<uint32_t>(live_.size()));
+    for (const Frame& frame : live_) {
+        put<uint32_t>(payload, frame.index);
+        payload += static_cast<char>(frame.in_loop ? 1 : 0);
+        put<uint64_t>(payload, frame.iteration);
+    }
+
+    std::string final_path = path_;
+    std::fclose(file_);
+    file_ = nullptr;
+    path_ = final_path + ".tmp";
+    openForAppend("wb");
+    std::string header(kMagic, sizeof(kMagic));
+    putString(header, script_path_);
+    put<uint64_t>(header, script_hash_);
+    if (std::fwrite(header.data(), 1, header.size(), file_) != header.size()) {
+        throw std::runtime_error("Cannot write checkpoint: " + path_);
+    }
+    file_bytes_ = header.size();
+    writeRecord(payload);
+    std::fclose(file_);
+    file_ = nullptr;
+
+    fs::rename(path_, final_path);
+    path_ = final_path;
+    openForAppend("ab");
+}
+
+void Checkpointer::openForAppend(const char* mode) {
+    file_ = std::fopen(path_.c_str(), mode);
+    if (!file_) {
+        throw std::runtime_error("Cannot write checkpoint: " + path_);
+    }
+}
+
+// CheckpointLoop
+
+CheckpointLoop::CheckpointLoop(Checkpointer* checkpointer, const Statement& loop)
+    : checkpointer_(checkpointer),
+      active_(checkpointer && checkpointer->enterLoop(&loop)),
+      inside_(false),
+      resume_iterations_(kNotResuming) {
+    if (!active_ || !checkpointer_->resuming_) return;
+
+    size_t level = checkpointer_->live_.size() - 1;
+    const Checkpointer::Frame& target = checkpointer_->target_[level];
+    resume_iterations_ = target.iteration;
+    inside_ = level + 1 < checkpointer_->target_.size();
+    checkpointer_->live_[level].started = target.iteration;
+    if (!inside_) {
+        checkpointer_->resuming_ = false;
+    }
+}
+
+CheckpointLoop::~CheckpointLoop() {
+    if (active_) checkpointer_->leaveLoop();
+}
+
+Value CheckpointLoop::iterable(const std::function<Value()>& evaluate) {
+    Value value;
+    if (resuming()) {
+        value = checkpointer_->savedIterable();
+    }
+    if (value.isNil()) {
+        value = evaluate();
+    }
+    if (!active_) return value;
+
+    std::string scratch;
+    if (!value.isArray() || !encode(value, scratch, 0)) {
+        // Not resumable; loops inside it are not safe points either
+        checkpointer_->leaveLoop();
+        active_ = false;
+        return value;
+    }
+    checkpointer_->setIterable(value);
+    return value;
+}
+
+} // namespace androidscript
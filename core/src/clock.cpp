@@ -0,0 +1,64 @@
+#include "clock.h"
+#include <atomic>
+#include <chrono>
+
+namespace androidscript {
+
+namespace {
+
+std::atomic<bool> g_virtual{false};
+std::atomic<int64_t> g_virtual_now{0};  // Monotonic ms
+int64_t g_virtual_start = 0;            // Monotonic ms at enableVirtual()
+int64_t g_epoch_offset = 0;             // Epoch ms minus monotonic ms
+
+int64_t realMonotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t realEpochMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+int64_t Clock::monotonicMs() {
+    if (g_virtual.load(std::memory_order_relaxed)) {
+        return g_virtual_now.load();
+    }
+    return realMonotonicMs();
+}
+
+int64_t Clock::epochMs() {
+    if (g_virtual.load(std::memory_order_relaxed)) {
+        return g_virtual_now.load() + g_epoch_offset;
+    }
+    return realEpochMs();
+}
+
+void Clock::enableVirtual() {
+    g_virtual_start = realMonotonicMs();
+    g_epoch_offset = realEpochMs() - g_virtual_start;
+    g_virtual_now = g_virtual_start;
+    g_virtual = true;
+}
+
+bool Clock::isVirtual() {
+    return g_virtual.load(std::memory_order_relaxed);
+}
+
+void Clock::advanceTo(int64_t monotonic_ms) {
+    if (!isVirtual()) return;
+
+    int64_t current = g_virtual_now.load();
+    while (monotonic_ms > current &&
+           !g_virtual_now.compare_exchange_weak(current, monotonic_ms)) {
+    }
+}
+
+int64_t Clock::virtualElapsedMs() {
+    return isVirtual() ? g_virtual_now.load() - g_virtual_start : 0;
+}
+
+} // namespace androidscript
@@ -0,0 +1,69 @@
+#include "coverage.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace androidscript {
+
+LineCoverage::LineCoverage(const std::vector<std::unique_ptr<Statement>>& program) {
+    for (const Statement* stmt : collectStatements(program)) {
+        index_.emplace(stmt, lines_.size());
+        lines_.push_back(stmt->line);
+    }
+    counts_.assign(lines_.size(), 0);
+}
+
+void LineCoverage::onStatement(Interpreter& /* interpreter */, Statement& stmt) {
+    auto it = index_.find(&stmt);
+    if (it != index_.end()) {
+        counts_[it->second]++;
+    }
+}
+
+std::vector<int64_t> LineCoverage::lineCounts() const {
+    int last = lines_.empty() ? 0 : *std::max_element(lines_.begin(), lines_.end());
+    std::vector<int64_t> counts(static_cast<size_t>(last) + 1, -1);
+    for (size_t i = 0; i < lines_.size(); ++i) {
+        int64_t& count = counts[static_cast<size_t>(lines_[i])];
+        count = std::max(count, static_cast<int64_t>(counts_[i]));
+    }
+    return counts;
+}
+
+size_t LineCoverage::linesFound() const {
+    auto counts = lineCounts();
+    return static_cast<size_t>(std::count_if(counts.begin(), counts.end(),
+                                             [](int64_t c) { return c >= 0; }));
+}
+
+size_t LineCoverage::linesHit() const {
+    auto counts = lineCounts();
+    return static_cast<size_t>(std::count_if(counts.begin(), counts.end(),
+                                             [](int64_t c) { return c > 0; }));
+}
+
+void LineCoverage::writeReport(std::ostream& out, const std::string& source) const {
+    auto counts = lineCounts();
+    std::istringstream in(source);
+    std::string text;
+    for (size_t line = 1; std::getline(in, text); ++line) {
+        int64_t count = line < counts.size() ? counts[line] : -1;
+        out << std::setw(9);
+        if (count < 0) {
+            out << "-";
+        } else if (count == 0) {
+            out << "#####";
+        } else {
+            out << count;
+        }
+        out << ":" << std::setw(5) << line << ":" << text << "\n";
+    }
+
+    size_t found = linesFound();
+    size_t hit = linesHit();
+    out << "Lines executed: " << std::fixed << std::setprecision(2)
+        << (found ? 100.0 * static_cast<double>(hit) / static_cast<double>(found) : 100.0)
+        << "% of " << found << "\n";
+}
+
+} // namespace androidscript
@@ -0,0 +1,542 @@
+#include "cpp_emitter.h"
+#include "module.h"
+#include "number_format.h"
+#include <cctype>
+#include <cstdio>
+
+namespace androidscript {
+
+CppEmitter::CppEmitter()
+    : out_(nullptr), indent_(0), loop_depth_(0), in_function_(0), counter_(0) {}
+
+std::string CppEmitter::emit(const std::vector<std::unique_ptr<Statement>>& program,
+                             const std::string& source_name) {
+    std::ostringstream main_body;
+    out_ = &main_body;
+    env_ = "global";
+    indent_ = 1;
+
+    try {
+        import_stack_.assign(1, ModuleCache::resolve(source_name, ""));
+    } catch (const std::exception&) {
+        // Not a file on disk; imports resolve against the working directory
+        import_stack_.clear();
+    }
+
+    // Each top-level statement gets its own error boundary, like
+    // Interpreter::execute()
+    for (const auto& stmt : program) {
+        if (!stmt) continue;
+        line("aot::runStatement(errors, [&]() {");
+        indent_++;
+        statement(stmt.get());
+        indent_--;
+        line("});");
+    }
+
+    std::ostringstream result;
+    result << "// Generated by androidscript --emit-cpp from " << source_name << "\n";
+    result << "// Link against androidscript-core and androidscript-bridge\n\n";
+    result << "#include \"aot_runtime.h\"\n\n";
+    result << "using namespace androidscript;\n\n";
+    result << "namespace {\n\n";
+    result << "// Literals\n";
+    result << constants_.str() << "\n";
+    if (!module_functions_.empty()) {
+        result << "// Module state\n";
+        result << module_state_.str() << "\n";
+    }
+    result << "// Script functions\n";
+    result << functions_.str();
+    result << "} // namespace\n\n";
+    result << "int main() {\n";
+    result << "    Interpreter interpreter;\n";
+    result << "    registerBuiltins(interpreter);\n";
+    result << "    std::shared_ptr<Environment> global = interpreter.getGlobalEnvironment();\n";
+    result << "    std::vector<std::string> errors;\n\n";
+    result << main_body.str();
+    result << "\n    return aot::finish(errors);\n";
+    result << "}\n";
+    return result.str();
+}
+
+// Helpers
+
+std::string CppEmitter::expression(Expression* expr) {
+    if (!expr) return "Value()";
+    expr->accept(*this);
+    return expr_;
+}
+
+void CppEmitter::statement(Statement* stmt) {
+    if (stmt) {
+        stmt->accept(*this);
+    }
+}
+
+void CppEmitter::line(const std::string& text) {
+    *out_ << std::string(indent_ * 4, ' ') << text << "\n";
+}
+
+std::string CppEmitter::newName(const std::string& prefix) {
+    return prefix + std::to_string(counter_++);
+}
+
+std::string CppEmitter::newScope() {
+    std::string name = newName("env");
+    line("auto " + name + " = std::make_shared<Environment>(" + env_ + ");");
+    env_ = name;
+    return name;
+}
+
+std::string CppEmitter::constant(const std::string& initializer) {
+    // Values are immutable once built, so identical literals share one
+    auto it = constant_names_.find(initializer);
+    if (it != constant_names_.end()) {
+        return it->second;
+    }
+
+    std::string name = newName("k");
+    constants_ << "const Value " << name << " = " << initializer << ";\n";
+    constant_names_[initializer] = name;
+    return name;
+}
+
+// C++ function running a module's top-level statements in a given scope,
+// emitted on first use. Empty if the module cannot be loaded.
+std::string CppEmitter::moduleFunction(const std::string& path) {
+    auto it = module_functions_.find(path);
+    if (it != module_functions_.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<const Module> module;
+    try {
+        module = ModuleCache::instance().load(path);
+    } catch (const std::exception& e) {
+        reportError(e.what());
+        return "";
+    }
+
+    std::string name = newName("module");
+    module_functions_[path] = name;
+    module_state_ << "std::set<const Environment*> " << name << "_included;\n";
+    module_state_ << "std::shared_ptr<Environment> " << name << "_scope;\n";
+    module_state_ << "Value " << name << "_exports;\n";
+
+    // Same save/restore as FunctionStmt; top-level return, break and
+    // continue in the module throw like they do in the main script
+    std::ostringstream body;
+    std::ostringstream* saved_out = out_;
+    std::string saved_env = env_;
+    int saved_indent = indent_;
+    int saved_loop_depth = loop_depth_;
+    int saved_in_function = in_function_;
+
+    out_ = &body;
+    indent_ = 0;
+    loop_depth_ = 0;
+    in_function_ = 0;
+    env_ = "scope";
+    import_stack_.push_back(path);
+
+    line("// " + path);
+    line("void " + name + "(const std::shared_ptr<Environment>& scope) {");
+    indent_++;
+    for (const auto& stmt : module->program) {
+        statement(stmt.get());
+    }
+    indent_--;
+    line("}");
+    line("");
+
+    import_stack_.pop_back();
+    out_ = saved_out;
+    env_ = saved_env;
+    indent_ = saved_indent;
+    loop_depth_ = saved_loop_depth;
+    in_function_ = saved_in_function;
+    functions_ << body.str();
+    return name;
+}
+
+void CppEmitter::reportError(const std::string& message) {
+    errors_.push_back("Emitter error: " + message);
+}
+
+std::string CppEmitter::quote(const std::string& text) {
+    std::string result = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            case '\r': result += "\\r"; break;
+            default:
+                if (c < 0x20 || c >= 0x7f) {
+                    // Fixed-width octal cannot swallow following digits
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\%03o", c);
+                    result += buf;
+                } else {
+                    result += static_cast<char>(c);
+                }
+        }
+    }
+    return result + "\"";
+}
+
+// Expression visitors
+
+void CppEmitter::visit(BinaryExpr& expr) {
+    std::string left = expression(expr.left.get());
+    std::string right = expression(expr.right.get());
+
+    const char* op = nullptr;
+    switch (expr.op.type) {
+        case TokenType::PLUS: op = "add"; break;
+        case TokenType::MINUS: op = "sub"; break;
+        case TokenType::MULTIPLY: op = "mul"; break;
+        case TokenType::DIVIDE: op = "div"; break;
+        case TokenType::MODULO: op = "mod"; break;
+        case TokenType::EQUAL: op = "eq"; break;
+        case TokenType::NOT_EQUAL: op = "ne"; break;
+        case TokenType::LESS: op = "lt"; break;
+        case TokenType::LESS_EQUAL: op = "le"; break;
+        case TokenType::GREATER: op = "gt"; break;
+        case TokenType::GREATER_EQUAL: op = "ge"; break;
+        case TokenType::LOGICAL_AND: op = "logicalAnd"; break;
+        case TokenType::LOGICAL_OR: op = "logicalOr"; break;
+        default:
+            reportError("Unknown binary operator '" + expr.op.lexeme + "'");
+            expr_ = "Value()";
+            return;
+    }
+
+    expr_ = std::string("aot::") + op + "({" + left + ", " + right + "})";
+}
+
+void CppEmitter::visit(UnaryExpr& expr) {
+    std::string operand = expression(expr.operand.get());
+
+    switch (expr.op.type) {
+        case TokenType::MINUS:
+            expr_ = "(-" + operand + ")";
+            break;
+        case TokenType::LOGICAL_NOT:
+            expr_ = "(!" + operand + ")";
+            break;
+        default:
+            reportError("Unknown unary operator '" + expr.op.lexeme + "'");
+            expr_ = "Value()";
+    }
+}
+
+void CppEmitter::visit(LiteralExpr& expr) {
+    switch (expr.value.type) {
+        case TokenType::TRUE:
+            expr_ = "Value(true)";
+            break;
+        case TokenType::FALSE:
+            expr_ = "Value(false)";
+            break;
+        case TokenType::INTEGER:
+            expr_ = constant("Value(static_cast<int64_t>(" +
+                             std::to_string(expr.value.int_value) + "LL))");
+            break;
+        case TokenType::FLOAT: {
+            expr_ = constant("Value(static_cast<double>(" +
+                             formatFloat(expr.value.float_value) + "))");
+            break;
+        }
+        case TokenType::STRING:
+            expr_ = constant("Value(std::string(" + quote(expr.value.lexeme) + ", " +
+                             std::to_string(expr.value.lexeme.size()) + "))");
+            break;
+        default:
+            expr_ = "Value()";
+    }
+}
+
+void CppEmitter::visit(VariableExpr& expr) {
+    expr_ = env_ + "->get(" + quote(expr.name.lexeme) + ")";
+}
+
+void CppEmitter::visit(CallExpr& expr) {
+    std::string callee = expression(expr.callee.get());
+    std::string args;
+    for (const auto& arg : expr.arguments) {
+        if (!args.empty()) args += ", ";
+        args += expression(arg.get());
+    }
+
+    if (expr.named_args.empty()) {
+        expr_ = "aot::call({" + callee + ", {" + args + "}})";
+        return;
+    }
+
+    // Each site gets its own binding cache, as in the interpreter
+    std::string names;
+    for (const auto& arg : expr.named_args) {
+        if (!args.empty()) args += ", ";
+        args += expression(arg.second.get());
+        if (!names.empty()) names += ", ";
+        names += quote(arg.first);
+    }
+    std::string callee_name;
+    if (auto* variable = dynamic_cast<VariableExpr*>(expr.callee.get())) {
+        callee_name = variable->name.lexeme;
+    }
+    std::string cache = newName("named");
+    constants_ << "const NamedArgCache " << cache << "(std::vector<std::string>{" << names << "}, "
+               << expr.arguments.size() << ", " << quote(callee_name) << ");\n";
+    expr_ = "aot::callNamed(" + cache + ", {" + callee + ", {" + args + "}})";
+}
+
+void CppEmitter::visit(ArrayExpr& expr) {
+    std::string elements;
+    for (const auto& elem : expr.elements) {
+        if (!elements.empty()) elements += ", ";
+        elements += expression(elem.get());
+    }
+    expr_ = "aot::makeArray({" + elements + "})";
+}
+
+void CppEmitter::visit(MemberExpr& expr) {
+    std::string object = expression(expr.object.get());
+    expr_ = "Interpreter::getMember(" + object + ", " + quote(expr.member.lexeme) + ")";
+}
+
+void CppEmitter::visit(IndexExpr& expr) {
+    std::string object = expression(expr.object.get());
+    std::string index = expression(expr.index.get());
+    expr_ = "aot::index({" + object + ", " + index + "})";
+}
+
+// Statement visitors
+
+void CppEmitter::visit(ExpressionStmt& stmt) {
+    line("(void)" + expression(stmt.expression.get()) + ";");
+}
+
+void CppEmitter::visit(AssignmentStmt& stmt) {
+    std::string value = expression(stmt.value.get());
+    line(env_ + "->assign(" + quote(stmt.variable.lexeme) + ", " + value + ");");
+}
+
+void CppEmitter::visit(BlockStmt& stmt) {
+    std::string saved_env = env_;
+    line("{");
+    indent_++;
+    newScope();
+    for (const auto& s : stmt.statements) {
+        statement(s.get());
+    }
+    indent_--;
+    line("}");
+    env_ = saved_env;
+}
+
+void CppEmitter::visit(IfStmt& stmt) {
+    line("if (" + expression(stmt.condition.get()) + ".isTruthy()) {");
+    indent_++;
+    statement(stmt.then_branch.get());
+    indent_--;
+    if (stmt.else_branch) {
+        line("} else {");
+        indent_++;
+        statement(stmt.else_branch.get());
+        indent_--;
+    }
+    line("}");
+}
+
+void CppEmitter::visit(WhileStmt& stmt) {
+    line("while (" + expression(stmt.condition.get()) + ".isTruthy()) {");
+    indent_++;
+    loop_depth_++;
+    statement(stmt.body.get());
+    loop_depth_--;
+    indent_--;
+    line("}");
+}
+
+void CppEmitter::visit(ForStmt& stmt) {
+    std::string saved_env = env_;
+    line("{");
+    indent_++;
+    newScope();
+
+    statement(stmt.initializer.get());
+
+    // The increment runs after the body and after `continue`, exactly like
+    // the third clause of a C++ for loop
+    std::string increment = newName("increment");
+    line("auto " + increment + " = [&]() {");
+    indent_++;
+    statement(stmt.increment.get());
+    indent_--;
+    line("};");
+
+    std::string condition = stmt.condition
+        ? expression(stmt.condition.get()) + ".isTruthy()"
+        : "true";
+    line("for (; " + condition + "; " + increment + "()) {");
+    indent_++;
+    loop_depth_++;
+    statement(stmt.body.get());
+    loop_depth_--;
+    indent_--;
+    line("}");
+
+    indent_--;
+    line("}");
+    env_ = saved_env;
+}
+
+void CppEmitter::visit(ForEachStmt& stmt) {
+    std::string saved_env = env_;
+    std::string cursor = newName("cursor");
+    std::string item = newName("item");
+
+    line("{");
+    indent_++;
+    line("ForEachCursor " + cursor + "(" + expression(stmt.iterable.get()) + ");");
+    line("Value " + item + ";");
+    line("while (" + cursor + ".next(" + item + ")) {");
+    indent_++;
+    newScope();
+    line(env_ + "->define(" + quote(stmt.variable.lexeme) + ", " + item + ");");
+    loop_depth_++;
+    statement(stmt.body.get());
+    loop_depth_--;
+    indent_--;
+    line("}");
+    indent_--;
+    line("}");
+    env_ = saved_env;
+}
+
+void CppEmitter::visit(FunctionStmt& stmt) {
+    std::string name = newName("fn");
+    for (char c : stmt.name.lexeme) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            name += c;
+        }
+    }
+
+    // Emit the body as a separate C++ function; nested functions are
+    // written to functions_ first, so they are always defined before use
+    std::ostringstream body;
+    std::ostringstream* saved_out = out_;
+    std::string saved_env = env_;
+    int saved_indent = indent_;
+    int saved_loop_depth = loop_depth_;
+
+    out_ = &body;
+    indent_ = 0;
+    loop_depth_ = 0;
+    in_function_++;
+
+    line("Value " + name + "(const std::vector<Value>& args, const std::shared_ptr<Environment>& closure) {");
+    indent_++;
+    line("aot::checkArity(args, " + std::to_string(stmt.parameters.size()) + ");");
+    env_ = "closure";
+    newScope();
+    for (size_t i = 0; i < stmt.parameters.size(); ++i) {
+        line(env_ + "->define(" + quote(stmt.parameters[i].lexeme) + ", args[" + std::to_string(i) + "]);");
+    }
+    statement(stmt.body.get());
+    line("return Value();");
+    indent_--;
+    line("}");
+    line("");
+
+    in_function_--;
+    out_ = saved_out;
+    env_ = saved_env;
+    indent_ = saved_indent;
+    loop_depth_ = saved_loop_depth;
+    functions_ << body.str();
+
+    std::string parameters;
+    for (const auto& param : stmt.parameters) {
+        if (!parameters.empty()) parameters += ", ";
+        parameters += quote(param.lexeme);
+    }
+    line(env_ + "->define(" + quote(stmt.name.lexeme) + ", aot::makeFunction(&" + name + ", " + env_ +
+         ", {" + parameters + "}));");
+}
+
+void CppEmitter::visit(ReturnStmt& stmt) {
+    std::string value = stmt.value ? expression(stmt.value.get()) : "Value()";
+    if (in_function_ > 0) {
+        line("return " + value + ";");
+    } else {
+        line("throw ReturnException(" + value + ");");
+    }
+}
+
+void CppEmitter::visit(BreakStmt&) {
+    line(loop_depth_ > 0 ? "break;" : "throw BreakException();");
+}
+
+void CppEmitter::visit(ContinueStmt&) {
+    line(loop_depth_ > 0 ? "continue;" : "throw ContinueException();");
+}
+
+void CppEmitter::visit(ImportStmt& stmt) {
+    std::string from_dir;
+    if (!import_stack_.empty()) {
+        size_t slash = import_stack_.back().find_last_of("/\\");
+        if (slash != std::string::npos) from_dir = import_stack_.back().substr(0, slash);
+    }
+
+    std::string path;
+    try {
+        path = ModuleCache::resolve(stmt.path.lexeme, from_dir);
+    } catch (const std::exception& e) {
+        reportError(e.what());
+        return;
+    }
+
+    for (const auto& importer : import_stack_) {
+        if (importer == path) {
+            reportError("Import cycle through " + path);
+            return;
+        }
+    }
+
+    std::string module = moduleFunction(path);
+    if (module.empty()) return;
+
+    // Once per top-level scope and once per program, like the interpreter
+    if (stmt.isInclude()) {
+        std::string target = newName("target");
+        line("auto " + target + " = aot::root(" + env_ + ");");
+        line("if (" + module + "_included.insert(" + target + ".get()).second) {");
+        indent_++;
+        line(module + "(" + target + ");");
+        indent_--;
+        line("}");
+        return;
+    }
+
+    std::string scope = newName("scope");
+    line("if (!" + module + "_scope) {");
+    indent_++;
+    line("auto " + scope + " = makeModuleScope(" + env_ + ");");
+    line(module + "(" + scope + ");");
+    line(module + "_exports = moduleExports(*" + scope + ", *" + env_ + ");");
+    line(module + "_scope = " + scope + ";");
+    indent_--;
+    line("}");
+
+    std::string name = stmt.alias.type == TokenType::IDENTIFIER
+        ? stmt.alias.lexeme
+        : defaultModuleName(path);
+    line(env_ + "->define(" + quote(name) + ", " + module + "_exports);");
+}
+
+} // namespace androidscript
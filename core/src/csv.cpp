@@ -0,0 +1,129 @@
+#include "csv.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Parsed pages are released in steps of this many bytes
+constexpr size_t kDiscardStep = 4 << 20;
+
+} // namespace
+
+CsvRows::CsvRows(const std::string& path, bool header)
+    : file_(path), path_(path), pos_(0), discarded_(0), line_(1), record_line_(1), has_header_(header),
+      field_count_(0) {
+    // Skip a UTF-8 byte order mark
+    if (file_.data().substr(0, 3) == "\xEF\xBB\xBF") {
+        pos_ = 3;
+    }
+
+    if (has_header_ && readRecord()) {
+        columns_.assign(fields_.begin(), fields_.begin() + static_cast<std::ptrdiff_t>(field_count_));
+    }
+}
+
+bool CsvRows::next(Value& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!readRecord()) return false;
+    if (pos_ >= discarded_ + kDiscardStep) {
+        file_.discardBefore(pos_);
+        discarded_ = pos_;
+    }
+
+    if (!has_header_) {
+        ValueArray row;
+        row.reserve(field_count_);
+        for (size_t i = 0; i < field_count_; ++i) {
+            row.emplace_back(std::move(fields_[i]));
+        }
+        item = Value::makeArray(std::move(row));
+        return true;
+    }
+
+    if (field_count_ > columns_.size()) {
+        fail("row has " + std::to_string(field_count_) + " fields but the header has " +
+             std::to_string(columns_.size()), record_line_);
+    }
+
+    ValueMap row;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        row[columns_[i]] = i < field_count_ ? Value(std::move(fields_[i])) : Value::makeNil();
+    }
+    item = Value::makeObject(std::move(row));
+    return true;
+}
+
+// Parse the next record into fields_[0, field_count_); false at end of file
+bool CsvRows::readRecord() {
+    std::string_view text = file_.data();
+    size_t n = text.size();
+
+    // Blank lines
+    while (pos_ < n && (text[pos_] == '\n' || text[pos_] == '\r')) {
+        if (text[pos_] == '\n') ++line_;
+        ++pos_;
+    }
+    if (pos_ >= n) return false;
+
+    record_line_ = line_;
+    size_t count = 0;
+    while (true) {
+        if (count == fields_.size()) fields_.emplace_back();
+        std::string& field = fields_[count++];
+        field.clear();
+
+        if (pos_ < n && text[pos_] == '"') {
+            ++pos_;
+            while (true) {
+                const void* quote = std::memchr(text.data() + pos_, '"', n - pos_);
+                if (!quote) fail("unterminated quoted field", record_line_);
+                size_t end = static_cast<size_t>(static_cast<const char*>(quote) - text.data());
+
+                std::string_view chunk = text.substr(pos_, end - pos_);
+                line_ += static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+                field.append(chunk.data(), chunk.size());
+                pos_ = end + 1;
+
+                // "" inside quotes is a literal quote
+                if (pos_ < n && text[pos_] == '"') {
+                    field += '"';
+                    ++pos_;
+                    continue;
+                }
+                break;
+            }
+            if (pos_ < n && text[pos_] != ',' && text[pos_] != '\n' && text[pos_] != '\r') {
+                fail("unexpected character after quoted field", line_);
+            }
+        } else {
+            size_t end = pos_;
+            while (end < n && text[end] != ',' && text[end] != '\n' && text[end] != '\r') ++end;
+            field.assign(text.data() + pos_, end - pos_);
+            pos_ = end;
+        }
+
+        if (pos_ >= n) break;
+        if (text[pos_] == ',') {
+            ++pos_;
+            continue;
+        }
+
+        // End of record: "\n", "\r\n" or a lone "\r"
+        if (text[pos_] == '\r') ++pos_;
+        if (pos_ < n && text[pos_] == '\n') ++pos_;
+        ++line_;
+        break;
+    }
+
+    field_count_ = count;
+    return true;
+}
+
+void CsvRows::fail(const std::string& message, size_t line) const {
+    throw std::runtime_error(path_ + ": CSV error on line " + std::to_string(line) + ": " + message);
+}
+
+} // namespace androidscript
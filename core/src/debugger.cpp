@@ -0,0 +1,150 @@
+#include "debugger.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <sstream>
+
+namespace androidscript {
+
+Debugger::Debugger(const std::vector<std::unique_ptr<Statement>>& program,
+                   const std::string& source, std::istream& in, std::ostream& out)
+    : in_(in), out_(out) {
+    std::istringstream lines(source);
+    std::string text;
+    while (std::getline(lines, text)) {
+        source_.push_back(text);
+    }
+
+    for (const Statement* stmt : collectStatements(program)) {
+        own_.insert(stmt);
+        first_on_line_.emplace(stmt->line, stmt);
+    }
+}
+
+void Debugger::onStatement(Interpreter& interpreter, Statement& stmt) {
+    if (mode_ == Mode::Run && breakpoints_.empty()) return;
+    line_ = stmt.line;
+    if (shouldStop(stmt)) {
+        prompt(interpreter, stmt);
+    }
+}
+
+void Debugger::onCall(Interpreter& /* interpreter */, const FunctionObject& /* fn */) {
+    frames_.push_back(line_);
+    depth_++;
+}
+
+void Debugger::onReturn(Interpreter& /* interpreter */, const FunctionObject& /* fn */) {
+    frames_.pop_back();
+    depth_--;
+}
+
+bool Debugger::shouldStop(const Statement& stmt) const {
+    if (breakpoints_.count(&stmt)) return true;
+    switch (mode_) {
+        case Mode::Step: return true;
+        case Mode::Next: return depth_ <= stop_depth_;
+        case Mode::Finish: return depth_ < stop_depth_;
+        case Mode::Run: return false;
+    }
+    return false;
+}
+
+void Debugger::show(int line, bool own) const {
+    out_ << (own ? "" : "(included file) ") << "line " << line;
+    if (own && line >= 1 && static_cast<size_t>(line) <= source_.size()) {
+        out_ << ": " << source_[static_cast<size_t>(line) - 1];
+    }
+    out_ << "\n";
+}
+
+void Debugger::prompt(Interpreter& interpreter, const Statement& stmt) {
+    bool own = own_.count(&stmt) > 0;
+    out_ << "Stopped at ";
+    show(stmt.line, own);
+
+    while (true) {
+        out_ << "(asdb) " << std::flush;
+        std::string input;
+        if (!std::getline(in_, input)) {
+            // No more commands: run to the end
+            out_ << "\n";
+            breakpoints_.clear();
+            mode_ = Mode::Run;
+            return;
+        }
+        if (input.empty()) {
+            input = last_command_;
+        }
+        last_command_ = input;
+
+        std::istringstream words(input);
+        std::string command;
+        std::string arg;
+        words >> command >> arg;
+
+        if (command == "c" || command == "continue") {
+            mode_ = Mode::Run;
+            return;
+        } else if (command == "s" || command == "step") {
+            mode_ = Mode::Step;
+            return;
+        } else if (command == "n" || command == "next") {
+            mode_ = Mode::Next;
+            stop_depth_ = depth_;
+            return;
+        } else if (command == "f" || command == "finish") {
+            if (depth_ == 0) {
+                out_ << "Not inside a function\n";
+                continue;
+            }
+            mode_ = Mode::Finish;
+            stop_depth_ = depth_;
+            return;
+        } else if (command == "b" || command == "break" || command == "d" || command == "delete") {
+            int line = 0;
+            try {
+                line = std::stoi(arg);
+            } catch (const std::exception&) {
+                out_ << "Usage: " << command << " LINE\n";
+                continue;
+            }
+            auto it = first_on_line_.find(line);
+            if (it == first_on_line_.end()) {
+                out_ << "No statement on line " << line << "\n";
+            } else if (command[0] == 'b') {
+                breakpoints_.insert(it->second);
+                out_ << "Breakpoint at line " << line << "\n";
+            } else {
+                breakpoints_.erase(it->second);
+                out_ << "Deleted breakpoint at line " << line << "\n";
+            }
+        } else if (command == "p" || command == "print") {
+            try {
+                out_ << arg << " = " << interpreter.getEnvironment()->get(arg).toString() << "\n";
+            } catch (const std::exception& e) {
+                out_ << e.what() << "\n";
+            }
+        } else if (command == "bt" || command == "where") {
+            out_ << "  #0 ";
+            show(stmt.line, own);
+            for (size_t i = frames_.size(); i > 0; --i) {
+                out_ << "  #" << frames_.size() - i + 1 << " called from ";
+                show(frames_[i - 1], true);
+            }
+        } else if (command == "l" || command == "list") {
+            int from = std::max(1, stmt.line - 3);
+            int to = std::min(static_cast<int>(source_.size()), stmt.line + 3);
+            for (int line = from; own && line <= to; ++line) {
+                out_ << (line == stmt.line ? "=> " : "   ") << line << "  "
+                     << source_[static_cast<size_t>(line) - 1] << "\n";
+            }
+        } else if (command == "q" || command == "quit") {
+            throw Quit{};
+        } else {
+            out_ << "Commands: break/delete LINE, step, next, finish, continue, "
+                    "print NAME, where, list, quit\n";
+        }
+    }
+}
+
+} // namespace androidscript
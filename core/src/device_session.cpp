@@ -0,0 +1,422 @@
+#include "device_session.h"
+#include "adb_client.h"
+#include "builtins.h"
+#include "interpreter.h"
+#include "trace.h"
+#include <iostream>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Shared by all sessions; it only holds the adb path
+AdbClient& adb() {
+    static AdbClient client;
+    return client;
+}
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<std::string, std::shared_ptr<DeviceSession>>& registry() {
+    static std::unordered_map<std::string, std::shared_ptr<DeviceSession>> sessions;
+    return sessions;
+}
+
+// Selected device outside any interpreter
+thread_local std::shared_ptr<DeviceSession> t_selected;
+
+// Script-visible device methods
+struct Command {
+    Value (*call)(DeviceSession& device, const std::vector<Value>& args);
+    std::vector<std::string> parameters;
+};
+
+template <Value (DeviceSession::*Method)(const std::vector<Value>&)>
+Value invoke(DeviceSession& device, const std::vector<Value>& args) {
+    return (device.*Method)(args);
+}
+
+Value sleep(DeviceSession&, const std::vector<Value>& args) {
+    return builtin_Sleep(args);
+}
+
+const std::unordered_map<std::string, Command>& commands() {
+    static const std::unordered_map<std::string, Command> table = {
+        {"Tap", {invoke<&DeviceSession::tap>, {"x", "y"}}},
+        {"Swipe", {invoke<&DeviceSession::swipe>, {"x1", "y1", "x2", "y2", "duration"}}},
+        {"Input", {invoke<&DeviceSession::input>, {}}},
+        {"Screenshot", {invoke<&DeviceSession::screenshot>, {}}},
+        {"KeyEvent", {invoke<&DeviceSession::keyEvent>, {}}},
+        {"LaunchApp", {invoke<&DeviceSession::launchApp>, {}}},
+        {"StopApp", {invoke<&DeviceSession::stopApp>, {}}},
+        {"InstallApp", {invoke<&DeviceSession::installApp>, {}}},
+        {"UninstallApp", {invoke<&DeviceSession::uninstallApp>, {}}},
+        {"ClearAppData", {invoke<&DeviceSession::clearAppData>, {}}},
+        {"PushFile", {invoke<&DeviceSession::pushFile>, {"local_path", "remote_path"}}},
+        {"PullFile", {invoke<&DeviceSession::pullFile>, {"remote_path", "local_path"}}},
+        {"Sleep", {sleep, {"milliseconds"}}},
+    };
+    return table;
+}
+
+void check(const AdbResult& result, const char* command) {
+    if (!result.success()) {
+        throw std::runtime_error(std::string(command) + " failed: " + result.error);
+    }
+}
+
+} // namespace
+
+// Run the adb side of a device command, traced on the device's track. A
+// failure may mean the device went away, so the next connect() re-checks.
+template <typename AdbCall>
+void DeviceSession::run(const char* command, AdbCall&& call) {
+    TraceSpan span("device", command, serial());
+    AdbResult result = call();
+    if (!result.success()) {
+        stale_ = true;
+    }
+    check(result, command);
+}
+
+// Connecting
+
+std::shared_ptr<DeviceSession> DeviceSession::cached(const std::string& serial) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto it = registry().find(serial);
+    return it == registry().end() ? nullptr : it->second;
+}
+
+std::shared_ptr<DeviceSession> DeviceSession::connect(const std::string& serial) {
+    if (!serial.empty()) {
+        auto session = cached(serial);
+        if (session && !session->stale_) {
+            return session;
+        }
+    }
+
+    // adb calls may park the calling task, so no lock is held here
+    DeviceRef dev;
+    if (!serial.empty()) {
+        // Use specified device serial
+        dev.serial = serial;
+
+        // Verify device exists; a stale cached session is dropped if not
+        if (!adb().deviceExists(dev.serial)) {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            registry().erase(dev.serial);
+            throw std::runtime_error("Device not found: " + dev.serial);
+        }
+
+        if (auto session = cached(dev.serial)) {
+            session->stale_ = false;
+            return session;
+        }
+    } else {
+        // Auto-detect first available device
+        auto devices = adb().getDevices();
+        if (devices.empty()) {
+            throw std::runtime_error("No Android devices found. Make sure USB debugging is enabled.");
+        }
+
+        // Use first online device
+        bool found = false;
+        for (const auto& d : devices) {
+            if (d.isOnline()) {
+                dev.serial = d.serial;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            throw std::runtime_error("No online devices found. Device state: " + devices[0].state);
+        }
+
+        if (auto session = cached(dev.serial)) {
+            session->stale_ = false;
+            return session;
+        }
+    }
+
+    // Get device info from ADB
+    dev.model = adb().getDeviceModel(dev.serial);
+    dev.android_version = adb().getAndroidVersion(dev.serial);
+
+    auto screen_size = adb().getScreenSize(dev.serial);
+    dev.screen_width = screen_size.first;
+    dev.screen_height = screen_size.second;
+
+    std::shared_ptr<DeviceSession> session(new DeviceSession(std::move(dev)));
+    std::lock_guard<std::mutex> lock(registryMutex());
+    // Another task may have connected to the same device meanwhile
+    return registry().emplace(session->serial(), session).first->second;
+}
+
+std::vector<std::shared_ptr<DeviceSession>> DeviceSession::connectAll() {
+    std::vector<std::shared_ptr<DeviceSession>> sessions;
+    for (const auto& d : adb().getDevices()) {
+        auto session = cached(d.serial);
+        if (!session) {
+            DeviceRef dev;
+            dev.serial = d.serial;
+            dev.model = d.model.empty() ? adb().getDeviceModel(d.serial) : d.model;
+            dev.android_version = adb().getAndroidVersion(d.serial);
+
+            auto screen_size = adb().getScreenSize(d.serial);
+            dev.screen_width = screen_size.first;
+            dev.screen_height = screen_size.second;
+
+            session.reset(new DeviceSession(std::move(dev)));
+            std::lock_guard<std::mutex> lock(registryMutex());
+            session = registry().emplace(d.serial, session).first->second;
+        }
+        sessions.push_back(session);
+    }
+    return sessions;
+}
+
+std::shared_ptr<DeviceSession> DeviceSession::attach(const DeviceRef& saved) {
+    if (auto session = cached(saved.serial)) {
+        return session;
+    }
+
+    DeviceRef dev = saved;
+    dev.session.reset();
+    std::shared_ptr<DeviceSession> session(new DeviceSession(std::move(dev)));
+    std::lock_guard<std::mutex> lock(registryMutex());
+    return registry().emplace(session->serial(), session).first->second;
+}
+
+Value DeviceSession::value() {
+    DeviceRef dev = info_;
+    dev.session = shared_from_this();
+    return Value::makeDevice(dev);
+}
+
+Value DeviceSession::method(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = methods_.find(name);
+    if (it != methods_.end()) {
+        return it->second;
+    }
+
+    auto command = commands().find(name);
+    if (command == commands().end()) {
+        return Value::makeNil();
+    }
+
+    // A weak pointer: the session owns its methods, and connect() drops
+    // sessions whose device went away while scripts may still hold a method
+    auto call = command->second.call;
+    std::weak_ptr<DeviceSession> weak = weak_from_this();
+    std::string serial = info_.serial;
+    Value bound = Value::makeNativeFunction(
+        [call, weak, serial](const std::vector<Value>& args) {
+            auto self = weak.lock();
+            if (!self) {
+                throw std::runtime_error("Device disconnected: " + serial);
+            }
+            return call(*self, args);
+        },
+        command->second.parameters);
+    methods_.emplace(name, bound);
+    return bound;
+}
+
+// UI Automation
+
+Value DeviceSession::tap(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("Tap() requires 2 arguments (x, y)");
+    }
+
+    int x = static_cast<int>(args[0].asInt());
+    int y = static_cast<int>(args[1].asInt());
+
+    std::cout << "[AUTOMATION] Tap(" << x << ", " << y << ") on " << serial() << std::endl;
+
+    run("Tap", [&] { return adb().tap(serial(), x, y); });
+    return Value::makeNil();
+}
+
+Value DeviceSession::swipe(const std::vector<Value>& args) {
+    if (args.size() < 5) {
+        throw std::runtime_error("Swipe() requires 5 arguments (x1, y1, x2, y2, duration)");
+    }
+
+    int x1 = static_cast<int>(args[0].asInt());
+    int y1 = static_cast<int>(args[1].asInt());
+    int x2 = static_cast<int>(args[2].asInt());
+    int y2 = static_cast<int>(args[3].asInt());
+    int duration = static_cast<int>(args[4].asInt());
+
+    std::cout << "[AUTOMATION] Swipe(" << x1 << ", " << y1 << " -> "
+              << x2 << ", " << y2 << ", " << duration << "ms)" << std::endl;
+
+    run("Swipe", [&] { return adb().swipe(serial(), x1, y1, x2, y2, duration); });
+    return Value::makeNil();
+}
+
+Value DeviceSession::input(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Input() requires 1 argument");
+    }
+
+    std::string text = args[0].asString();
+    std::cout << "[AUTOMATION] Input(\"" << text << "\")" << std::endl;
+
+    run("Input", [&] { return adb().input(serial(), text); });
+    return Value::makeNil();
+}
+
+Value DeviceSession::screenshot(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("Screenshot() requires 1 argument (path)");
+    }
+
+    std::string path = args[0].asString();
+    std::cout << "[AUTOMATION] Screenshot(\"" << path << "\")" << std::endl;
+
+    run("Screenshot", [&] { return adb().screenshot(serial(), path); });
+
+    std::cout << "[AUTOMATION] Screenshot saved to: " << path << std::endl;
+    return Value::makeNil();
+}
+
+Value DeviceSession::keyEvent(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("KeyEvent() requires 1 argument (keycode)");
+    }
+
+    std::string keycode = args[0].asString();
+    std::cout << "[AUTOMATION] KeyEvent(\"" << keycode << "\")" << std::endl;
+
+    run("KeyEvent", [&] { return adb().keyevent(serial(), keycode); });
+    return Value::makeNil();
+}
+
+// App Management
+
+Value DeviceSession::launchApp(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("LaunchApp() requires 1 argument (package)");
+    }
+
+    std::string package = args[0].asString();
+    std::cout << "[APP] LaunchApp(\"" << package << "\")" << std::endl;
+
+    run("LaunchApp", [&] { return adb().launchApp(serial(), package); });
+    return Value::makeNil();
+}
+
+Value DeviceSession::stopApp(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("StopApp() requires 1 argument (package)");
+    }
+
+    std::string package = args[0].asString();
+    std::cout << "[APP] StopApp(\"" << package << "\")" << std::endl;
+
+    run("StopApp", [&] { return adb().stopApp(serial(), package); });
+    return Value::makeNil();
+}
+
+Value DeviceSession::installApp(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("InstallApp() requires 1 argument (apk_path)");
+    }
+
+    std::string apk_path = args[0].asString();
+    std::cout << "[APP] InstallApp(\"" << apk_path << "\")" << std::endl;
+
+    run("InstallApp", [&] { return adb().installApk(serial(), apk_path); });
+
+    std::cout << "[APP] App installed successfully" << std::endl;
+    return Value::makeNil();
+}
+
+Value DeviceSession::uninstallApp(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("UninstallApp() requires 1 argument (package)");
+    }
+
+    std::string package = args[0].asString();
+    std::cout << "[APP] UninstallApp(\"" << package << "\")" << std::endl;
+
+    run("UninstallApp", [&] { return adb().uninstallApp(serial(), package); });
+
+    std::cout << "[APP] App uninstalled successfully" << std::endl;
+    return Value::makeNil();
+}
+
+Value DeviceSession::clearAppData(const std::vector<Value>& args) {
+    if (args.empty()) {
+        throw std::runtime_error("ClearAppData() requires 1 argument (package)");
+    }
+
+    std::string package = args[0].asString();
+    std::cout << "[APP] ClearAppData(\"" << package << "\")" << std::endl;
+
+    run("ClearAppData", [&] { return adb().clearAppData(serial(), package); });
+
+    std::cout << "[APP] App data cleared successfully" << std::endl;
+    return Value::makeNil();
+}
+
+// Device File Operations
+
+Value DeviceSession::pushFile(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("PushFile() requires 2 arguments (local_path, remote_path)");
+    }
+
+    std::string local_path = args[0].asString();
+    std::string remote_path = args[1].asString();
+
+    std::cout << "[FILE] PushFile(\"" << local_path << "\" -> \"" << remote_path << "\")" << std::endl;
+
+    run("PushFile", [&] { return adb().push(serial(), local_path, remote_path); });
+
+    std::cout << "[FILE] File pushed successfully" << std::endl;
+    return Value::makeNil();
+}
+
+Value DeviceSession::pullFile(const std::vector<Value>& args) {
+    if (args.size() < 2) {
+        throw std::runtime_error("PullFile() requires 2 arguments (remote_path, local_path)");
+    }
+
+    std::string remote_path = args[0].asString();
+    std::string local_path = args[1].asString();
+
+    std::cout << "[FILE] PullFile(\"" << remote_path << "\" -> \"" << local_path << "\")" << std::endl;
+
+    run("PullFile", [&] { return adb().pull(serial(), remote_path, local_path); });
+
+    std::cout << "[FILE] File pulled successfully" << std::endl;
+    return Value::makeNil();
+}
+
+// Selection
+
+std::shared_ptr<DeviceSession> selectedDevice() {
+    if (Interpreter* interpreter = Interpreter::current()) {
+        return interpreter->device();
+    }
+    return t_selected;
+}
+
+void selectDevice(std::shared_ptr<DeviceSession> device) {
+    if (Interpreter* interpreter = Interpreter::current()) {
+        interpreter->setDevice(std::move(device));
+    } else {
+        t_selected = std::move(device);
+    }
+}
+
+} // namespace androidscript
@@ -8,6 +8,9 @@ Environment::Environment(std::shared_ptr<Environment> parent)
     : parent_(parent) {}
 
 void Environment::define(const std::string& name, const Value& value) {
+    if (frozen_) {
+        throw std::runtime_error("Cannot define '" + name + "' in a frozen environment");
+    }
     values_[name] = value;
 }
 
@@ -35,8 +38,8 @@ void Environment::assign(const std::string& name, const Value& value) {
         return;
     }
 
-    // Check parent scopes
-    if (parent_) {
+    // Check parent scopes (never writing into a frozen one)
+    if (parent_ && !parent_->frozen_) {
         parent_->assign(name, value);
         return;
     }
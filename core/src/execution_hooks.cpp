@@ -0,0 +1,51 @@
+#include "execution_hooks.h"
+
+namespace androidscript {
+
+namespace {
+
+void collect(const Statement* stmt, std::vector<const Statement*>& out) {
+    if (!stmt) return;
+    if (stmt->line) {
+        out.push_back(stmt);
+    }
+
+    if (auto* block = dynamic_cast<const BlockStmt*>(stmt)) {
+        for (const auto& child : block->statements) collect(child.get(), out);
+    } else if (auto* branch = dynamic_cast<const IfStmt*>(stmt)) {
+        collect(branch->then_branch.get(), out);
+        collect(branch->else_branch.get(), out);
+    } else if (auto* loop = dynamic_cast<const WhileStmt*>(stmt)) {
+        collect(loop->body.get(), out);
+    } else if (auto* loop = dynamic_cast<const ForStmt*>(stmt)) {
+        collect(loop->initializer.get(), out);
+        collect(loop->increment.get(), out);
+        collect(loop->body.get(), out);
+    } else if (auto* loop = dynamic_cast<const ForEachStmt*>(stmt)) {
+        collect(loop->body.get(), out);
+    } else if (auto* function = dynamic_cast<const FunctionStmt*>(stmt)) {
+        collect(function->body.get(), out);
+    }
+}
+
+} // namespace
+
+std::vector<const Statement*> collectStatements(
+    const std::vector<std::unique_ptr<Statement>>& program) {
+    std::vector<const Statement*> statements;
+    for (const auto& stmt : program) collect(stmt.get(), statements);
+    return statements;
+}
+
+const std::string& calleeName(const CallExpr& call) {
+    static const std::string unnamed = "<native>";
+    if (auto* variable = dynamic_cast<const VariableExpr*>(call.callee.get())) {
+        return variable->name.lexeme;
+    }
+    if (auto* member = dynamic_cast<const MemberExpr*>(call.callee.get())) {
+        return member->member.lexeme;
+    }
+    return unnamed;
+}
+
+} // namespace androidscript
@@ -0,0 +1,210 @@
+#include "extension_loader.h"
+#include "extension_api.h"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+using androidscript::NativeFunction;
+using androidscript::Value;
+
+// Opaque ABI types (declared in extension_api.h)
+struct as_call {
+    const std::vector<Value>* args;
+    Value result;
+    std::string error;
+    bool failed;
+};
+
+struct as_registry {
+    std::vector<std::pair<std::string, NativeFunction>> functions;
+};
+
+namespace androidscript {
+
+namespace {
+
+// Host API implementation
+
+const Value* argAt(const as_call* call, size_t index) {
+    if (index >= call->args->size()) return nullptr;
+    return &(*call->args)[index];
+}
+
+size_t hostArgCount(const as_call* call) {
+    return call->args->size();
+}
+
+as_type hostArgType(const as_call* call, size_t index) {
+    const Value* arg = argAt(call, index);
+    if (!arg) return AS_TYPE_NIL;
+
+    switch (arg->type()) {
+        case ValueType::NIL: return AS_TYPE_NIL;
+        case ValueType::BOOLEAN: return AS_TYPE_BOOL;
+        case ValueType::INTEGER: return AS_TYPE_INT;
+        case ValueType::FLOAT: return AS_TYPE_FLOAT;
+        case ValueType::STRING: return AS_TYPE_STRING;
+        default: return AS_TYPE_OTHER;
+    }
+}
+
+int hostArgBool(const as_call* call, size_t index) {
+    const Value* arg = argAt(call, index);
+    return arg && arg->isTruthy() ? 1 : 0;
+}
+
+int64_t hostArgInt(const as_call* call, size_t index) {
+    const Value* arg = argAt(call, index);
+    return arg && arg->isNumber() ? arg->asInt() : 0;
+}
+
+double hostArgFloat(const as_call* call, size_t index) {
+    const Value* arg = argAt(call, index);
+    return arg && arg->isNumber() ? arg->asFloat() : 0.0;
+}
+
+const char* hostArgString(const as_call* call, size_t index, size_t* length) {
+    // Points into the argument value, valid until the call returns
+    const Value* arg = argAt(call, index);
+    if (!arg || !arg->isString()) {
+        if (length) *length = 0;
+        return nullptr;
+    }
+    const std::string& str = arg->asStringRef();
+    if (length) *length = str.size();
+    return str.c_str();
+}
+
+void hostReturnNil(as_call* call) { call->result = Value::makeNil(); }
+void hostReturnBool(as_call* call, int value) { call->result = Value(value != 0); }
+void hostReturnInt(as_call* call, int64_t value) { call->result = Value(value); }
+void hostReturnFloat(as_call* call, double value) { call->result = Value(value); }
+
+void hostReturnString(as_call* call, const char* data, size_t length) {
+    call->result = Value(std::string(data ? data : "", data ? length : 0));
+}
+
+void hostRaiseError(as_call* call, const char* message) {
+    call->failed = true;
+    call->error = message ? message : "Extension error";
+}
+
+NativeFunction wrapNative(as_native_fn fn, void* userdata) {
+    return [fn, userdata](const std::vector<Value>& args) {
+        as_call call{&args, Value(), std::string(), false};
+        fn(&call, userdata);
+        if (call.failed) {
+            throw std::runtime_error(call.error);
+        }
+        return call.result;
+    };
+}
+
+int hostRegisterFunction(as_registry* registry, const char* name,
+                         as_native_fn fn, void* userdata) {
+    if (!registry || !name || !*name || !fn) return -1;
+    registry->functions.emplace_back(name, wrapNative(fn, userdata));
+    return 0;
+}
+
+const as_host_api kHostApi = {
+    ANDROIDSCRIPT_EXTENSION_ABI_VERSION,
+    sizeof(as_host_api),
+    hostRegisterFunction,
+    hostArgCount,
+    hostArgType,
+    hostArgBool,
+    hostArgInt,
+    hostArgFloat,
+    hostArgString,
+    hostReturnNil,
+    hostReturnBool,
+    hostReturnInt,
+    hostReturnFloat,
+    hostReturnString,
+    hostRaiseError,
+};
+
+// Platform library loading
+
+void* openLibrary(const std::string& path, std::string& error) {
+#ifdef _WIN32
+    HMODULE handle = LoadLibraryA(path.c_str());
+    if (!handle) error = "LoadLibrary failed with error " + std::to_string(GetLastError());
+    return reinterpret_cast<void*>(handle);
+#else
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* message = dlerror();
+        error = message ? message : "dlopen failed";
+    }
+    return handle;
+#endif
+}
+
+void closeLibrary(void* handle) {
+#ifdef _WIN32
+    FreeLibrary(reinterpret_cast<HMODULE>(handle));
+#else
+    dlclose(handle);
+#endif
+}
+
+void* findSymbol(void* handle, const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(GetProcAddress(reinterpret_cast<HMODULE>(handle), name));
+#else
+    return dlsym(handle, name);
+#endif
+}
+
+// Extensions loaded so far, keyed by the path they were loaded from
+std::mutex g_extensions_mutex;
+std::map<std::string, as_registry> g_extensions;
+
+} // namespace
+
+std::vector<std::string> loadExtension(const std::string& path, Environment& env) {
+    std::lock_guard<std::mutex> lock(g_extensions_mutex);
+
+    auto it = g_extensions.find(path);
+    if (it == g_extensions.end()) {
+        std::string error;
+        void* handle = openLibrary(path, error);
+        if (!handle) {
+            throw std::runtime_error("Cannot load extension " + path + ": " + error);
+        }
+
+        auto init = reinterpret_cast<as_extension_init_fn>(
+            findSymbol(handle, ANDROIDSCRIPT_EXTENSION_INIT_SYMBOL));
+        if (!init) {
+            closeLibrary(handle);
+            throw std::runtime_error("Extension " + path + " does not export " +
+                                     ANDROIDSCRIPT_EXTENSION_INIT_SYMBOL);
+        }
+
+        as_registry registry;
+        if (init(&kHostApi, &registry) != 0) {
+            closeLibrary(handle);
+            throw std::runtime_error("Extension " + path + " failed to initialize");
+        }
+
+        it = g_extensions.emplace(path, std::move(registry)).first;
+    }
+
+    std::vector<std::string> names;
+    for (const auto& entry : it->second.functions) {
+        env.define(entry.first, Value::makeNativeFunction(entry.second));
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+} // namespace androidscript
@@ -0,0 +1,149 @@
+#include "file_handle.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Userspace buffer per open file
+constexpr size_t kBufferSize = 256 * 1024;
+
+} // namespace
+
+FileHandle::FileHandle(const std::string& path, const std::string& mode)
+    : file_(nullptr), path_(path), readable_(false), writable_(false), last_op_(LastOp::NONE) {
+    if (mode == "r") {
+        readable_ = true;
+    } else if (mode == "w" || mode == "a") {
+        writable_ = true;
+    } else if (mode == "r+" || mode == "w+" || mode == "a+") {
+        readable_ = writable_ = true;
+    } else {
+        throw std::runtime_error("Invalid file mode '" + mode + "' (expected r, w, a, r+, w+ or a+)");
+    }
+
+    // Binary mode: lines are split on '\n' ourselves, and Windows must not
+    // rewrite line endings behind Read()'s byte counts
+    std::string stdio_mode = mode.substr(0, 1) + "b" + mode.substr(1);
+    file_ = std::fopen(path.c_str(), stdio_mode.c_str());
+    if (!file_) {
+        throw std::runtime_error("Cannot open file: " + path + " (" + std::strerror(errno) + ")");
+    }
+
+    buffer_.resize(kBufferSize);
+    std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+}
+
+FileHandle::~FileHandle() {
+    closeLocked();
+}
+
+// The open stream, ready for op. stdio requires a flush or seek between
+// writing and reading on update streams.
+std::FILE* FileHandle::stream(LastOp op) {
+    if (!file_) {
+        throw std::runtime_error("File is closed: " + path_);
+    }
+    if (op == LastOp::READ && !readable_) {
+        throw std::runtime_error("File is not open for reading: " + path_);
+    }
+    if (op == LastOp::WRITE && !writable_) {
+        throw std::runtime_error("File is not open for writing: " + path_);
+    }
+
+    if (last_op_ != LastOp::NONE && last_op_ != op) {
+        std::fseek(file_, 0, SEEK_CUR);
+    }
+    last_op_ = op;
+    return file_;
+}
+
+bool FileHandle::next(Value& item) {
+    std::string line;
+    if (!readLine(line)) return false;
+    item = Value(std::move(line));
+    return true;
+}
+
+bool FileHandle::readLine(std::string& line) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::FILE* file = stream(LastOp::READ);
+
+    line.clear();
+    char chunk[4096];
+    bool any = false;
+    while (std::fgets(chunk, sizeof(chunk), file)) {
+        any = true;
+        size_t length = std::strlen(chunk);
+        if (length > 0 && chunk[length - 1] == '\n') {
+            line.append(chunk, length - 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        line.append(chunk, length);
+    }
+
+    if (std::ferror(file)) {
+        throw std::runtime_error("Read failed: " + path_);
+    }
+    return any;
+}
+
+bool FileHandle::read(size_t count, std::string& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::FILE* file = stream(LastOp::READ);
+
+    out.clear();
+    if (count > 0) {
+        out.resize(count);
+        out.resize(std::fread(&out[0], 1, count, file));
+    } else {
+        char chunk[64 * 1024];
+        size_t got;
+        while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            out.append(chunk, got);
+        }
+    }
+
+    if (std::ferror(file)) {
+        throw std::runtime_error("Read failed: " + path_);
+    }
+    return !out.empty();
+}
+
+void FileHandle::write(std::string_view data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::FILE* file = stream(LastOp::WRITE);
+
+    if (std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+        throw std::runtime_error("Write failed: " + path_);
+    }
+}
+
+void FileHandle::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::FILE* file = stream(last_op_);
+    if (last_op_ == LastOp::WRITE && std::fflush(file) != 0) {
+        throw std::runtime_error("Flush failed: " + path_);
+    }
+}
+
+void FileHandle::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ && std::fflush(file_) != 0) {
+        closeLocked();
+        throw std::runtime_error("Write failed: " + path_);
+    }
+    closeLocked();
+}
+
+void FileHandle::closeLocked() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+} // namespace androidscript
@@ -0,0 +1,173 @@
+#include "hash_table.h"
+
+namespace androidscript {
+
+namespace {
+
+constexpr size_t kMinCapacity = 8;
+
+} // namespace
+
+bool valueKeyEquals(const Value& a, const Value& b) {
+    if (a.type() != b.type()) return false;
+
+    switch (a.type()) {
+        case ValueType::NIL:
+            return true;
+        case ValueType::BOOLEAN:
+            return a.asBool() == b.asBool();
+        case ValueType::INTEGER:
+            return a.asInt() == b.asInt();
+        case ValueType::FLOAT:
+            // -0.0 matches 0.0, and all NaNs are treated as one key
+            return a.asFloat() == b.asFloat() ||
+                   (a.asFloat() != a.asFloat() && b.asFloat() != b.asFloat());
+        case ValueType::STRING:
+            return a.asStringRef() == b.asStringRef();
+        default:
+            // Containers, functions and devices compare the same way
+            // operator== does (identity / serial)
+            return a.identityEquals(b);
+    }
+}
+
+ValueHashTable::ValueHashTable() : size_(0), used_(0) {}
+
+uint64_t ValueHashTable::slotHash(const Value& key) {
+    uint64_t h = key.hash();
+    return h < kFirstHash ? h + kFirstHash : h;
+}
+
+size_t ValueHashTable::findSlot(const Value& key, uint64_t hash) const {
+    // Returns the index of the matching slot, or hashes_.size() if absent
+    if (hashes_.empty()) return 0;
+
+    size_t mask = hashes_.size() - 1;
+    size_t index = static_cast<size_t>(hash) & mask;
+
+    while (true) {
+        uint64_t slot_hash = hashes_[index];
+        if (slot_hash == kEmpty) {
+            return hashes_.size();
+        }
+        if (slot_hash == hash && valueKeyEquals(entries_[index].key, key)) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+bool ValueHashTable::contains(const Value& key) const {
+    return find(key) != nullptr;
+}
+
+const Value* ValueHashTable::find(const Value& key) const {
+    size_t index = findSlot(key, slotHash(key));
+    if (index >= hashes_.size()) return nullptr;
+    return &entries_[index].value;
+}
+
+Value* ValueHashTable::find(const Value& key) {
+    size_t index = findSlot(key, slotHash(key));
+    if (index >= hashes_.size()) return nullptr;
+    return &entries_[index].value;
+}
+
+bool ValueHashTable::put(const Value& key, const Value& value) {
+    // Keep load (including tombstones) at or below 3/4
+    if ((used_ + 1) * 4 > hashes_.size() * 3) {
+        rehash(size_ * 2 + 1);
+    }
+
+    uint64_t hash = slotHash(key);
+    size_t mask = hashes_.size() - 1;
+    size_t index = static_cast<size_t>(hash) & mask;
+    size_t first_tombstone = hashes_.size();
+
+    while (true) {
+        uint64_t slot_hash = hashes_[index];
+        if (slot_hash == kEmpty) {
+            break;
+        }
+        if (slot_hash == kTombstone) {
+            if (first_tombstone == hashes_.size()) first_tombstone = index;
+        } else if (slot_hash == hash && valueKeyEquals(entries_[index].key, key)) {
+            entries_[index].value = value;
+            return false;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (first_tombstone != hashes_.size()) {
+        index = first_tombstone;
+    } else {
+        used_++;
+    }
+
+    hashes_[index] = hash;
+    entries_[index].key = key;
+    entries_[index].value = value;
+    size_++;
+    return true;
+}
+
+bool ValueHashTable::remove(const Value& key) {
+    size_t index = findSlot(key, slotHash(key));
+    if (index >= hashes_.size()) return false;
+
+    hashes_[index] = kTombstone;
+    entries_[index].key = Value();
+    entries_[index].value = Value();
+    size_--;
+    return true;
+}
+
+void ValueHashTable::clear() {
+    hashes_.clear();
+    entries_.clear();
+    size_ = 0;
+    used_ = 0;
+}
+
+void ValueHashTable::reserve(size_t count) {
+    if (count * 4 > hashes_.size() * 3) {
+        rehash(count);
+    }
+}
+
+ValueArray ValueHashTable::keys() const {
+    ValueArray result;
+    result.reserve(size_);
+    forEach([&result](const Value& key, const Value&) {
+        result.push_back(key);
+    });
+    return result;
+}
+
+void ValueHashTable::rehash(size_t count) {
+    size_t capacity = kMinCapacity;
+    while (capacity * 3 < count * 4) {
+        capacity *= 2;
+    }
+
+    std::vector<uint64_t> old_hashes(capacity, kEmpty);
+    std::vector<Entry> old_entries(capacity);
+    old_hashes.swap(hashes_);
+    old_entries.swap(entries_);
+    used_ = size_;
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < old_hashes.size(); ++i) {
+        if (old_hashes[i] < kFirstHash) continue;
+
+        size_t index = static_cast<size_t>(old_hashes[i]) & mask;
+        while (hashes_[index] != kEmpty) {
+            index = (index + 1) & mask;
+        }
+        hashes_[index] = old_hashes[i];
+        entries_[index].key = std::move(old_entries[i].key);
+        entries_[index].value = std::move(old_entries[i].value);
+    }
+}
+
+} // namespace androidscript
@@ -1,15 +1,128 @@
 #include "interpreter.h"
 #include "environment.h"
+#include "checkpoint.h"
+#include "device_session.h"
+#include "execution_hooks.h"
+#include "hash_table.h"
+#include "module.h"
+#include "named_args.h"
+#include "scheduler.h"
+#include "trace.h"
+#include <optional>
 #include <sstream>
 
 namespace androidscript {
 
+namespace {
+
+// Marks an interpreter as current for the duration of a call, restoring the
+// previous one afterwards (natives may re-enter another interpreter)
+class CurrentInterpreter {
+public:
+    explicit CurrentInterpreter(Interpreter* interpreter)
+        : slot_(Scheduler::taskLocal()), previous_(slot_) {
+        slot_ = interpreter;
+    }
+    ~CurrentInterpreter() { slot_ = previous_; }
+
+private:
+    void*& slot_;
+    void* previous_;
+};
+
+// Reports a script function call to the attached hooks, if any, including
+// when it ends by throwing
+class CallHook {
+public:
+    CallHook(ExecutionHooks* hooks, Interpreter& interpreter, const FunctionObject& fn)
+        : hooks_(hooks), interpreter_(interpreter), fn_(fn) {
+        if (hooks_) hooks_->onCall(interpreter_, fn_);
+    }
+    ~CallHook() {
+        if (hooks_) hooks_->onReturn(interpreter_, fn_);
+    }
+
+private:
+    ExecutionHooks* hooks_;
+    Interpreter& interpreter_;
+    const FunctionObject& fn_;
+};
+
+// Same for a call expression that runs a native function
+class NativeCallHook {
+public:
+    NativeCallHook(ExecutionHooks& hooks, Interpreter& interpreter, const CallExpr& call)
+        : hooks_(hooks), interpreter_(interpreter), call_(call) {
+        hooks_.onNativeCall(interpreter_, call_);
+    }
+    ~NativeCallHook() { hooks_.onNativeReturn(interpreter_, call_); }
+
+private:
+    ExecutionHooks& hooks_;
+    Interpreter& interpreter_;
+    const CallExpr& call_;
+};
+
+// Sets one of the interpreter's allocation tracking fields for a scope
+template <typename T>
+class TrackedScope {
+public:
+    TrackedScope(T*& field, T* value) : field_(field), previous_(field) { field_ = value; }
+    ~TrackedScope() { field_ = previous_; }
+
+private:
+    T*& field_;
+    T* previous_;
+};
+
+// Trace track for work done by an interpreter: its device's serial
+std::string_view trackOf(const std::shared_ptr<DeviceSession>& device) {
+    return device ? std::string_view(device->serial()) : std::string_view();
+}
+
+} // namespace
+
 Interpreter::Interpreter() {
     global_ = std::make_shared<Environment>();
     environment_ = global_;
+    updateInstrumented();
+}
+
+Interpreter::Interpreter(std::shared_ptr<Environment> globals)
+    : global_(std::move(globals)) {
+    environment_ = global_;
+    updateInstrumented();
+}
+
+void Interpreter::updateInstrumented() {
+    instrumented_ = hooks_ || Tracer::enabled() || allocationTracking();
+}
+
+void Interpreter::reset() {
+    global_ = std::make_shared<Environment>(global_->getParent());
+    environment_ = global_;
+    last_value_ = Value();
+    errors_.clear();
+    import_stack_.clear();
+    included_.clear();
+    modules_.clear();
+    checkpoint_ = nullptr;
+    device_.reset();
+    hooks_ = nullptr;
+    updateInstrumented();
+}
+
+Interpreter* Interpreter::current() {
+    return static_cast<Interpreter*>(Scheduler::taskLocal());
 }
 
 void Interpreter::execute(const std::vector<std::unique_ptr<Statement>>& statements) {
+    CurrentInterpreter current(this);
+    updateInstrumented();
+    if (checkpoint_) {
+        executeCheckpointed(statements);
+        return;
+    }
     for (const auto& stmt : statements) {
         try {
             execute(stmt.get());
@@ -25,18 +138,88 @@ void Interpreter::execute(const std::vector<std::unique_ptr<Statement>>& stateme
     }
 }
 
+void Interpreter::executeCheckpointed(const std::vector<std::unique_ptr<Statement>>& statements) {
+    Checkpointer* checkpoint = checkpoint_;
+    checkpoint->enterList();
+    for (size_t i = 0; i < statements.size(); ++i) {
+        try {
+            if (checkpoint->beginStatement(i, statements[i].get())) {
+                execute(statements[i].get());
+            }
+            continue;
+        } catch (const ReturnException& e) {
+            reportError("Return statement outside of function");
+        } catch (const BreakException& e) {
+            reportError("Break statement outside of loop");
+        } catch (const ContinueException& e) {
+            reportError("Continue statement outside of loop");
+        } catch (const std::exception& e) {
+            reportError(std::string("Runtime error: ") + e.what());
+        }
+        break;
+    }
+    checkpoint->leaveList();
+    if (!hasErrors()) {
+        checkpoint->finish();
+    }
+}
+
 void Interpreter::execute(Statement* stmt) {
-    if (stmt) {
+    if (!stmt) return;
+    if (!instrumented_) {
         stmt->accept(*this);
+        return;
+    }
+
+    if (hooks_ && stmt->line) {
+        hooks_->onStatement(*this, *stmt);
     }
+    if (allocationTracking()) {
+        TrackedScope<const std::type_info> node(current_node_, &typeid(*stmt));
+        stmt->accept(*this);
+        return;
+    }
+    stmt->accept(*this);
 }
 
 Value Interpreter::evaluate(Expression* expr) {
     if (!expr) return Value::makeNil();
+    if (instrumented_ && allocationTracking()) {
+        TrackedScope<const std::type_info> node(current_node_, &typeid(*expr));
+        expr->accept(*this);
+        return last_value_;
+    }
     expr->accept(*this);
     return last_value_;
 }
 
+// Body of a loop on the checkpoint safe path: its statements form the next
+// level of the saved position
+void Interpreter::executeLoopBody(Statement* body, bool safe) {
+    auto* block = safe ? dynamic_cast<BlockStmt*>(body) : nullptr;
+    if (!block) {
+        execute(body);
+        return;
+    }
+
+    auto previous = environment_;
+    environment_ = std::make_shared<Environment>(environment_);
+    checkpoint_->enterList();
+    try {
+        for (size_t i = 0; i < block->statements.size(); ++i) {
+            if (checkpoint_->beginStatement(i, block->statements[i].get())) {
+                execute(block->statements[i].get());
+            }
+        }
+    } catch (...) {
+        checkpoint_->leaveList();
+        environment_ = previous;
+        throw;
+    }
+    checkpoint_->leaveList();
+    environment_ = previous;
+}
+
 void Interpreter::executeBlock(const std::vector<std::unique_ptr<Statement>>& statements,
                                std::shared_ptr<Environment> env) {
     auto previous = environment_;
@@ -53,6 +236,8 @@ void Interpreter::executeBlock(const std::vector<std::unique_ptr<Statement>>& st
 }
 
 Value Interpreter::callFunction(const Value& callee, const std::vector<Value>& args) {
+    CurrentInterpreter current(this);
+
     if (callee.isNativeFunction()) {
         // Call native function
         const NativeFunction& func = callee.asNativeFunction();
@@ -62,6 +247,9 @@ Value Interpreter::callFunction(const Value& callee, const std::vector<Value>& a
     if (callee.isFunction()) {
         // Call user-defined function
         const FunctionObject& func = callee.asFunction();
+        if (func.compiled) {
+            return func.compiled(args, func.closure);
+        }
 
         // Check argument count
         if (args.size() != func.parameters.size()) {
@@ -79,8 +267,14 @@ Value Interpreter::callFunction(const Value& callee, const std::vector<Value>& a
         }
 
         // Execute function body
+        std::optional<CallHook> hook;
+        std::optional<TraceSpan> span;
+        if (instrumented_) {
+            hook.emplace(hooks_, *this, func);
+            span.emplace("function", func.name, trackOf(device_));
+        }
+        auto previous = environment_;
         try {
-            auto previous = environment_;
             environment_ = func_env;
             if (func.body) {
                 func.body->accept(*this);
@@ -88,7 +282,11 @@ Value Interpreter::callFunction(const Value& callee, const std::vector<Value>& a
             environment_ = previous;
             return Value::makeNil();  // No explicit return
         } catch (const ReturnException& e) {
+            environment_ = previous;
             return e.value();
+        } catch (...) {
+            environment_ = previous;
+            throw;
         }
     }
 
@@ -202,10 +400,26 @@ void Interpreter::visit(CallExpr& expr) {
     Value callee = evaluate(expr.callee.get());
 
     std::vector<Value> args;
+    args.reserve(expr.arguments.size() + expr.named_args.size());
     for (const auto& arg : expr.arguments) {
         args.push_back(evaluate(arg.get()));
     }
 
+    if (expr.named_cache) {
+        for (const auto& arg : expr.named_args) {
+            args.push_back(evaluate(arg.second.get()));
+        }
+        args = expr.named_cache->bind(callee, std::move(args));
+    }
+
+    if (instrumented_ && callee.isNativeFunction()) {
+        std::optional<NativeCallHook> hook;
+        if (hooks_) hook.emplace(*hooks_, *this, expr);
+        TraceSpan span("builtin", calleeName(expr), trackOf(device_));
+        TrackedScope<const std::string> builtin(current_builtin_, &calleeName(expr));
+        last_value_ = callFunction(callee, args);
+        return;
+    }
     last_value_ = callFunction(callee, args);
 }
 
@@ -219,50 +433,76 @@ void Interpreter::visit(ArrayExpr& expr) {
 
 void Interpreter::visit(MemberExpr& expr) {
     Value object = evaluate(expr.object.get());
+    last_value_ = getMember(object, expr.member.lexeme);
+}
+
+void Interpreter::visit(IndexExpr& expr) {
+    Value object = evaluate(expr.object.get());
+    Value index = evaluate(expr.index.get());
+    last_value_ = getIndex(object, index);
+}
 
+Value Interpreter::getMember(const Value& object, const std::string& member) {
     if (object.isObject()) {
-        last_value_ = object.get(expr.member.lexeme);
-    } else if (object.isDevice()) {
+        return object.get(member);
+    }
+
+    if (object.isDevice()) {
         // Handle device member access
-        DeviceRef& dev = object.asDevice();
-        const std::string& member = expr.member.lexeme;
+        const DeviceRef& dev = object.asDevice();
 
         if (member == "serial") {
-            last_value_ = Value(dev.serial);
+            return Value(dev.serial);
         } else if (member == "model") {
-            last_value_ = Value(dev.model);
+            return Value(dev.model);
         } else if (member == "screenWidth") {
-            last_value_ = Value(dev.screen_width);
+            return Value(dev.screen_width);
         } else if (member == "screenHeight") {
-            last_value_ = Value(dev.screen_height);
+            return Value(dev.screen_height);
         } else if (member == "androidVersion") {
-            last_value_ = Value(dev.android_version);
-        } else {
-            throw std::runtime_error("Unknown device member: " + member);
+            return Value(dev.android_version);
+        }
+
+        // $device.Tap(...) and friends act on this device, whatever Device()
+        // last selected
+        if (!dev.session) {
+            throw std::runtime_error("Device is not connected: " + dev.serial);
         }
-    } else {
-        throw std::runtime_error("Cannot access member of non-object");
+        Value method = dev.session->method(member);
+        if (!method.isNil()) {
+            return method;
+        }
+        throw std::runtime_error("Unknown device member: " + member);
     }
-}
 
-void Interpreter::visit(IndexExpr& expr) {
-    Value object = evaluate(expr.object.get());
-    Value index = evaluate(expr.index.get());
+    throw std::runtime_error("Cannot access member of non-object");
+}
 
+Value Interpreter::getIndex(const Value& object, const Value& index) {
     if (object.isArray()) {
         if (!index.isInt()) {
             throw std::runtime_error("Array index must be an integer");
         }
         size_t idx = static_cast<size_t>(index.asInt());
-        last_value_ = object[idx];
-    } else if (object.isObject()) {
+        return object[idx];
+    }
+
+    if (object.isObject()) {
         if (!index.isString()) {
             throw std::runtime_error("Object key must be a string");
         }
-        last_value_ = object[index.asString()];
-    } else {
-        throw std::runtime_error("Cannot index non-array/object");
+        return object[index.asString()];
     }
+
+    if (object.isMap()) {
+        const Value* found = object.asTable().find(index);
+        if (!found) {
+            throw std::runtime_error("Key not found: " + index.toString());
+        }
+        return *found;
+    }
+
+    throw std::runtime_error("Cannot index non-array/object");
 }
 
 // Statement visitors
@@ -291,9 +531,18 @@ void Interpreter::visit(IfStmt& stmt) {
 }
 
 void Interpreter::visit(WhileStmt& stmt) {
-    while (evaluate(stmt.condition.get()).isTruthy()) {
+    CheckpointLoop checkpoint(checkpoint_, stmt);
+    bool skip_condition = checkpoint.resumesInside();
+
+    while (true) {
+        checkpoint.iteration();
+        if (!skip_condition && !evaluate(stmt.condition.get()).isTruthy()) {
+            break;
+        }
+        skip_condition = false;
+
         try {
-            execute(stmt.body.get());
+            executeLoopBody(stmt.body.get(), checkpoint.active());
         } catch (const BreakException&) {
             break;
         } catch (const ContinueException&) {
@@ -309,15 +558,25 @@ void Interpreter::visit(ForStmt& stmt) {
     environment_ = loop_env;
 
     try {
+        CheckpointLoop checkpoint(checkpoint_, stmt);
+        bool skip_condition = checkpoint.resumesInside();
+
         // Execute initializer
-        if (stmt.initializer) {
+        if (stmt.initializer && !checkpoint.resuming()) {
             execute(stmt.initializer.get());
         }
 
         // Loop
-        while (!stmt.condition || evaluate(stmt.condition.get()).isTruthy()) {
+        while (true) {
+            checkpoint.iteration();
+            if (!skip_condition && stmt.condition &&
+                !evaluate(stmt.condition.get()).isTruthy()) {
+                break;
+            }
+            skip_condition = false;
+
             try {
-                execute(stmt.body.get());
+                executeLoopBody(stmt.body.get(), checkpoint.active());
             } catch (const BreakException&) {
                 break;
             } catch (const ContinueException&) {
@@ -338,29 +597,35 @@ void Interpreter::visit(ForStmt& stmt) {
 }
 
 void Interpreter::visit(ForEachStmt& stmt) {
-    Value iterable = evaluate(stmt.iterable.get());
+    CheckpointLoop checkpoint(checkpoint_, stmt);
+    ForEachCursor cursor(checkpoint.iterable([&]() { return evaluate(stmt.iterable.get()); }));
 
-    if (!iterable.isArray()) {
-        throw std::runtime_error("ForEach requires an array");
+    Value item;
+    for (uint64_t skip = checkpoint.resumeIterations(); skip > 0 && cursor.next(item); --skip) {
     }
 
-    const ValueArray& arr = iterable.asArray();
+    while (true) {
+        checkpoint.iteration();
+        if (!cursor.next(item)) break;
 
-    for (const Value& item : arr) {
         // Create new scope for each iteration
         auto loop_env = std::make_shared<Environment>(environment_);
         loop_env->define(stmt.variable.lexeme, item);
 
+        auto previous = environment_;
         try {
-            executeBlock({}, loop_env);
-            auto previous = environment_;
             environment_ = loop_env;
-            execute(stmt.body.get());
+            executeLoopBody(stmt.body.get(), checkpoint.active());
             environment_ = previous;
         } catch (const BreakException&) {
+            environment_ = previous;
             break;
         } catch (const ContinueException&) {
+            environment_ = previous;
             continue;
+        } catch (...) {
+            environment_ = previous;
+            throw;
         }
     }
 }
@@ -368,6 +633,7 @@ void Interpreter::visit(ForEachStmt& stmt) {
 void Interpreter::visit(FunctionStmt& stmt) {
     // Create function object
     FunctionObject func;
+    func.name = stmt.name.lexeme;
     for (const auto& param : stmt.parameters) {
         func.parameters.push_back(param.lexeme);
     }
@@ -386,6 +652,80 @@ void Interpreter::visit(ReturnStmt& stmt) {
     throw ReturnException(value);
 }
 
+void Interpreter::visit(ImportStmt& stmt) {
+    std::string from_dir;
+    if (!import_stack_.empty()) {
+        std::string importer = import_stack_.back();
+        size_t slash = importer.find_last_of("/\\");
+        from_dir = slash == std::string::npos ? "" : importer.substr(0, slash);
+    }
+    std::string path = ModuleCache::resolve(stmt.path.lexeme, from_dir);
+
+    for (size_t i = 0; i < import_stack_.size(); ++i) {
+        if (import_stack_[i] != path) continue;
+        std::string cycle;
+        for (size_t j = i; j < import_stack_.size(); ++j) {
+            cycle += import_stack_[j] + " -> ";
+        }
+        throw std::runtime_error("Import cycle: " + cycle + path);
+    }
+
+    if (stmt.isInclude()) {
+        // Into the top-level scope of the including file, once per scope
+        std::shared_ptr<Environment> target = environment_;
+        while (!target->isGlobal()) target = target->getParent();
+        if (included_.insert({target.get(), path}).second) {
+            runModule(path, target);
+        }
+        return;
+    }
+
+    auto it = modules_.find(path);
+    if (it == modules_.end()) {
+        auto scope = makeModuleScope(global_);
+        runModule(path, scope);
+        it = modules_.emplace(path, ImportedModule{scope, moduleExports(*scope, *global_)}).first;
+    }
+
+    std::string name = stmt.alias.type == TokenType::IDENTIFIER
+        ? stmt.alias.lexeme
+        : defaultModuleName(path);
+    environment_->define(name, it->second.exports);
+}
+
+void Interpreter::setCheckpointer(Checkpointer* checkpointer) {
+    checkpoint_ = checkpointer;
+    if (checkpoint_) {
+        checkpoint_->attach(global_);
+    }
+}
+
+void Interpreter::setScriptPath(const std::string& path) {
+    import_stack_.assign(1, ModuleCache::resolve(path, ""));
+}
+
+void Interpreter::runModule(const std::string& path, std::shared_ptr<Environment> env) {
+    std::shared_ptr<const Module> module = ModuleCache::instance().load(path);
+
+    import_stack_.push_back(path);
+    try {
+        executeBlock(module->program, env);
+    } catch (const ReturnException&) {
+        import_stack_.pop_back();
+        throw std::runtime_error(path + ": Return statement outside of function");
+    } catch (const BreakException&) {
+        import_stack_.pop_back();
+        throw std::runtime_error(path + ": Break statement outside of loop");
+    } catch (const ContinueException&) {
+        import_stack_.pop_back();
+        throw std::runtime_error(path + ": Continue statement outside of loop");
+    } catch (...) {
+        import_stack_.pop_back();
+        throw;
+    }
+    import_stack_.pop_back();
+}
+
 void Interpreter::visit(BreakStmt&) {
     throw BreakException();
 }
@@ -0,0 +1,67 @@
+#include "interpreter_pool.h"
+#include "builtins.h"
+
+namespace androidscript {
+
+// Lease
+
+InterpreterPool::Lease::Lease(InterpreterPool* pool, std::unique_ptr<Interpreter> interpreter)
+    : pool_(pool), interpreter_(std::move(interpreter)) {}
+
+InterpreterPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), interpreter_(std::move(other.interpreter_)) {}
+
+InterpreterPool::Lease& InterpreterPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (interpreter_) pool_->release(std::move(interpreter_));
+        pool_ = other.pool_;
+        interpreter_ = std::move(other.interpreter_);
+    }
+    return *this;
+}
+
+InterpreterPool::Lease::~Lease() {
+    if (interpreter_) pool_->release(std::move(interpreter_));
+}
+
+// InterpreterPool
+
+InterpreterPool::InterpreterPool(size_t prewarm) {
+    idle_.reserve(prewarm);
+    for (size_t i = 0; i < prewarm; ++i) {
+        idle_.push_back(create());
+    }
+}
+
+InterpreterPool::Lease InterpreterPool::acquire() {
+    std::unique_ptr<Interpreter> interpreter;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            interpreter = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+    if (!interpreter) {
+        interpreter = create();
+    }
+    return Lease(this, std::move(interpreter));
+}
+
+size_t InterpreterPool::idleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+std::unique_ptr<Interpreter> InterpreterPool::create() {
+    return std::make_unique<Interpreter>(std::make_shared<Environment>(sharedBuiltins()));
+}
+
+void InterpreterPool::release(std::unique_ptr<Interpreter> interpreter) {
+    // Outside the lock: dropping the old globals can take a while
+    interpreter->reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(interpreter));
+}
+
+} // namespace androidscript
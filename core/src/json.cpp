@@ -0,0 +1,532 @@
+#include "json.h"
+#include "number_format.h"
+#include "string_kernels.h"
+#include "hash_table.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Deep enough for real documents, shallow enough for a 1 MiB task stack
+constexpr int kMaxDepth = 512;
+
+// JsonStream reads the file this much at a time
+constexpr size_t kStreamChunkSize = 1 << 20;
+
+bool isJsonWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+class JsonParser {
+public:
+    // base_offset and source only make error messages point into the file
+    JsonParser(std::string_view text, size_t base_offset, const std::string& source)
+        : text_(text), pos_(0), base_offset_(base_offset), source_(source) {}
+
+    Value parseDocument() {
+        skipWhitespace();
+        Value value = parseValue(0);
+        skipWhitespace();
+        if (pos_ != text_.size()) fail("unexpected trailing characters");
+        return value;
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_;
+    size_t base_offset_;
+    const std::string& source_;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        std::string where = source_.empty() ? "" : source_ + ": ";
+        throw std::runtime_error(where + "JSON error at offset " +
+                                 std::to_string(base_offset_ + pos_) + ": " + message);
+    }
+
+    void skipWhitespace() {
+        while (pos_ < text_.size() && isJsonWhitespace(text_[pos_])) ++pos_;
+    }
+
+    Value parseValue(int depth) {
+        if (pos_ >= text_.size()) fail("unexpected end of input");
+
+        switch (text_[pos_]) {
+            case '{':
+                return parseObject(depth + 1);
+            case '[':
+                return parseArray(depth + 1);
+            case '"': {
+                std::string str;
+                parseString(str);
+                return Value(std::move(str));
+            }
+            case 't':
+                expectWord("true");
+                return Value(true);
+            case 'f':
+                expectWord("false");
+                return Value(false);
+            case 'n':
+                expectWord("null");
+                return Value::makeNil();
+            default:
+                return parseNumber();
+        }
+    }
+
+    void expectWord(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) fail("invalid value");
+        pos_ += word.size();
+    }
+
+    Value parseArray(int depth) {
+        if (depth > kMaxDepth) fail("nesting too deep");
+        ++pos_;  // '['
+
+        ValueArray items;
+        skipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            ++pos_;
+            return Value::makeArray(std::move(items));
+        }
+
+        while (true) {
+            skipWhitespace();
+            items.push_back(parseValue(depth));
+            skipWhitespace();
+            if (pos_ >= text_.size()) fail("unexpected end of input");
+            char c = text_[pos_++];
+            if (c == ']') break;
+            if (c != ',') {
+                --pos_;
+                fail("expected ',' or ']'");
+            }
+        }
+        return Value::makeArray(std::move(items));
+    }
+
+    Value parseObject(int depth) {
+        if (depth > kMaxDepth) fail("nesting too deep");
+        ++pos_;  // '{'
+
+        ValueMap members;
+        skipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            ++pos_;
+            return Value::makeObject(std::move(members));
+        }
+
+        std::string key;
+        while (true) {
+            skipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != '"') fail("expected a string key");
+            key.clear();
+            parseString(key);
+
+            skipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') fail("expected ':'");
+            ++pos_;
+            skipWhitespace();
+
+            // Later duplicates win
+            members[key] = parseValue(depth);
+
+            skipWhitespace();
+            if (pos_ >= text_.size()) fail("unexpected end of input");
+            char c = text_[pos_++];
+            if (c == '}') break;
+            if (c != ',') {
+                --pos_;
+                fail("expected ',' or '}'");
+            }
+        }
+        return Value::makeObject(std::move(members));
+    }
+
+    void parseString(std::string& out) {
+        ++pos_;  // Opening quote
+
+        while (true) {
+            // Copy the plain run up to the next quote, backslash or control byte
+            size_t special = findJsonSpecial(text_, pos_);
+            if (special == kNotFound) {
+                pos_ = text_.size();
+                fail("unterminated string");
+            }
+            out.append(text_.data() + pos_, special - pos_);
+            pos_ = special;
+
+            char c = text_[pos_];
+            if (c == '"') {
+                ++pos_;
+                return;
+            }
+            if (c != '\\') fail("control character in string");
+
+            if (++pos_ >= text_.size()) fail("unterminated string");
+            char escaped = text_[pos_++];
+            switch (escaped) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': appendUtf8(out, parseUnicodeEscape()); break;
+                default:
+                    --pos_;
+                    fail("invalid escape");
+            }
+        }
+    }
+
+    uint32_t parseHex4() {
+        if (text_.size() - pos_ < 4) fail("invalid \\u escape");
+        uint32_t code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char h = text_[pos_++];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= static_cast<uint32_t>(h - '0');
+            else if (h >= 'a' && h <= 'f') code |= static_cast<uint32_t>(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') code |= static_cast<uint32_t>(h - 'A' + 10);
+            else fail("invalid \\u escape");
+        }
+        return code;
+    }
+
+    // After "\u"; joins surrogate pairs, unpaired surrogates become U+FFFD
+    uint32_t parseUnicodeEscape() {
+        uint32_t code = parseHex4();
+        if (code >= 0xDC00 && code <= 0xDFFF) return 0xFFFD;
+        if (code < 0xD800 || code > 0xDBFF) return code;
+
+        if (text_.substr(pos_, 2) != "\\u") return 0xFFFD;
+        size_t saved = pos_;
+        pos_ += 2;
+        uint32_t low = parseHex4();
+        if (low < 0xDC00 || low > 0xDFFF) {
+            pos_ = saved;
+            return 0xFFFD;
+        }
+        return 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    Value parseNumber() {
+        size_t start = pos_;
+        auto digits = [this]() {
+            size_t first = pos_;
+            while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') ++pos_;
+            return pos_ - first;
+        };
+
+        if (pos_ < text_.size() && text_[pos_] == '-') ++pos_;
+        size_t int_start = pos_;
+        size_t int_digits = digits();
+        if (int_digits == 0) {
+            pos_ = start;
+            fail("invalid value");
+        }
+        if (int_digits > 1 && text_[int_start] == '0') fail("leading zero in number");
+
+        bool integral = true;
+        if (pos_ < text_.size() && text_[pos_] == '.') {
+            ++pos_;
+            integral = false;
+            if (digits() == 0) fail("expected digits after '.'");
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            ++pos_;
+            integral = false;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) ++pos_;
+            if (digits() == 0) fail("expected digits in exponent");
+        }
+
+        std::string_view number = text_.substr(start, pos_ - start);
+        int64_t int_value;
+        if (integral && parseInt(number, int_value)) return Value(int_value);
+
+        // Fractions, exponents and integers beyond 64 bits
+        double float_value;
+        if (!parseFloat(number, float_value)) fail("number out of range");
+        return Value(float_value);
+    }
+};
+
+class JsonWriter {
+public:
+    explicit JsonWriter(int indent) : indent_(indent) {}
+
+    std::string out;
+
+    void write(const Value& value, int depth) {
+        if (depth > kMaxDepth) {
+            throw std::runtime_error("JsonStringify() nesting too deep (cyclic value?)");
+        }
+
+        switch (value.type()) {
+            case ValueType::NIL:
+                out += "null";
+                break;
+            case ValueType::BOOLEAN:
+                out += value.asBool() ? "true" : "false";
+                break;
+            case ValueType::INTEGER:
+                appendInt(out, value.asInt());
+                break;
+            case ValueType::FLOAT:
+                // JSON has no NaN or Infinity
+                if (std::isfinite(value.asFloat())) {
+                    appendFloat(out, value.asFloat());
+                } else {
+                    out += "null";
+                }
+                break;
+            case ValueType::STRING:
+                writeString(value.asStringRef());
+                break;
+            case ValueType::ARRAY: {
+                const ValueArray& items = value.asArray();
+                out += '[';
+                for (size_t i = 0; i < items.size(); ++i) {
+                    if (i > 0) out += ',';
+                    newline(depth + 1);
+                    write(items[i], depth + 1);
+                }
+                if (!items.empty()) newline(depth);
+                out += ']';
+                break;
+            }
+            case ValueType::OBJECT: {
+                const ValueMap& members = value.asObject();
+                out += '{';
+                bool first = true;
+                for (const auto& member : members) {
+                    writeMember(member.first, member.second, depth, first);
+                }
+                if (!members.empty()) newline(depth);
+                out += '}';
+                break;
+            }
+            case ValueType::MAP: {
+                out += '{';
+                bool first = true;
+                value.asTable().forEach([&](const Value& key, const Value& val) {
+                    writeMember(key.isString() ? key.asStringRef() : key.toString(), val, depth, first);
+                });
+                if (!first) newline(depth);
+                out += '}';
+                break;
+            }
+            case ValueType::SET: {
+                out += '[';
+                bool first = true;
+                value.asTable().forEach([&](const Value& key, const Value&) {
+                    if (!first) out += ',';
+                    first = false;
+                    newline(depth + 1);
+                    write(key, depth + 1);
+                });
+                if (!first) newline(depth);
+                out += ']';
+                break;
+            }
+            default:
+                throw std::runtime_error("JsonStringify() cannot convert a " + value.typeString());
+        }
+    }
+
+private:
+    int indent_;
+
+    void newline(int depth) {
+        if (indent_ <= 0) return;
+        out += '\n';
+        out.append(static_cast<size_t>(depth) * static_cast<size_t>(indent_), ' ');
+    }
+
+    void writeMember(const std::string& key, const Value& val, int depth, bool& first) {
+        if (!first) out += ',';
+        first = false;
+        newline(depth + 1);
+        writeString(key);
+        out += indent_ > 0 ? ": " : ":";
+        write(val, depth + 1);
+    }
+
+    void writeString(std::string_view str) {
+        static const char kHex[] = "0123456789abcdef";
+        out += '"';
+        size_t pos = 0;
+        while (true) {
+            size_t special = findJsonSpecial(str, pos);
+            if (special == kNotFound) {
+                out.append(str.data() + pos, str.size() - pos);
+                break;
+            }
+            out.append(str.data() + pos, special - pos);
+
+            unsigned char c = static_cast<unsigned char>(str[special]);
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    out += "\\u00";
+                    out += kHex[c >> 4];
+                    out += kHex[c & 0xF];
+            }
+            pos = special + 1;
+        }
+        out += '"';
+    }
+};
+
+} // namespace
+
+Value parseJson(std::string_view text) {
+    static const std::string kNoSource;
+    return JsonParser(text, 0, kNoSource).parseDocument();
+}
+
+std::string stringifyJson(const Value& value, int indent) {
+    JsonWriter writer(indent);
+    writer.write(value, 0);
+    return std::move(writer.out);
+}
+
+JsonStream::JsonStream(const std::string& path)
+    : file_(path, std::ios::binary), path_(path), pos_(0), offset_(0),
+      started_(false), finished_(false) {
+    if (!file_) {
+        throw std::runtime_error("Cannot open JSON file: " + path);
+    }
+}
+
+bool JsonStream::next(Value& item) {
+    if (finished_) return false;
+
+    if (!started_) {
+        if (!skipWhitespace() || buffer_[pos_] != '[') fail("expected a top-level array");
+        ++pos_;
+        started_ = true;
+        if (!skipWhitespace()) fail("unexpected end of file");
+        if (buffer_[pos_] == ']') {
+            finished_ = true;
+            return false;
+        }
+    }
+
+    if (!skipWhitespace()) fail("unexpected end of file");
+
+    // Find the ',' or ']' that ends this element, reading more of the file
+    // as needed. Only brackets and strings matter here; the element itself
+    // is validated when it is parsed.
+    size_t scan = pos_;
+    int depth = 0;
+    bool in_string = false;
+    while (true) {
+        if (scan >= buffer_.size()) {
+            size_t shift = pos_;
+            if (!fill()) fail("unexpected end of file");
+            scan -= shift;
+            continue;
+        }
+
+        if (in_string) {
+            size_t special = findJsonSpecial(buffer_, scan);
+            if (special == kNotFound) {
+                scan = buffer_.size();
+                continue;
+            }
+            scan = special;
+            char c = buffer_[scan];
+            if (c == '"') in_string = false;
+            // Step over an escaped character, even if it is not read yet
+            scan += c == '\\' ? 2 : 1;
+            continue;
+        }
+
+        char c = buffer_[scan];
+        if (c == '"') {
+            in_string = true;
+        } else if (c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            if (depth == 0) break;
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            break;
+        }
+        ++scan;
+    }
+
+    char terminator = buffer_[scan];
+    if (terminator == '}') {
+        pos_ = scan;
+        fail("unexpected '}'");
+    }
+
+    item = JsonParser(std::string_view(buffer_).substr(pos_, scan - pos_), offset_ + pos_, path_)
+               .parseDocument();
+    pos_ = scan + 1;
+    if (terminator == ']') finished_ = true;
+    return true;
+}
+
+// Append the next chunk of the file, first dropping bytes before pos_.
+// Returns false at end of file.
+bool JsonStream::fill() {
+    if (pos_ > 0) {
+        buffer_.erase(0, pos_);
+        offset_ += pos_;
+        pos_ = 0;
+    }
+
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + kStreamChunkSize);
+    file_.read(&buffer_[old_size], static_cast<std::streamsize>(kStreamChunkSize));
+    buffer_.resize(old_size + static_cast<size_t>(file_.gcount()));
+    return buffer_.size() > old_size;
+}
+
+// Move pos_ to the next non-whitespace byte; false at end of file
+bool JsonStream::skipWhitespace() {
+    while (true) {
+        if (pos_ >= buffer_.size() && !fill()) return false;
+        if (!isJsonWhitespace(buffer_[pos_])) return true;
+        ++pos_;
+    }
+}
+
+void JsonStream::fail(const std::string& message) const {
+    throw std::runtime_error(path_ + ": JSON error at offset " + std::to_string(offset_ + pos_) +
+                             ": " + message);
+}
+
+} // namespace androidscript
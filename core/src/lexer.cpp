@@ -1,4 +1,5 @@
 #include "lexer.h"
+#include "number_format.h"
 #include <cctype>
 #include <sstream>
 
@@ -230,12 +231,16 @@ Token Lexer::number() {
         }
 
         Token token = makeToken(TokenType::FLOAT);
-        token.float_value = std::stod(token.lexeme);
+        if (!parseFloat(token.lexeme, token.float_value)) {
+            return errorToken("Number out of range");
+        }
         return token;
     }
 
     Token token = makeToken(TokenType::INTEGER);
-    token.int_value = std::stoll(token.lexeme);
+    if (!parseInt(token.lexeme, token.int_value)) {
+        return errorToken("Integer literal out of range");
+    }
     return token;
 }
 
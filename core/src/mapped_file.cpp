@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace androidscript {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) : data_(""), size_(0), discarded_(0), mapping_(nullptr) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot read file size: " + path);
+    }
+
+    // Empty files cannot be mapped; data() is just empty
+    if (size.QuadPart > 0) {
+        mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) {
+            data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!mapping_ || !data_) {
+            if (mapping_) CloseHandle(mapping_);
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+    }
+    CloseHandle(file);
+}
+
+MappedFile::~MappedFile() {
+    if (mapping_) {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+    }
+}
+
+void MappedFile::discardBefore(size_t offset) {
+    // The system trims read-only file views on its own
+    discarded_ = offset;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) : data_(""), size_(0), discarded_(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path + " (" + std::strerror(errno) + ")");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read file size: " + path);
+    }
+
+    // Empty files cannot be mapped; data() is just empty
+    if (info.st_size > 0) {
+        void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map file: " + path + " (" + std::strerror(errno) + ")");
+        }
+        madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapped);
+        size_ = static_cast<size_t>(info.st_size);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (size_ > 0) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+void MappedFile::discardBefore(size_t offset) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = std::min(offset, size_) / page * page;
+    if (end <= discarded_) return;
+
+    // Clean file-backed pages are simply dropped and re-read on access
+    madvise(const_cast<char*>(data_) + discarded_, end - discarded_, MADV_DONTNEED);
+    discarded_ = end;
+}
+
+#endif
+
+} // namespace androidscript
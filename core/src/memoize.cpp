@@ -0,0 +1,163 @@
+#include "memoize.h"
+#include "hash_table.h"
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Bounds recursion into nested (or self-containing) arrays and objects
+constexpr int kMaxDepth = 64;
+
+void checkDepth(int depth) {
+    if (depth > kMaxDepth) {
+        throw std::runtime_error("Memoize() arguments or result are nested too deeply");
+    }
+}
+
+uint64_t combine(uint64_t seed, uint64_t h) {
+    return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+uint64_t structuralHash(const Value& value, int depth) {
+    checkDepth(depth);
+    if (value.isArray()) {
+        uint64_t h = 0xa5a5a5a5ULL;
+        for (const Value& item : value.asArray()) {
+            h = combine(h, structuralHash(item, depth + 1));
+        }
+        return h;
+    }
+    if (value.isObject()) {
+        uint64_t h = 0x5a5a5a5aULL;
+        for (const auto& field : value.asObject()) {
+            h = combine(h, std::hash<std::string>()(field.first));
+            h = combine(h, structuralHash(field.second, depth + 1));
+        }
+        return h;
+    }
+    return value.hash();
+}
+
+bool structuralEquals(const Value& a, const Value& b, int depth) {
+    if (a.type() != b.type()) return false;
+    if (a.isArray()) {
+        const ValueArray& x = a.asArray();
+        const ValueArray& y = b.asArray();
+        if (x.size() != y.size()) return false;
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (!structuralEquals(x[i], y[i], depth + 1)) return false;
+        }
+        return true;
+    }
+    if (a.isObject()) {
+        const ValueMap& x = a.asObject();
+        const ValueMap& y = b.asObject();
+        if (x.size() != y.size()) return false;
+        for (auto i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+            if (i->first != j->first || !structuralEquals(i->second, j->second, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return valueKeyEquals(a, b);
+}
+
+// Copy of the arrays and objects inside a key or result, so the caller's
+// copies can change without affecting the cache
+Value snapshot(const Value& value, int depth) {
+    checkDepth(depth);
+    if (value.isArray()) {
+        ValueArray items;
+        items.reserve(value.asArray().size());
+        for (const Value& item : value.asArray()) items.push_back(snapshot(item, depth + 1));
+        return Value::makeArray(std::move(items));
+    }
+    if (value.isObject()) {
+        ValueMap fields;
+        for (const auto& field : value.asObject()) {
+            fields.emplace(field.first, snapshot(field.second, depth + 1));
+        }
+        return Value::makeObject(std::move(fields));
+    }
+    return value;
+}
+
+uint64_t argumentsHash(const std::vector<Value>& args) {
+    uint64_t h = args.size();
+    for (const Value& arg : args) h = combine(h, structuralHash(arg, 0));
+    return h;
+}
+
+} // namespace
+
+bool MemoCache::KeyEquals::operator()(const KeyRef& a, const KeyRef& b) const {
+    if (a.hash != b.hash || a.args->size() != b.args->size()) return false;
+    for (size_t i = 0; i < a.args->size(); ++i) {
+        if (!structuralEquals((*a.args)[i], (*b.args)[i], 0)) return false;
+    }
+    return true;
+}
+
+MemoCache::MemoCache(size_t capacity) : capacity_(capacity) {
+    if (capacity_ == 0) {
+        throw std::runtime_error("Memoize() requires at least one entry");
+    }
+    stats_.capacity = capacity_;
+}
+
+bool MemoCache::find(const std::vector<Value>& args, Value& result) {
+    KeyRef key{&args, argumentsHash(args)};
+
+    Value stored;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            stats_.misses++;
+            return false;
+        }
+        entries_.splice(entries_.begin(), entries_, it->second);
+        stored = it->second->result;
+        stats_.hits++;
+    }
+    // Each hit gets its own arrays and objects to modify
+    result = snapshot(stored, 0);
+    return true;
+}
+
+void MemoCache::insert(const std::vector<Value>& args, const Value& result) {
+    Entry entry;
+    entry.hash = argumentsHash(args);
+    entry.args.reserve(args.size());
+    for (const Value& arg : args) entry.args.push_back(snapshot(arg, 0));
+    entry.result = snapshot(result, 0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Another thread may have computed the same call meanwhile
+    auto it = index_.find(KeyRef{&entry.args, entry.hash});
+    if (it != index_.end()) {
+        it->second->result = std::move(entry.result);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+
+    if (entries_.size() >= capacity_) {
+        const Entry& oldest = entries_.back();
+        index_.erase(KeyRef{&oldest.args, oldest.hash});
+        entries_.pop_back();
+        stats_.evictions++;
+    }
+    entries_.push_front(std::move(entry));
+    index_.emplace(KeyRef{&entries_.front().args, entries_.front().hash}, entries_.begin());
+}
+
+MemoCache::Stats MemoCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+} // namespace androidscript
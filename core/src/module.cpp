@@ -0,0 +1,102 @@
+#include "module.h"
+#include "lexer.h"
+#include "parser.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace fs = std::filesystem;
+
+ModuleCache& ModuleCache::instance() {
+    static ModuleCache cache;
+    return cache;
+}
+
+std::string ModuleCache::resolve(const std::string& name, const std::string& from_dir) {
+    fs::path path(name);
+    if (path.is_relative() && !from_dir.empty()) {
+        path = fs::path(from_dir) / path;
+    }
+
+    std::error_code error;
+    if (!fs::is_regular_file(path, error)) {
+        throw std::runtime_error("Cannot find module: " + name);
+    }
+    return fs::weakly_canonical(path, error).string();
+}
+
+std::shared_ptr<const Module> ModuleCache::load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = modules_.find(path);
+    if (it != modules_.end()) {
+        return it->second;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open module: " + path);
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+
+    auto module = std::make_shared<Module>();
+    module->path = path;
+
+    Lexer lexer(buffer.str());
+    std::vector<Token> tokens = lexer.tokenize();
+    if (lexer.hasErrors()) {
+        throw std::runtime_error(path + ": " + lexer.getErrors().front());
+    }
+
+    Parser parser(tokens);
+    module->program = parser.parse();
+    if (parser.hasErrors()) {
+        throw std::runtime_error(path + ": " + parser.getErrors().front());
+    }
+
+    modules_.emplace(path, module);
+    return module;
+}
+
+std::shared_ptr<Environment> makeModuleScope(const std::shared_ptr<Environment>& globals) {
+    // Shared builtins are inherited; natives defined in the importer's own
+    // scopes (extensions) are copied
+    auto env = globals;
+    while (env && !env->isFrozen()) env = env->getParent();
+    auto scope = env ? std::make_shared<Environment>(env) : std::make_shared<Environment>();
+
+    for (env = globals; env && !env->isFrozen(); env = env->getParent()) {
+        for (const auto& entry : env->variables()) {
+            if (entry.second.isNativeFunction() && !scope->variables().count(entry.first)) {
+                scope->define(entry.first, entry.second);
+            }
+        }
+    }
+    return scope;
+}
+
+Value moduleExports(const Environment& scope, const Environment& globals) {
+    ValueMap exports;
+    for (const auto& entry : scope.variables()) {
+        if (entry.second.isNativeFunction() && globals.exists(entry.first)) continue;
+        exports.emplace(entry.first, entry.second);
+    }
+    return Value::makeObject(std::move(exports));
+}
+
+std::string defaultModuleName(const std::string& path) {
+    std::string name = fs::path(path).stem().string();
+    for (char& c : name) {
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        if (!valid) c = '_';
+    }
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+        name = "_" + name;
+    }
+    return name;
+}
+
+} // namespace androidscript
@@ -0,0 +1,114 @@
+#include "named_args.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace androidscript {
+
+using CompiledFunction = Value (*)(const std::vector<Value>&, const std::shared_ptr<Environment>&);
+
+struct NamedArgCache::Binding {
+    // Callee identity: the function body (interpreted), the C++ function
+    // (compiled) or the native, which is kept alive so its address cannot
+    // be reused by another native
+    const void* body;
+    CompiledFunction compiled;
+    Value native;
+
+    size_t arg_count;
+    std::vector<size_t> slots;  // Parameter slot of each named argument
+
+    bool matches(const Value& callee) const {
+        if (callee.isFunction()) {
+            const FunctionObject& func = callee.asFunction();
+            return native.isNil() && func.body.get() == body && func.compiled == compiled;
+        }
+        return callee.isNativeFunction() && native.isNativeFunction() &&
+               &callee.asNativeFunction() == &native.asNativeFunction();
+    }
+};
+
+namespace {
+
+std::string bareName(const std::string& name) {
+    return !name.empty() && name[0] == '$' ? name.substr(1) : name;
+}
+
+} // namespace
+
+NamedArgCache::NamedArgCache(std::vector<std::string> names, size_t positional,
+                             std::string callee_name)
+    : names_(std::move(names)), positional_(positional), callee_name_(std::move(callee_name)) {}
+
+std::vector<Value> NamedArgCache::bind(const Value& callee, std::vector<Value>&& args) const {
+    std::shared_ptr<const Binding> binding = std::atomic_load(&binding_);
+    if (!binding || !binding->matches(callee)) {
+        binding = resolve(callee);
+        std::atomic_store(&binding_, binding);
+    }
+
+    std::vector<Value> slots(binding->arg_count);
+    for (size_t i = 0; i < positional_; ++i) {
+        slots[i] = std::move(args[i]);
+    }
+    for (size_t i = 0; i < binding->slots.size(); ++i) {
+        slots[binding->slots[i]] = std::move(args[positional_ + i]);
+    }
+    return slots;
+}
+
+std::shared_ptr<const NamedArgCache::Binding> NamedArgCache::resolve(const Value& callee) const {
+    auto binding = std::make_shared<Binding>();
+    binding->body = nullptr;
+    binding->compiled = nullptr;
+
+    const std::vector<std::string>* parameters;
+    bool natives_may_skip = false;
+    if (callee.isFunction()) {
+        const FunctionObject& func = callee.asFunction();
+        binding->body = func.body.get();
+        binding->compiled = func.compiled;
+        parameters = &func.parameters;
+    } else if (callee.isNativeFunction()) {
+        binding->native = callee;
+        parameters = &callee.nativeParameters();
+        natives_may_skip = true;
+        if (parameters->empty()) fail("does not take named arguments");
+    } else {
+        throw std::runtime_error("Value is not callable");
+    }
+
+    if (positional_ > parameters->size()) {
+        fail("takes at most " + std::to_string(parameters->size()) + " arguments");
+    }
+
+    std::vector<bool> filled(parameters->size(), false);
+    for (size_t i = 0; i < positional_; ++i) filled[i] = true;
+
+    size_t count = positional_;
+    for (const std::string& name : names_) {
+        std::string bare = bareName(name);
+        size_t slot = 0;
+        while (slot < parameters->size() && bareName((*parameters)[slot]) != bare) ++slot;
+        if (slot == parameters->size()) fail("has no parameter '" + bare + "'");
+        if (filled[slot]) fail("got parameter '" + bare + "' twice");
+        filled[slot] = true;
+        binding->slots.push_back(slot);
+        count = std::max(count, slot + 1);
+    }
+
+    // Natives see skipped parameters as nil; script functions need them all
+    for (size_t i = 0; i < parameters->size(); ++i) {
+        if (filled[i]) continue;
+        if (!natives_may_skip) fail("is missing parameter '" + bareName((*parameters)[i]) + "'");
+    }
+    binding->arg_count = natives_may_skip ? count : parameters->size();
+    return binding;
+}
+
+void NamedArgCache::fail(const std::string& message) const {
+    std::string callee = callee_name_.empty() ? "Function" : callee_name_ + "()";
+    throw std::runtime_error(callee + " " + message);
+}
+
+} // namespace androidscript
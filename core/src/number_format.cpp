@@ -0,0 +1,69 @@
+#include "number_format.h"
+#include <cctype>
+#include <charconv>
+#include <system_error>
+
+namespace androidscript {
+
+namespace {
+
+// Enough for any int64_t and for the shortest form of any double
+constexpr size_t kNumberBufferSize = 32;
+
+std::string_view skipLeadingSpaceAndPlus(std::string_view text) {
+    size_t i = 0;
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+    if (i < text.size() && text[i] == '+') ++i;
+    return text.substr(i);
+}
+
+} // namespace
+
+void appendInt(std::string& out, int64_t value) {
+    char buf[kNumberBufferSize];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+void appendFloat(std::string& out, double value) {
+    char buf[kNumberBufferSize];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+std::string formatInt(int64_t value) {
+    // Already exact and sized up front in the standard library
+    return std::to_string(value);
+}
+
+std::string formatFloat(double value) {
+    char buf[kNumberBufferSize];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    return std::string(buf, result.ptr);
+}
+
+bool parseInt(std::string_view text, int64_t& out) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseFloat(std::string_view text, double& out) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseIntPrefix(std::string_view text, int64_t& out) {
+    text = skipLeadingSpaceAndPlus(text);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc();
+}
+
+bool parseFloatPrefix(std::string_view text, double& out) {
+    text = skipLeadingSpaceAndPlus(text);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc();
+}
+
+} // namespace androidscript
@@ -1,4 +1,5 @@
 #include "parser.h"
+#include "named_args.h"
 #include <sstream>
 
 namespace androidscript {
@@ -25,30 +26,42 @@ std::vector<std::unique_ptr<Statement>> Parser::parse() {
 }
 
 std::unique_ptr<Statement> Parser::declaration() {
+    int line = peek().line;
     if (match(TokenType::FUNCTION)) {
-        return functionDeclaration();
+        return at(line, functionDeclaration());
     }
     return statement();
 }
 
 std::unique_ptr<Statement> Parser::statement() {
-    if (match(TokenType::IF)) return ifStatement();
-    if (match(TokenType::WHILE)) return whileStatement();
-    if (match(TokenType::FOR)) return forStatement();
-    if (match(TokenType::FOREACH)) return forEachStatement();
-    if (match(TokenType::REPEAT)) return repeatStatement();
-    if (match(TokenType::RETURN)) return returnStatement();
-    if (match(TokenType::BREAK)) return breakStatement();
-    if (match(TokenType::CONTINUE)) return continueStatement();
+    // Blocks have no line of their own; their statements do
     if (match(TokenType::LBRACE)) return blockStatement();
-    if (match(TokenType::TRY)) return tryStatement();
+
+    int line = peek().line;
+    if (match(TokenType::IF)) return at(line, ifStatement());
+    if (match(TokenType::WHILE)) return at(line, whileStatement());
+    if (match(TokenType::FOR)) return at(line, forStatement());
+    if (match(TokenType::FOREACH)) return at(line, forEachStatement());
+    if (match(TokenType::REPEAT)) return at(line, repeatStatement());
+    if (match(TokenType::RETURN)) return at(line, returnStatement());
+    if (match(TokenType::BREAK)) return at(line, breakStatement());
+    if (match(TokenType::CONTINUE)) return at(line, continueStatement());
+    if (match(TokenType::TRY)) return at(line, tryStatement());
+    if (match(TokenType::DIRECTIVE)) return at(line, directiveStatement());
 
     // Check for assignment (variable followed by =)
     if (check(TokenType::IDENTIFIER) && tokens_[current_ + 1].type == TokenType::ASSIGN) {
-        return assignmentStatement();
+        return at(line, assignmentStatement());
     }
 
-    return expressionStatement();
+    return at(line, expressionStatement());
+}
+
+std::unique_ptr<Statement> Parser::at(int line, std::unique_ptr<Statement> stmt) {
+    if (stmt) {
+        stmt->line = line;
+    }
+    return stmt;
 }
 
 std::unique_ptr<Statement> Parser::expressionStatement() {
@@ -146,8 +159,14 @@ std::unique_ptr<Statement> Parser::forStatement() {
 }
 
 std::unique_ptr<Statement> Parser::forEachStatement() {
-    // TODO: Implement foreach parsing
-    return nullptr;
+    consume(TokenType::LPAREN, "Expected '(' after 'ForEach'");
+    Token variable = consume(TokenType::IDENTIFIER, "Expected variable name in ForEach");
+    consume(TokenType::IN, "Expected 'in' after ForEach variable");
+    auto iterable = expression();
+    consume(TokenType::RPAREN, "Expected ')' after ForEach clause");
+    auto body = statement();
+
+    return std::make_unique<ForEachStmt>(variable, std::move(iterable), std::move(body));
 }
 
 std::unique_ptr<Statement> Parser::repeatStatement() {
@@ -156,13 +175,26 @@ std::unique_ptr<Statement> Parser::repeatStatement() {
 }
 
 std::unique_ptr<Statement> Parser::functionDeclaration() {
-    // TODO: Implement function declaration parsing
-    return nullptr;
+    Token name = consume(TokenType::IDENTIFIER, "Expected function name");
+    consume(TokenType::LPAREN, "Expected '(' after function name");
+
+    std::vector<Token> parameters;
+    if (!check(TokenType::RPAREN)) {
+        do {
+            parameters.push_back(consume(TokenType::IDENTIFIER, "Expected parameter name"));
+        } while (match(TokenType::COMMA));
+    }
+    consume(TokenType::RPAREN, "Expected ')' after parameters");
+
+    consume(TokenType::LBRACE, "Expected '{' before function body");
+    std::unique_ptr<BlockStmt> body(static_cast<BlockStmt*>(blockStatement().release()));
+
+    return std::make_unique<FunctionStmt>(name, std::move(parameters), std::move(body));
 }
 
 std::unique_ptr<Statement> Parser::returnStatement() {
     std::unique_ptr<Expression> value = nullptr;
-    if (!check(TokenType::SEMICOLON) && !isAtEnd()) {
+    if (!check(TokenType::SEMICOLON) && !check(TokenType::RBRACE) && !isAtEnd()) {
         value = expression();
     }
     return std::make_unique<ReturnStmt>(std::move(value));
@@ -181,6 +213,23 @@ std::unique_ptr<Statement> Parser::tryStatement() {
     return nullptr;
 }
 
+std::unique_ptr<Statement> Parser::directiveStatement() {
+    Token directive = previous();
+    if (directive.lexeme != "#include" && directive.lexeme != "#import") {
+        throw std::runtime_error("Unknown directive '" + directive.lexeme + "'");
+    }
+
+    Token path = consume(TokenType::STRING, "Expected file name after " + directive.lexeme);
+
+    Token alias;
+    if (directive.lexeme == "#import" && check(TokenType::IDENTIFIER) && peek().lexeme == "as") {
+        advance();
+        alias = consume(TokenType::IDENTIFIER, "Expected module name after 'as'");
+    }
+
+    return std::make_unique<ImportStmt>(directive, path, alias);
+}
+
 std::unique_ptr<Expression> Parser::expression() {
     return logicalOr();
 }
@@ -273,13 +322,43 @@ std::unique_ptr<Expression> Parser::call() {
     while (true) {
         if (match(TokenType::LPAREN)) {
             std::vector<std::unique_ptr<Expression>> args;
+            std::vector<std::pair<std::string, std::unique_ptr<Expression>>> named;
+            std::vector<std::string> names;
             if (!check(TokenType::RPAREN)) {
                 do {
-                    args.push_back(expression());
+                    // name: value
+                    if (check(TokenType::IDENTIFIER) && current_ + 1 < tokens_.size() &&
+                        tokens_[current_ + 1].type == TokenType::COLON) {
+                        std::string name = advance().lexeme;
+                        advance();  // ':'
+                        for (const auto& other : names) {
+                            if (other == name) {
+                                throw std::runtime_error("Named argument '" + name + "' given twice");
+                            }
+                        }
+                        names.push_back(name);
+                        named.emplace_back(name, expression());
+                    } else if (!named.empty()) {
+                        throw std::runtime_error("Positional argument after named arguments");
+                    } else {
+                        args.push_back(expression());
+                    }
                 } while (match(TokenType::COMMA));
             }
             consume(TokenType::RPAREN, "Expected ')' after arguments");
-            expr = std::make_unique<CallExpr>(std::move(expr), std::move(args));
+
+            std::string callee_name;
+            if (auto* variable = dynamic_cast<VariableExpr*>(expr.get())) {
+                callee_name = variable->name.lexeme;
+            }
+            size_t positional = args.size();
+            auto call = std::make_unique<CallExpr>(std::move(expr), std::move(args));
+            if (!named.empty()) {
+                call->named_args = std::move(named);
+                call->named_cache = std::make_shared<NamedArgCache>(std::move(names), positional,
+                                                                    callee_name);
+            }
+            expr = std::move(call);
         } else if (match(TokenType::DOT)) {
             Token member = consume(TokenType::IDENTIFIER, "Expected property name after '.'");
             expr = std::make_unique<MemberExpr>(std::move(expr), member);
@@ -336,16 +415,16 @@ std::unique_ptr<Expression> Parser::primary() {
     throw std::runtime_error("Expected expression");
 }
 
-Token Parser::advance() {
+const Token& Parser::advance() {
     if (!isAtEnd()) current_++;
     return previous();
 }
 
-Token Parser::peek() const {
+const Token& Parser::peek() const {
     return tokens_[current_];
 }
 
-Token Parser::previous() const {
+const Token& Parser::previous() const {
     return tokens_[current_ - 1];
 }
 
@@ -372,7 +451,7 @@ bool Parser::match(const std::vector<TokenType>& types) {
     return false;
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
+const Token& Parser::consume(TokenType type, const std::string& message) {
     if (check(type)) return advance();
     throw std::runtime_error(message);
 }
@@ -0,0 +1,150 @@
+#include "profiler.h"
+#include "adb_client.h"
+#include "value.h"
+#include <algorithm>
+
+namespace androidscript {
+
+namespace {
+
+// Profiler started on this thread, for adb phase reports
+thread_local SamplingProfiler* t_profiler = nullptr;
+
+} // namespace
+
+SamplingProfiler::SamplingProfiler(const std::string& script_name,
+                                   std::chrono::microseconds interval)
+    : interval_(interval) {
+    frames_[0].name.store(intern(this, script_name), std::memory_order_relaxed);
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    stop();
+}
+
+void SamplingProfiler::start() {
+    if (running_.exchange(true)) return;
+
+    t_profiler = this;
+    setCommandPhaseHook(&SamplingProfiler::onPhase);
+
+    sampler_ = std::thread([this]() {
+        std::vector<uint64_t> stack;
+        auto next = std::chrono::steady_clock::now() + interval_;
+        while (running_.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_until(next);
+            sample(stack);
+            // After a stall, keep the interval rather than catching up with
+            // a burst of samples of the same stack
+            next = std::max(next + interval_, std::chrono::steady_clock::now());
+        }
+    });
+}
+
+void SamplingProfiler::stop() {
+    if (!running_.exchange(false)) return;
+
+    sampler_.join();
+    if (t_profiler == this) {
+        setCommandPhaseHook(nullptr);
+        t_profiler = nullptr;
+    }
+}
+
+void SamplingProfiler::sample(std::vector<uint64_t>& stack) {
+    size_t depth = std::min(depth_.load(std::memory_order_acquire), kMaxDepth);
+    stack.clear();
+    for (size_t i = 0; i < depth; ++i) {
+        uint64_t name = frames_[i].name.load(std::memory_order_relaxed);
+        uint32_t line = static_cast<uint32_t>(frames_[i].line.load(std::memory_order_relaxed));
+        stack.push_back(name << 32 | line);
+    }
+    stacks_[stack]++;
+    samples_++;
+}
+
+// Shadow stack (interpreter thread)
+
+uint32_t SamplingProfiler::intern(const void* key, const std::string& name) {
+    auto it = ids_.find(key);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(key, id);
+    return id;
+}
+
+void SamplingProfiler::push(uint32_t name) {
+    size_t depth = depth_.load(std::memory_order_relaxed);
+    if (depth < kMaxDepth) {
+        frames_[depth].name.store(name, std::memory_order_relaxed);
+        frames_[depth].line.store(0, std::memory_order_relaxed);
+    }
+    depth_.store(depth + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::pop() {
+    depth_.store(depth_.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+}
+
+void SamplingProfiler::onStatement(Interpreter& /* interpreter */, Statement& stmt) {
+    size_t depth = depth_.load(std::memory_order_relaxed);
+    if (depth <= kMaxDepth) {
+        frames_[depth - 1].line.store(stmt.line, std::memory_order_relaxed);
+    }
+}
+
+void SamplingProfiler::onCall(Interpreter& /* interpreter */, const FunctionObject& fn) {
+    push(intern(fn.body.get(), fn.name.empty() ? "<function>" : fn.name));
+}
+
+void SamplingProfiler::onReturn(Interpreter& /* interpreter */, const FunctionObject& /* fn */) {
+    pop();
+}
+
+void SamplingProfiler::onNativeCall(Interpreter& /* interpreter */, const CallExpr& call) {
+    auto it = ids_.find(&call);
+    push(it != ids_.end() ? it->second : intern(&call, calleeName(call)));
+}
+
+void SamplingProfiler::onNativeReturn(Interpreter& /* interpreter */, const CallExpr& /* call */) {
+    pop();
+}
+
+void SamplingProfiler::onPhase(const char* phase) {
+    SamplingProfiler* self = t_profiler;
+    if (!self) return;
+
+    if (self->in_phase_) {
+        self->pop();
+        self->in_phase_ = false;
+    }
+    if (phase) {
+        self->push(self->intern(phase, phase));
+        self->in_phase_ = true;
+    }
+}
+
+// Output
+
+void SamplingProfiler::writeFolded(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    for (const auto& entry : stacks_) {
+        bool first = true;
+        for (uint64_t frame : entry.first) {
+            uint32_t line = static_cast<uint32_t>(frame & 0xffffffffu);
+            out << (first ? "" : ";") << names_[frame >> 32];
+            if (line) {
+                out << ":" << line;
+            }
+            first = false;
+        }
+        out << " " << entry.second << "\n";
+    }
+}
+
+} // namespace androidscript
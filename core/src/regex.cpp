@@ -0,0 +1,830 @@
+#include "regex.h"
+#include "string_kernels.h"
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace androidscript {
+
+namespace {
+
+constexpr size_t kMaxProgramSize = 100000;
+constexpr int kMaxRepeat = 1000;
+constexpr int kUnbounded = -1;
+constexpr size_t kMaxCachedPatterns = 256;
+
+// Groups and stacked quantifiers nest this deep at most. Parsing, compiling
+// and freeing the tree recurse once per level, and tasks run on 1 MiB stacks.
+constexpr int kMaxDepth = 256;
+
+// Each thread list keeps capture slots for every instruction, so its size
+// is program size times slot count. Both are capped, and scratch grown past
+// kKeptCaptureSlots is freed after the search instead of kept per thread.
+constexpr size_t kMaxGroups = 1000;
+constexpr size_t kMaxCaptureSlots = size_t(1) << 24;
+constexpr size_t kKeptCaptureSlots = size_t(1) << 20;
+
+using ByteSet = std::bitset<256>;
+
+enum class Op : uint8_t {
+    Byte,             // Consume byte
+    Any,              // Consume any byte but '\n'
+    AnyByte,          // Consume any byte ((?s) mode)
+    Class,            // Consume a byte in classes[x]
+    Split,            // Continue at x, then (lower priority) at y
+    Jump,             // Continue at x
+    Save,             // Record the position in capture slot x
+    AssertBol,
+    AssertEol,
+    WordBoundary,
+    NotWordBoundary,
+    Match
+};
+
+struct Inst {
+    Op op;
+    unsigned char byte;
+    uint32_t x;
+    uint32_t y;
+};
+
+struct Node {
+    enum class Kind { Empty, Byte, Any, Class, Assert, Concat, Alternate, Repeat, Group };
+
+    Kind kind;
+    unsigned char byte = 0;
+    size_t index = 0;       // Class index or capture group (0 = non-capturing)
+    Op assertion = Op::AssertBol;
+    int min = 0;
+    int max = 0;
+    bool greedy = true;
+    std::vector<std::unique_ptr<Node>> children;
+
+    explicit Node(Kind k) : kind(k) {}
+};
+
+using NodePtr = std::unique_ptr<Node>;
+
+bool isWordByte(unsigned char c) {
+    return std::isalnum(c) || c == '_';
+}
+
+int singleByte(const ByteSet& set) {
+    if (set.count() != 1) return -1;
+    for (int b = 0; b < 256; ++b) {
+        if (set[b]) return b;
+    }
+    return -1;
+}
+
+} // namespace
+
+struct RegexProgram {
+    std::string pattern;
+    std::vector<Inst> code;
+    std::vector<ByteSet> classes;
+    size_t group_count = 0;
+    bool multiline = false;
+    bool anchored = false;            // Can only match at offset 0
+    std::string prefix;               // Every match starts with this
+    bool use_first_bytes = false;     // Every match starts with one of these
+    ByteSet first_bytes;
+};
+
+namespace {
+
+// Recursive-descent parser from pattern text to a Node tree
+class Parser {
+public:
+    Parser(const std::string& pattern, RegexProgram& program)
+        : pattern_(pattern), program_(program), pos_(0), depth_(0), icase_(false), dotall_(false) {}
+
+    NodePtr parse() {
+        parseFlags();
+        NodePtr root = parseAlternation();
+        if (pos_ < pattern_.size()) error("unmatched ')'");
+        return root;
+    }
+
+    bool dotall() const { return dotall_; }
+
+private:
+    const std::string& pattern_;
+    RegexProgram& program_;
+    size_t pos_;
+    int depth_;  // Enclosing groups
+    bool icase_;
+    bool dotall_;
+
+    [[noreturn]] void error(const std::string& message) const {
+        throw std::runtime_error("Invalid regex \"" + pattern_ + "\": " + message);
+    }
+
+    bool atEnd() const { return pos_ >= pattern_.size(); }
+    char peek() const { return pattern_[pos_]; }
+
+    void parseFlags() {
+        if (pattern_.compare(0, 2, "(?") != 0) return;
+        size_t p = 2;
+        bool icase = false, multiline = false, dotall = false;
+        while (p < pattern_.size()) {
+            char c = pattern_[p];
+            if (c == 'i') icase = true;
+            else if (c == 'm') multiline = true;
+            else if (c == 's') dotall = true;
+            else break;
+            ++p;
+        }
+        if (p == 2 || p >= pattern_.size() || pattern_[p] != ')') return;
+
+        pos_ = p + 1;
+        icase_ = icase;
+        dotall_ = dotall;
+        program_.multiline = multiline;
+    }
+
+    NodePtr parseAlternation() {
+        std::vector<NodePtr> branches;
+        branches.push_back(parseConcat());
+        while (!atEnd() && peek() == '|') {
+            ++pos_;
+            branches.push_back(parseConcat());
+        }
+        if (branches.size() == 1) return std::move(branches[0]);
+
+        auto node = std::make_unique<Node>(Node::Kind::Alternate);
+        node->children = std::move(branches);
+        return node;
+    }
+
+    NodePtr parseConcat() {
+        std::vector<NodePtr> items;
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            items.push_back(parseRepeat());
+        }
+        if (items.empty()) return std::make_unique<Node>(Node::Kind::Empty);
+        if (items.size() == 1) return std::move(items[0]);
+
+        auto node = std::make_unique<Node>(Node::Kind::Concat);
+        node->children = std::move(items);
+        return node;
+    }
+
+    NodePtr parseRepeat() {
+        NodePtr atom = parseAtom();
+
+        int stacked = 0;
+        while (!atEnd()) {
+            int min, max;
+            char c = peek();
+            if (c == '*') {
+                min = 0; max = kUnbounded; ++pos_;
+            } else if (c == '+') {
+                min = 1; max = kUnbounded; ++pos_;
+            } else if (c == '?') {
+                min = 0; max = 1; ++pos_;
+            } else if (c != '{' || !parseBraces(min, max)) {
+                break;
+            }
+
+            bool greedy = true;
+            if (!atEnd() && peek() == '?') {
+                greedy = false;
+                ++pos_;
+            }
+            if (atom->kind == Node::Kind::Assert) error("nothing to repeat");
+            if (depth_ + ++stacked > kMaxDepth) error("pattern nested too deeply");
+
+            auto node = std::make_unique<Node>(Node::Kind::Repeat);
+            node->min = min;
+            node->max = max;
+            node->greedy = greedy;
+            node->children.push_back(std::move(atom));
+            atom = std::move(node);
+        }
+        return atom;
+    }
+
+    // {m}, {m,} or {m,n}; anything else leaves '{' to be read as a literal
+    bool parseBraces(int& min, int& max) {
+        size_t p = pos_ + 1;
+        auto number = [&](int& out) {
+            size_t start = p;
+            long value = 0;
+            while (p < pattern_.size() && std::isdigit(static_cast<unsigned char>(pattern_[p]))) {
+                value = value * 10 + (pattern_[p] - '0');
+                if (value > kMaxRepeat) error("repeat count too large");
+                ++p;
+            }
+            out = static_cast<int>(value);
+            return p > start;
+        };
+
+        if (!number(min)) return false;
+        max = min;
+        if (p < pattern_.size() && pattern_[p] == ',') {
+            ++p;
+            if (!number(max)) max = kUnbounded;
+        }
+        if (p >= pattern_.size() || pattern_[p] != '}') return false;
+        if (max != kUnbounded && max < min) error("bad repeat range");
+
+        pos_ = p + 1;
+        return true;
+    }
+
+    NodePtr parseAtom() {
+        char c = pattern_[pos_++];
+        switch (c) {
+            case '(': {
+                size_t group = 0;
+                if (pattern_.compare(pos_, 2, "?:") == 0) {
+                    pos_ += 2;
+                } else if (!atEnd() && peek() == '?') {
+                    error("unsupported group syntax");
+                } else {
+                    if (program_.group_count >= kMaxGroups) error("too many capture groups");
+                    group = ++program_.group_count;
+                }
+                if (++depth_ > kMaxDepth) error("pattern nested too deeply");
+                NodePtr body = parseAlternation();
+                if (atEnd() || peek() != ')') error("missing ')'");
+                ++pos_;
+                --depth_;
+
+                auto node = std::make_unique<Node>(Node::Kind::Group);
+                node->index = group;
+                node->children.push_back(std::move(body));
+                return node;
+            }
+            case '[':
+                return classNode(parseClass());
+            case '.':
+                return std::make_unique<Node>(Node::Kind::Any);
+            case '^':
+                return assertNode(Op::AssertBol);
+            case '$':
+                return assertNode(Op::AssertEol);
+            case '*':
+            case '+':
+            case '?':
+                error("nothing to repeat");
+            case '\\': {
+                if (!atEnd() && peek() == 'b') {
+                    ++pos_;
+                    return assertNode(Op::WordBoundary);
+                }
+                if (!atEnd() && peek() == 'B') {
+                    ++pos_;
+                    return assertNode(Op::NotWordBoundary);
+                }
+                ByteSet set = parseEscape();
+                int b = singleByte(set);
+                return b >= 0 ? literalNode(static_cast<unsigned char>(b)) : classNode(set);
+            }
+            default:
+                return literalNode(static_cast<unsigned char>(c));
+        }
+    }
+
+    ByteSet parseEscape() {
+        if (atEnd()) error("trailing backslash");
+        unsigned char c = static_cast<unsigned char>(pattern_[pos_++]);
+
+        ByteSet set;
+        switch (c) {
+            case 'd': case 'D':
+                for (int b = '0'; b <= '9'; ++b) set.set(b);
+                break;
+            case 'w': case 'W':
+                for (int b = 0; b < 256; ++b) {
+                    if (isWordByte(static_cast<unsigned char>(b))) set.set(b);
+                }
+                break;
+            case 's': case 'S':
+                for (char b : std::string(" \t\n\r\f\v")) set.set(static_cast<unsigned char>(b));
+                break;
+            case 'n': set.set('\n'); break;
+            case 't': set.set('\t'); break;
+            case 'r': set.set('\r'); break;
+            case 'f': set.set('\f'); break;
+            case 'v': set.set('\v'); break;
+            case '0': set.set(0); break;
+            case 'x': {
+                int value = 0;
+                for (int i = 0; i < 2; ++i) {
+                    if (atEnd() || !std::isxdigit(static_cast<unsigned char>(peek()))) {
+                        error("\\x needs two hex digits");
+                    }
+                    char h = pattern_[pos_++];
+                    value = value * 16 + (std::isdigit(static_cast<unsigned char>(h))
+                                              ? h - '0'
+                                              : std::tolower(static_cast<unsigned char>(h)) - 'a' + 10);
+                }
+                set.set(value);
+                break;
+            }
+            default:
+                if (std::isalnum(c)) error(std::string("unknown escape \\") + static_cast<char>(c));
+                set.set(c);
+        }
+        if (c == 'D' || c == 'W' || c == 'S') set.flip();
+        return set;
+    }
+
+    ByteSet parseClass() {
+        bool negate = false;
+        if (!atEnd() && peek() == '^') {
+            negate = true;
+            ++pos_;
+        }
+
+        ByteSet set;
+        bool first = true;
+        while (true) {
+            if (atEnd()) error("missing ']'");
+            if (peek() == ']' && !first) {
+                ++pos_;
+                break;
+            }
+            first = false;
+
+            ByteSet item;
+            int lo = classByte(item);
+            if (lo >= 0 && pos_ + 1 < pattern_.size() && peek() == '-' && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                ByteSet hi_item;
+                int hi = classByte(hi_item);
+                if (hi < lo) error("bad character range");
+                for (int b = lo; b <= hi; ++b) set.set(b);
+            } else {
+                set |= item;
+            }
+        }
+
+        if (icase_) addOtherCase(set);
+        if (negate) set.flip();
+        return set;
+    }
+
+    // One class member; returns the byte when it is a single byte, else -1
+    int classByte(ByteSet& item) {
+        if (peek() == '\\') {
+            ++pos_;
+            item = parseEscape();
+            return singleByte(item);
+        }
+        unsigned char c = static_cast<unsigned char>(pattern_[pos_++]);
+        item.set(c);
+        return c;
+    }
+
+    static void addOtherCase(ByteSet& set) {
+        for (int b = 'a'; b <= 'z'; ++b) {
+            if (set[b] || set[b - 32]) {
+                set.set(b);
+                set.set(b - 32);
+            }
+        }
+    }
+
+    NodePtr literalNode(unsigned char c) {
+        if (icase_ && std::isalpha(c)) {
+            ByteSet set;
+            set.set(c);
+            addOtherCase(set);
+            return classNode(set);
+        }
+        auto node = std::make_unique<Node>(Node::Kind::Byte);
+        node->byte = c;
+        return node;
+    }
+
+    NodePtr classNode(const ByteSet& set) {
+        auto node = std::make_unique<Node>(Node::Kind::Class);
+        node->index = program_.classes.size();
+        program_.classes.push_back(set);
+        return node;
+    }
+
+    NodePtr assertNode(Op op) {
+        auto node = std::make_unique<Node>(Node::Kind::Assert);
+        node->assertion = op;
+        return node;
+    }
+
+};
+
+// Node tree to Pike VM instructions
+class Compiler {
+public:
+    Compiler(RegexProgram& program, bool dotall) : program_(program), dotall_(dotall) {}
+
+    void compile(const Node& root) {
+        emit({Op::Save, 0, 0, 0});
+        compileNode(root);
+        emit({Op::Save, 0, 1, 0});
+        emit({Op::Match, 0, 0, 0});
+    }
+
+private:
+    RegexProgram& program_;
+    bool dotall_;
+
+    uint32_t pc() const { return static_cast<uint32_t>(program_.code.size()); }
+
+    uint32_t emit(const Inst& inst) {
+        if (program_.code.size() >= kMaxProgramSize) {
+            throw std::runtime_error("Invalid regex \"" + program_.pattern + "\": pattern too large");
+        }
+        program_.code.push_back(inst);
+        return pc() - 1;
+    }
+
+    // Split preferring first, or second for lazy quantifiers
+    void patchSplit(uint32_t split, uint32_t preferred, uint32_t other, bool greedy) {
+        program_.code[split].x = greedy ? preferred : other;
+        program_.code[split].y = greedy ? other : preferred;
+    }
+
+    void compileNode(const Node& node) {
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                break;
+            case Node::Kind::Byte:
+                emit({Op::Byte, node.byte, 0, 0});
+                break;
+            case Node::Kind::Any:
+                emit({dotall_ ? Op::AnyByte : Op::Any, 0, 0, 0});
+                break;
+            case Node::Kind::Class:
+                emit({Op::Class, 0, static_cast<uint32_t>(node.index), 0});
+                break;
+            case Node::Kind::Assert:
+                emit({node.assertion, 0, 0, 0});
+                break;
+            case Node::Kind::Concat:
+                for (const auto& child : node.children) compileNode(*child);
+                break;
+            case Node::Kind::Alternate: {
+                std::vector<uint32_t> exits;
+                for (size_t i = 0; i + 1 < node.children.size(); ++i) {
+                    uint32_t split = emit({Op::Split, 0, 0, 0});
+                    program_.code[split].x = pc();
+                    compileNode(*node.children[i]);
+                    exits.push_back(emit({Op::Jump, 0, 0, 0}));
+                    program_.code[split].y = pc();
+                }
+                compileNode(*node.children.back());
+                for (uint32_t exit : exits) program_.code[exit].x = pc();
+                break;
+            }
+            case Node::Kind::Group: {
+                uint32_t slot = static_cast<uint32_t>(2 * node.index);
+                if (node.index) emit({Op::Save, 0, slot, 0});
+                compileNode(*node.children[0]);
+                if (node.index) emit({Op::Save, 0, slot + 1, 0});
+                break;
+            }
+            case Node::Kind::Repeat:
+                compileRepeat(node);
+                break;
+        }
+    }
+
+    void compileRepeat(const Node& node) {
+        const Node& body = *node.children[0];
+
+        // x{3,} is x x x*, written as x x (x)+ to save a split
+        int copies = (node.max == kUnbounded && node.min > 0) ? node.min - 1 : node.min;
+        for (int i = 0; i < copies; ++i) compileNode(body);
+
+        if (node.max == kUnbounded) {
+            if (node.min > 0) {
+                uint32_t loop = pc();
+                compileNode(body);
+                uint32_t split = emit({Op::Split, 0, 0, 0});
+                patchSplit(split, loop, pc(), node.greedy);
+            } else {
+                uint32_t split = emit({Op::Split, 0, 0, 0});
+                compileNode(body);
+                emit({Op::Jump, 0, split, 0});
+                patchSplit(split, split + 1, pc(), node.greedy);
+            }
+            return;
+        }
+
+        // x{2,4} is x x (x (x)?)? with every optional part skipping to the end
+        std::vector<uint32_t> splits;
+        for (int i = node.min; i < node.max; ++i) {
+            splits.push_back(emit({Op::Split, 0, 0, 0}));
+            compileNode(body);
+        }
+        for (uint32_t split : splits) patchSplit(split, split + 1, pc(), node.greedy);
+    }
+};
+
+// Literal bytes every match must start with
+void findPrefix(const Node& root, std::string& prefix) {
+    if (root.kind == Node::Kind::Byte) {
+        prefix += static_cast<char>(root.byte);
+    } else if (root.kind == Node::Kind::Concat) {
+        for (const auto& child : root.children) {
+            if (child->kind != Node::Kind::Byte) break;
+            prefix += static_cast<char>(child->byte);
+        }
+    }
+}
+
+bool startsWithBol(const Node& root) {
+    const Node* first = &root;
+    if (root.kind == Node::Kind::Concat) first = root.children[0].get();
+    return first->kind == Node::Kind::Assert && first->assertion == Op::AssertBol;
+}
+
+// Bytes that can start a match, or false if a match may be empty or start
+// with almost anything
+bool findFirstBytes(const RegexProgram& program, ByteSet& first) {
+    std::vector<bool> seen(program.code.size());
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty()) {
+        uint32_t pc = stack.back();
+        stack.pop_back();
+        if (seen[pc]) continue;
+        seen[pc] = true;
+
+        const Inst& inst = program.code[pc];
+        switch (inst.op) {
+            case Op::Byte: first.set(inst.byte); break;
+            case Op::Class: first |= program.classes[inst.x]; break;
+            case Op::Split: stack.push_back(inst.x); stack.push_back(inst.y); break;
+            case Op::Jump: stack.push_back(inst.x); break;
+            case Op::Save:
+            case Op::AssertBol:
+            case Op::AssertEol:
+            case Op::WordBoundary:
+            case Op::NotWordBoundary:
+                stack.push_back(pc + 1);
+                break;
+            case Op::Any:
+            case Op::AnyByte:
+            case Op::Match:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Pike VM state. Thread lists hold at most one thread per instruction, in
+// priority order, each with its own capture slots.
+struct ThreadList {
+    std::vector<uint32_t> mark;   // Generation in which each pc was visited
+    uint32_t generation = 0;
+    std::vector<uint32_t> order;  // Threads waiting on a consuming instruction
+    std::vector<size_t> caps;     // slot_count entries per pc
+
+    void prepare(size_t program_size, size_t slot_count) {
+        mark.resize(program_size);
+        caps.resize(program_size * slot_count);
+    }
+
+    void release() {
+        std::vector<uint32_t>().swap(mark);
+        std::vector<uint32_t>().swap(order);
+        std::vector<size_t>().swap(caps);
+        generation = 0;
+    }
+
+    void clear() {
+        order.clear();
+        if (++generation == 0) {
+            std::fill(mark.begin(), mark.end(), 0);
+            generation = 1;
+        }
+    }
+};
+
+// Pending work in the epsilon closure: explore a pc, or undo a Save
+struct Frame {
+    static constexpr uint32_t kExplore = UINT32_MAX;
+    uint32_t pc;
+    uint32_t slot;
+    size_t value;
+};
+
+struct Scratch {
+    ThreadList lists[2];
+    std::vector<size_t> caps;
+    std::vector<Frame> stack;
+};
+
+// Searches never call back into script code, so one scratch per thread is
+// enough and is reused across calls
+thread_local Scratch t_scratch;
+
+class PikeVM {
+public:
+    PikeVM(const RegexProgram& program, std::string_view text)
+        : program_(program), text_(text), slots_(2 * (program.group_count + 1)),
+          scratch_(t_scratch) {
+        for (auto& list : scratch_.lists) list.prepare(program.code.size(), slots_);
+        scratch_.caps.resize(slots_);
+    }
+
+    ~PikeVM() {
+        for (auto& list : scratch_.lists) {
+            if (list.caps.size() > kKeptCaptureSlots) {
+                list.release();
+            }
+        }
+    }
+
+    bool search(size_t from, std::vector<size_t>& groups) {
+        const size_t n = text_.size();
+        ThreadList* clist = &scratch_.lists[0];
+        ThreadList* nlist = &scratch_.lists[1];
+        bool matched = false;
+        clist->clear();
+
+        for (size_t sp = from;; ++sp) {
+            if (!matched) {
+                if (clist->order.empty()) {
+                    // Nothing in flight: skip ahead to where a match could start
+                    if (program_.anchored && sp > 0) break;
+                    if (!program_.prefix.empty()) {
+                        sp = findSubstring(text_, program_.prefix, sp);
+                        if (sp == kNotFound) break;
+                    } else if (program_.use_first_bytes) {
+                        while (sp < n && !program_.first_bytes[static_cast<unsigned char>(text_[sp])]) ++sp;
+                        if (sp == n) break;
+                    }
+                    clist->clear();
+                }
+                std::fill(scratch_.caps.begin(), scratch_.caps.end(), Regex::kNoGroup);
+                addThread(*clist, 0, sp);
+            }
+            if (clist->order.empty()) {
+                // The start thread died on an assertion; try the next byte
+                if (matched || sp >= n) break;
+                continue;
+            }
+
+            nlist->clear();
+            for (uint32_t pc : clist->order) {
+                const size_t* caps = &clist->caps[pc * slots_];
+                const Inst& inst = program_.code[pc];
+                if (inst.op == Op::Match) {
+                    // Lower-priority threads can no longer win
+                    matched = true;
+                    groups.assign(caps, caps + slots_);
+                    break;
+                }
+                if (sp < n && consumes(inst, static_cast<unsigned char>(text_[sp]))) {
+                    std::copy(caps, caps + slots_, scratch_.caps.begin());
+                    addThread(*nlist, pc + 1, sp + 1);
+                }
+            }
+            std::swap(clist, nlist);
+            if (sp >= n) break;
+        }
+        return matched;
+    }
+
+private:
+    const RegexProgram& program_;
+    std::string_view text_;
+    size_t slots_;
+    Scratch& scratch_;
+
+    bool consumes(const Inst& inst, unsigned char c) const {
+        switch (inst.op) {
+            case Op::Byte: return c == inst.byte;
+            case Op::Any: return c != '\n';
+            case Op::AnyByte: return true;
+            case Op::Class: return program_.classes[inst.x][c];
+            default: return false;
+        }
+    }
+
+    bool assertionHolds(Op op, size_t pos) const {
+        const size_t n = text_.size();
+        switch (op) {
+            case Op::AssertBol:
+                return pos == 0 || (program_.multiline && text_[pos - 1] == '\n');
+            case Op::AssertEol:
+                return pos == n || (program_.multiline && text_[pos] == '\n');
+            default: {
+                bool before = pos > 0 && isWordByte(static_cast<unsigned char>(text_[pos - 1]));
+                bool after = pos < n && isWordByte(static_cast<unsigned char>(text_[pos]));
+                return (before != after) == (op == Op::WordBoundary);
+            }
+        }
+    }
+
+    // Follow the epsilon closure of pc at pos in priority order, adding a
+    // thread for each consuming instruction reached; scratch_.caps holds the
+    // captures on entry
+    void addThread(ThreadList& list, uint32_t start, size_t pos) {
+        auto& stack = scratch_.stack;
+        auto& caps = scratch_.caps;
+        stack.clear();
+        stack.push_back({start, Frame::kExplore, 0});
+
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            if (frame.slot != Frame::kExplore) {
+                caps[frame.slot] = frame.value;
+                continue;
+            }
+
+            uint32_t pc = frame.pc;
+            if (list.mark[pc] == list.generation) continue;
+            list.mark[pc] = list.generation;
+
+            const Inst& inst = program_.code[pc];
+            switch (inst.op) {
+                case Op::Jump:
+                    stack.push_back({inst.x, Frame::kExplore, 0});
+                    break;
+                case Op::Split:
+                    stack.push_back({inst.y, Frame::kExplore, 0});
+                    stack.push_back({inst.x, Frame::kExplore, 0});
+                    break;
+                case Op::Save:
+                    stack.push_back({0, inst.x, caps[inst.x]});
+                    caps[inst.x] = pos;
+                    stack.push_back({pc + 1, Frame::kExplore, 0});
+                    break;
+                case Op::AssertBol:
+                case Op::AssertEol:
+                case Op::WordBoundary:
+                case Op::NotWordBoundary:
+                    if (assertionHolds(inst.op, pos)) {
+                        stack.push_back({pc + 1, Frame::kExplore, 0});
+                    }
+                    break;
+                default:
+                    list.order.push_back(pc);
+                    std::copy(caps.begin(), caps.end(), list.caps.begin() + pc * slots_);
+            }
+        }
+    }
+};
+
+} // namespace
+
+Regex::Regex(const std::string& pattern) : program_(std::make_unique<RegexProgram>()) {
+    RegexProgram& program = *program_;
+    program.pattern = pattern;
+
+    Parser parser(pattern, program);
+    NodePtr root = parser.parse();
+    Compiler(program, parser.dotall()).compile(*root);
+    if (program.code.size() * 2 * (program.group_count + 1) > kMaxCaptureSlots) {
+        throw std::runtime_error("Invalid regex \"" + pattern + "\": pattern too large");
+    }
+
+    // Prefilters let the search skip text where no match can start
+    program.anchored = !program.multiline && startsWithBol(*root);
+    findPrefix(*root, program.prefix);
+    if (program.prefix.empty()) {
+        program.use_first_bytes = findFirstBytes(program, program.first_bytes);
+    }
+}
+
+Regex::~Regex() = default;
+
+std::shared_ptr<const Regex> Regex::compile(const std::string& pattern) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const Regex>> cache;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(pattern);
+        if (it != cache.end()) return it->second;
+    }
+
+    // Compile outside the lock; a racing thread may compile it too
+    auto regex = std::make_shared<const Regex>(pattern);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cache.size() >= kMaxCachedPatterns) cache.clear();
+    cache.emplace(pattern, regex);
+    return regex;
+}
+
+size_t Regex::groupCount() const {
+    return program_->group_count;
+}
+
+bool Regex::search(std::string_view text, size_t from, std::vector<size_t>& groups) const {
+    if (from > text.size()) return false;
+    return PikeVM(*program_, text).search(from, groups);
+}
+
+} // namespace androidscript
@@ -0,0 +1,623 @@
+#include "scheduler.h"
+#include "adb_client.h"
+#include "clock.h"
+#include <climits>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace androidscript {
+
+#ifndef _WIN32
+
+namespace {
+
+constexpr size_t kStackSize = 1024 * 1024;  // Committed lazily by the OS
+constexpr size_t kWheelSlots = 256;         // 1 ms per slot
+
+} // namespace
+
+struct Scheduler::Task {
+    std::function<void()> fn;
+    ucontext_t context;
+    void* stack = nullptr;
+    size_t stack_size = 0;
+    void* local = nullptr;
+    bool started = false;
+    bool finished = false;
+};
+
+namespace {
+
+// Hashed timer wheel with 1 ms ticks. A timer lives in slot
+// (deadline % kWheelSlots) and fires when the wheel reaches its deadline;
+// timers more than one revolution away simply stay put until then.
+class TimerWheel {
+public:
+    explicit TimerWheel(int64_t now) : current_(now), count_(0) {}
+
+    void add(int64_t deadline, Scheduler::Task* task) {
+        if (deadline <= current_) deadline = current_ + 1;
+        slots_[static_cast<size_t>(deadline) % kWheelSlots].push_back({deadline, task});
+        count_++;
+    }
+
+    // Move every timer due at or before now into ready
+    void expire(int64_t now, std::deque<Scheduler::Task*>& ready) {
+        if (now <= current_) return;
+
+        int64_t ticks = now - current_;
+        size_t steps = ticks >= static_cast<int64_t>(kWheelSlots)
+            ? kWheelSlots : static_cast<size_t>(ticks);
+
+        for (size_t i = 1; i <= steps && count_ > 0; ++i) {
+            auto& slot = slots_[static_cast<size_t>(current_ + i) % kWheelSlots];
+            for (size_t j = 0; j < slot.size();) {
+                if (slot[j].deadline <= now) {
+                    ready.push_back(slot[j].task);
+                    slot[j] = slot.back();
+                    slot.pop_back();
+                    count_--;
+                } else {
+                    ++j;
+                }
+            }
+        }
+        current_ = now;
+    }
+
+    // Earliest pending deadline, or INT64_MAX when empty
+    int64_t nextDeadline() const {
+        if (count_ == 0) return INT64_MAX;
+
+        // Within one revolution the first slot holding a timer due on that
+        // exact tick is the earliest
+        for (size_t i = 1; i <= kWheelSlots; ++i) {
+            int64_t tick = current_ + static_cast<int64_t>(i);
+            for (const auto& timer : slots_[static_cast<size_t>(tick) % kWheelSlots]) {
+                if (timer.deadline == tick) return tick;
+            }
+        }
+
+        // Everything is further out; fall back to a full scan
+        int64_t earliest = INT64_MAX;
+        for (const auto& slot : slots_) {
+            for (const auto& timer : slot) {
+                if (timer.deadline < earliest) earliest = timer.deadline;
+            }
+        }
+        return earliest;
+    }
+
+    bool empty() const { return count_ == 0; }
+
+private:
+    struct Timer {
+        int64_t deadline;
+        Scheduler::Task* task;
+    };
+
+    std::vector<Timer> slots_[kWheelSlots];
+    int64_t current_;   // Last tick processed
+    size_t count_;
+};
+
+} // namespace
+
+struct Scheduler::Worker {
+    Scheduler* owner;
+    std::thread thread;
+
+    // Tasks handed over from other threads
+    std::mutex inbox_mutex;
+    std::vector<Task*> inbox;
+    int wake_pipe[2];
+
+    // Owned by the worker thread
+    std::deque<Task*> ready;
+    TimerWheel timers;
+    std::vector<std::pair<int, Task*>> io_waiters;
+    ucontext_t loop_context;
+    Task* current;
+
+    explicit Worker(Scheduler* s) : owner(s), timers(Clock::monotonicMs()), current(nullptr) {
+        if (pipe(wake_pipe) != 0) {
+            throw std::runtime_error("Scheduler: cannot create wake pipe");
+        }
+        fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+    }
+
+    ~Worker() {
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+        for (Task* task : inbox) delete task;
+    }
+
+    void post(Task* task) {
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            inbox.push_back(task);
+        }
+        wake();
+    }
+
+    void wake() {
+        char byte = 1;
+        ssize_t ignored = write(wake_pipe[1], &byte, 1);
+        (void)ignored;  // Pipe full means a wake-up is already pending
+    }
+
+    void loop();
+    void resume(Task* task);
+    void park();
+    void pollOnce(int timeout_ms);
+};
+
+namespace {
+
+thread_local Scheduler::Worker* t_worker = nullptr;
+
+void taskEntry() {
+    Scheduler::Worker* worker = t_worker;
+    Scheduler::Task* task = worker->current;
+    try {
+        task->fn();
+    } catch (const std::exception& e) {
+        std::cerr << "[SCHEDULER] Task failed: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "[SCHEDULER] Task failed with unknown exception" << std::endl;
+    }
+    task->finished = true;
+    // Returning resumes uc_link, the worker loop
+}
+
+} // namespace
+
+void Scheduler::Worker::resume(Task* task) {
+    if (!task->started) {
+        task->started = true;
+
+        // Stack with a PROT_NONE guard page below it to catch overflow
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        task->stack_size = kStackSize + page;
+        task->stack = mmap(nullptr, task->stack_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (task->stack == MAP_FAILED) {
+            throw std::runtime_error("Scheduler: cannot allocate task stack");
+        }
+        mprotect(task->stack, page, PROT_NONE);
+
+        getcontext(&task->context);
+        task->context.uc_stack.ss_sp = task->stack;
+        task->context.uc_stack.ss_size = task->stack_size;
+        task->context.uc_link = &loop_context;
+        makecontext(&task->context, taskEntry, 0);
+    }
+
+    current = task;
+    swapcontext(&loop_context, &task->context);
+    current = nullptr;
+
+    if (task->finished) {
+        munmap(task->stack, task->stack_size);
+        delete task;
+        owner->taskFinished();
+    }
+}
+
+void Scheduler::Worker::park() {
+    Task* task = current;
+    swapcontext(&task->context, &loop_context);
+}
+
+void Scheduler::Worker::pollOnce(int timeout_ms) {
+    std::vector<pollfd> fds;
+    fds.reserve(io_waiters.size() + 1);
+    fds.push_back({wake_pipe[0], POLLIN, 0});
+    for (const auto& waiter : io_waiters) {
+        fds.push_back({waiter.first, POLLIN, 0});
+    }
+
+    int result = poll(fds.data(), fds.size(), timeout_ms);
+    if (result < 0 && errno != EINTR) {
+        throw std::runtime_error("Scheduler: poll failed");
+    }
+
+    if (fds[0].revents) {
+        char buffer[64];
+        while (read(wake_pipe[0], buffer, sizeof(buffer)) > 0) {}
+    }
+
+    // Readable, closed or errored pipes all resume the waiting task, which
+    // then sees the data/EOF/error from read()
+    size_t kept = 0;
+    for (size_t i = 0; i < io_waiters.size(); ++i) {
+        if (fds[i + 1].revents) {
+            ready.push_back(io_waiters[i].second);
+        } else {
+            io_waiters[kept++] = io_waiters[i];
+        }
+    }
+    io_waiters.resize(kept);
+}
+
+void Scheduler::Worker::loop() {
+    t_worker = this;
+    setIoWaitHook(&Scheduler::waitReadable);
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            ready.insert(ready.end(), inbox.begin(), inbox.end());
+            inbox.clear();
+        }
+
+        while (!ready.empty()) {
+            Task* task = ready.front();
+            ready.pop_front();
+            resume(task);
+        }
+
+        if (owner->stopping_.load() ||
+            (owner->exit_when_idle_.load() && owner->live_tasks_.load() == 0)) {
+            break;
+        }
+
+        // Sleep until a timer is due, a pipe becomes readable or another
+        // thread posts a task
+        int timeout = -1;
+        int64_t deadline = timers.nextDeadline();
+        if (deadline != INT64_MAX && Clock::isVirtual()) {
+            // Nothing is runnable. Unless a task waits on I/O or work was
+            // just handed over, jump to the next timer instead of sleeping.
+            bool inbox_empty;
+            {
+                std::lock_guard<std::mutex> lock(inbox_mutex);
+                inbox_empty = inbox.empty();
+            }
+            if (io_waiters.empty() && inbox_empty) {
+                Clock::advanceTo(deadline);
+                timeout = 0;
+            }
+        } else if (deadline != INT64_MAX) {
+            int64_t wait = deadline - Clock::monotonicMs();
+            timeout = wait < 0 ? 0 : static_cast<int>(wait);
+        }
+        pollOnce(timeout);
+        timers.expire(Clock::monotonicMs(), ready);
+    }
+
+    setIoWaitHook(nullptr);
+    t_worker = nullptr;
+}
+
+Scheduler::Scheduler(size_t workers)
+    : next_worker_(0), live_tasks_(0), running_(false),
+      exit_when_idle_(true), stopping_(false) {
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+        if (workers == 0) workers = 1;
+    }
+    if (Clock::isVirtual()) {
+        // One worker makes "every task is waiting" a local decision
+        workers = 1;
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>(this));
+    }
+}
+
+Scheduler::~Scheduler() {
+    // Background workers stop even if tasks are still parked; those are
+    // abandoned
+    stopping_ = true;
+    for (auto& worker : workers_) {
+        worker->wake();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+void Scheduler::spawn(std::function<void()> task) {
+    live_tasks_++;
+    Task* t = new Task();
+    t->fn = std::move(task);
+    workers_[next_worker_++ % workers_.size()]->post(t);
+}
+
+void Scheduler::startWorkers(bool exit_when_idle) {
+    exit_when_idle_ = exit_when_idle;
+    running_ = true;
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        w->thread = std::thread([w]() { w->loop(); });
+    }
+}
+
+void Scheduler::run() {
+    if (live_tasks_.load() == 0) return;
+
+    startWorkers(true);
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+    running_ = false;
+}
+
+void Scheduler::start() {
+    if (!running_.exchange(true)) {
+        startWorkers(false);
+    }
+}
+
+void Scheduler::taskFinished() {
+    if (--live_tasks_ == 0) {
+        { std::lock_guard<std::mutex> lock(idle_mutex_); }
+        idle_cv_.notify_all();
+
+        // Let idle workers notice that everything is done
+        for (auto& worker : workers_) {
+            worker->wake();
+        }
+    }
+}
+
+Scheduler* Scheduler::current() {
+    return t_worker ? t_worker->owner : nullptr;
+}
+
+bool Scheduler::inTask() {
+    return t_worker && t_worker->current;
+}
+
+void*& Scheduler::taskLocal() {
+    if (inTask()) {
+        return t_worker->current->local;
+    }
+    thread_local void* thread_local_value = nullptr;
+    return thread_local_value;
+}
+
+void Scheduler::sleepFor(std::chrono::milliseconds duration) {
+    if (!inTask()) {
+        if (Clock::isVirtual()) {
+            Clock::advanceTo(Clock::monotonicMs() + duration.count());
+        } else {
+            std::this_thread::sleep_for(duration);
+        }
+        return;
+    }
+    if (duration.count() <= 0) {
+        yield();
+        return;
+    }
+    t_worker->timers.add(Clock::monotonicMs() + duration.count(), t_worker->current);
+    t_worker->park();
+}
+
+void Scheduler::waitReadable(int fd) {
+    if (!inTask()) return;  // Caller's read() blocks instead
+    t_worker->io_waiters.push_back({fd, t_worker->current});
+    t_worker->park();
+}
+
+void Scheduler::yield() {
+    if (!inTask()) {
+        std::this_thread::yield();
+        return;
+    }
+    t_worker->ready.push_back(t_worker->current);
+    t_worker->park();
+}
+
+void WaitQueue::waitUntil(const std::function<bool()>& ready) {
+    if (ready()) return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_++;
+    // Pairs with the fence in notifyAll(): either the notifier sees the
+    // waiter count or we see its state change in ready()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (!ready()) {
+        if (Scheduler::inTask()) {
+            // Safe to unlock before parking: the task is pinned to this
+            // worker, which cannot resume it before park() returns control
+            parked_.push_back({t_worker, t_worker->current});
+            lock.unlock();
+            t_worker->park();
+            lock.lock();
+        } else {
+            cv_.wait(lock);
+        }
+    }
+    waiters_--;
+}
+
+void WaitQueue::notifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load() == 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& waiter : parked_) {
+        waiter.first->post(waiter.second);
+    }
+    parked_.clear();
+    cv_.notify_all();
+}
+
+#else // _WIN32
+
+// No ucontext on Windows: every task gets its own thread and the blocking
+// points block that thread.
+
+struct Scheduler::Task {
+    std::function<void()> fn;
+};
+
+struct Scheduler::Worker {
+    std::mutex mutex;
+    std::vector<Task*> pending;  // Spawned before the scheduler started
+};
+
+namespace {
+
+void launch(Scheduler::Task* task, const std::function<void()>& finished) {
+    std::thread([task, finished]() {
+        try {
+            task->fn();
+        } catch (const std::exception& e) {
+            std::cerr << "[SCHEDULER] Task failed: " << e.what() << std::endl;
+        }
+        delete task;
+        finished();
+    }).detach();
+}
+
+} // namespace
+
+Scheduler::Scheduler(size_t workers)
+    : next_worker_(0), live_tasks_(0), running_(false),
+      exit_when_idle_(true), stopping_(false) {
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+        if (workers == 0) workers = 1;
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+Scheduler::~Scheduler() {
+    // Task threads are detached, so they must be done before we go away
+    stopping_ = true;
+    waitIdle();
+}
+
+void Scheduler::spawn(std::function<void()> task) {
+    live_tasks_++;
+    Task* t = new Task{std::move(task)};
+    std::lock_guard<std::mutex> lock(workers_[0]->mutex);
+    if (running_) {
+        launch(t, [this]() { taskFinished(); });
+    } else {
+        workers_[0]->pending.push_back(t);
+    }
+}
+
+void Scheduler::startWorkers(bool exit_when_idle) {
+    exit_when_idle_ = exit_when_idle;
+    std::lock_guard<std::mutex> lock(workers_[0]->mutex);
+    running_ = true;
+    for (Task* t : workers_[0]->pending) {
+        launch(t, [this]() { taskFinished(); });
+    }
+    workers_[0]->pending.clear();
+}
+
+void Scheduler::run() {
+    startWorkers(true);
+    waitIdle();
+    running_ = false;
+}
+
+void Scheduler::start() {
+    if (!running_) startWorkers(false);
+}
+
+void Scheduler::taskFinished() {
+    if (--live_tasks_ == 0) {
+        { std::lock_guard<std::mutex> lock(idle_mutex_); }
+        idle_cv_.notify_all();
+    }
+}
+
+Scheduler* Scheduler::current() { return nullptr; }
+
+bool Scheduler::inTask() { return false; }
+
+void*& Scheduler::taskLocal() {
+    // Tasks are threads here
+    thread_local void* thread_local_value = nullptr;
+    return thread_local_value;
+}
+
+void Scheduler::sleepFor(std::chrono::milliseconds duration) {
+    if (Clock::isVirtual()) {
+        Clock::advanceTo(Clock::monotonicMs() + duration.count());
+    } else {
+        std::this_thread::sleep_for(duration);
+    }
+}
+
+void Scheduler::waitReadable(int) {}
+
+void Scheduler::yield() {
+    std::this_thread::yield();
+}
+
+void WaitQueue::waitUntil(const std::function<bool()>& ready) {
+    if (ready()) return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!ready()) {
+        cv_.wait(lock);
+    }
+    waiters_--;
+}
+
+void WaitQueue::notifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load() == 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+}
+
+#endif // _WIN32
+
+// Shared across platforms
+
+namespace {
+
+std::atomic<Scheduler*> g_shared_scheduler{nullptr};
+
+} // namespace
+
+void Scheduler::waitIdle() {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cv_.wait(lock, [this]() { return live_tasks_.load() == 0; });
+}
+
+Scheduler& Scheduler::shared() {
+    // Destroyed at exit, which stops its workers
+    static Scheduler instance;
+    static std::once_flag started;
+    std::call_once(started, []() {
+        instance.start();
+        g_shared_scheduler = &instance;
+    });
+    return instance;
+}
+
+void Scheduler::drainShared() {
+    if (Scheduler* scheduler = g_shared_scheduler.load()) {
+        scheduler->waitIdle();
+    }
+}
+
+} // namespace androidscript
@@ -0,0 +1,412 @@
+#include "string_kernels.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define ANDROIDSCRIPT_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+// AVX2 code is compiled per function and only called after a CPU check
+#define ANDROIDSCRIPT_HAVE_AVX2 1
+#define ANDROIDSCRIPT_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace androidscript {
+
+namespace {
+
+// Needle count up to which findAny keeps every needle in vector registers
+constexpr size_t kMaxVectorNeedles = 8;
+
+inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Scalar kernels, also used for the tails of the vector loops
+
+size_t findScalar(const char* s, size_t n, const char* needle, size_t k, size_t from) {
+    return std::string_view(s, n).find(std::string_view(needle, k), from);
+}
+
+size_t findAnyScalar(const char* s, size_t n, const std::string_view* needles, size_t count,
+                     size_t from, size_t* which) {
+    bool starts[256] = {};
+    for (size_t i = 0; i < count; ++i) {
+        starts[static_cast<unsigned char>(needles[i][0])] = true;
+    }
+
+    for (size_t pos = from; pos < n; ++pos) {
+        if (!starts[static_cast<unsigned char>(s[pos])]) continue;
+        for (size_t i = 0; i < count; ++i) {
+            size_t k = needles[i].size();
+            if (k <= n - pos && std::memcmp(s + pos, needles[i].data(), k) == 0) {
+                *which = i;
+                return pos;
+            }
+        }
+    }
+    return kNotFound;
+}
+
+inline bool isJsonSpecial(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+size_t findJsonSpecialScalar(const char* s, size_t n, size_t from) {
+    for (size_t i = from; i < n; ++i) {
+        if (isJsonSpecial(static_cast<unsigned char>(s[i]))) return i;
+    }
+    return kNotFound;
+}
+
+void mapCaseScalar(char* data, size_t size, char lo, char hi) {
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] >= lo && data[i] <= hi) data[i] ^= 0x20;
+    }
+}
+
+#ifdef ANDROIDSCRIPT_HAVE_SSE2
+
+// Substring search compares the needle's first and last bytes against a
+// whole block at once and only runs memcmp where both match
+size_t findSse2(const char* s, size_t n, const char* needle, size_t k, size_t from) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+
+    size_t i = from;
+    for (; i + k - 1 + 16 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + k - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+        while (mask) {
+            unsigned bit = countTrailingZeros(mask);
+            if (std::memcmp(s + i + bit + 1, needle + 1, k - 2) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(s, n, needle, k, i);
+}
+
+size_t findAnySse2(const char* s, size_t n, const std::string_view* needles, size_t count,
+                   size_t max_length, size_t* which) {
+    __m128i firsts[kMaxVectorNeedles];
+    __m128i lasts[kMaxVectorNeedles];
+    for (size_t i = 0; i < count; ++i) {
+        firsts[i] = _mm_set1_epi8(needles[i].front());
+        lasts[i] = _mm_set1_epi8(needles[i].back());
+    }
+
+    size_t p = 0;
+    for (; p + max_length - 1 + 16 <= n; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + p));
+        uint32_t mask = 0;
+        for (size_t i = 0; i < count; ++i) {
+            __m128i block_last = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(s + p + needles[i].size() - 1));
+            mask |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(firsts[i], block), _mm_cmpeq_epi8(lasts[i], block_last))));
+        }
+        while (mask) {
+            size_t pos = p + countTrailingZeros(mask);
+            for (size_t i = 0; i < count; ++i) {
+                if (std::memcmp(s + pos, needles[i].data(), needles[i].size()) == 0) {
+                    *which = i;
+                    return pos;
+                }
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findAnyScalar(s, n, needles, count, p, which);
+}
+
+// max_epu8(v, 0x1f) == 0x1f is an unsigned v <= 0x1f
+size_t findJsonSpecialSse2(const char* s, size_t n, size_t from) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    size_t i = from;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask) return i + countTrailingZeros(mask);
+    }
+    return findJsonSpecialScalar(s, n, i);
+}
+
+// Bytes are signed here, so everything >= 0x80 already fails the lower
+// bound and non-ASCII text is left alone
+void mapCaseSse2(char* data, size_t size, char lo, char hi) {
+    const __m128i below = _mm_set1_epi8(static_cast<char>(lo - 1));
+    const __m128i above = _mm_set1_epi8(static_cast<char>(hi + 1));
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(data + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        _mm_storeu_si128(p, _mm_xor_si128(v, _mm_and_si128(in_range, flip)));
+    }
+    mapCaseScalar(data + i, size - i, lo, hi);
+}
+
+#endif // ANDROIDSCRIPT_HAVE_SSE2
+
+#ifdef ANDROIDSCRIPT_HAVE_AVX2
+
+// Same algorithms as the SSE2 versions, 32 bytes at a time
+
+ANDROIDSCRIPT_AVX2_TARGET
+size_t findAvx2(const char* s, size_t n, const char* needle, size_t k, size_t from) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+
+    size_t i = from;
+    for (; i + k - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + k - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+        while (mask) {
+            unsigned bit = countTrailingZeros(mask);
+            if (std::memcmp(s + i + bit + 1, needle + 1, k - 2) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findSse2(s, n, needle, k, i);
+}
+
+ANDROIDSCRIPT_AVX2_TARGET
+size_t findAnyAvx2(const char* s, size_t n, const std::string_view* needles, size_t count,
+                   size_t max_length, size_t* which) {
+    __m256i firsts[kMaxVectorNeedles];
+    __m256i lasts[kMaxVectorNeedles];
+    for (size_t i = 0; i < count; ++i) {
+        firsts[i] = _mm256_set1_epi8(needles[i].front());
+        lasts[i] = _mm256_set1_epi8(needles[i].back());
+    }
+
+    size_t p = 0;
+    for (; p + max_length - 1 + 32 <= n; p += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + p));
+        uint32_t mask = 0;
+        for (size_t i = 0; i < count; ++i) {
+            __m256i block_last = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(s + p + needles[i].size() - 1));
+            mask |= static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_cmpeq_epi8(firsts[i], block), _mm256_cmpeq_epi8(lasts[i], block_last))));
+        }
+        while (mask) {
+            size_t pos = p + countTrailingZeros(mask);
+            for (size_t i = 0; i < count; ++i) {
+                if (std::memcmp(s + pos, needles[i].data(), needles[i].size()) == 0) {
+                    *which = i;
+                    return pos;
+                }
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findAnyScalar(s, n, needles, count, p, which);
+}
+
+ANDROIDSCRIPT_AVX2_TARGET
+size_t findJsonSpecialAvx2(const char* s, size_t n, size_t from) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+
+    size_t i = from;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (mask) return i + countTrailingZeros(mask);
+    }
+    return findJsonSpecialSse2(s, n, i);
+}
+
+ANDROIDSCRIPT_AVX2_TARGET
+void mapCaseAvx2(char* data, size_t size, char lo, char hi) {
+    const __m256i below = _mm256_set1_epi8(static_cast<char>(lo - 1));
+    const __m256i above = _mm256_set1_epi8(static_cast<char>(hi + 1));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i* p = reinterpret_cast<__m256i*>(data + i);
+        __m256i v = _mm256_loadu_si256(p);
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(v, below),
+                                            _mm256_cmpgt_epi8(above, v));
+        _mm256_storeu_si256(p, _mm256_xor_si256(v, _mm256_and_si256(in_range, flip)));
+    }
+    mapCaseSse2(data + i, size - i, lo, hi);
+}
+
+#endif // ANDROIDSCRIPT_HAVE_AVX2
+
+// Best kernels for this CPU, picked on first use
+struct Kernels {
+    size_t (*find)(const char*, size_t, const char*, size_t, size_t);
+    size_t (*findAny)(const char*, size_t, const std::string_view*, size_t, size_t, size_t*);
+    size_t (*findJsonSpecial)(const char*, size_t, size_t);
+    void (*mapCase)(char*, size_t, char, char);
+    const char* level;
+};
+
+#ifndef ANDROIDSCRIPT_HAVE_SSE2
+size_t findAnyNoVector(const char* s, size_t n, const std::string_view* needles, size_t count,
+                       size_t, size_t* which) {
+    return findAnyScalar(s, n, needles, count, 0, which);
+}
+#endif
+
+Kernels selectKernels() {
+#ifdef ANDROIDSCRIPT_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {findAvx2, findAnyAvx2, findJsonSpecialAvx2, mapCaseAvx2, "avx2"};
+    }
+#endif
+#ifdef ANDROIDSCRIPT_HAVE_SSE2
+    return {findSse2, findAnySse2, findJsonSpecialSse2, mapCaseSse2, "sse2"};
+#else
+    return {findScalar, findAnyNoVector, findJsonSpecialScalar, mapCaseScalar, "scalar"};
+#endif
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+} // namespace
+
+size_t findSubstring(std::string_view haystack, std::string_view needle, size_t from) {
+    if (from > haystack.size()) return kNotFound;
+    if (needle.empty()) return from;
+    if (needle.size() > haystack.size() - from) return kNotFound;
+
+    if (needle.size() == 1) {
+        // libc's memchr is already vectorized
+        const void* hit = std::memchr(haystack.data() + from, needle[0], haystack.size() - from);
+        return hit ? static_cast<size_t>(static_cast<const char*>(hit) - haystack.data())
+                   : kNotFound;
+    }
+    return kernels().find(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+}
+
+size_t findAny(std::string_view haystack, const std::vector<std::string_view>& needles,
+               size_t* which) {
+    size_t ignored;
+    if (!which) which = &ignored;
+
+    size_t max_length = 0;
+    bool has_empty = false;
+    for (const auto& needle : needles) {
+        if (needle.empty()) has_empty = true;
+        if (needle.size() > max_length) max_length = needle.size();
+    }
+
+    // An empty needle matches at 0, as may earlier needles
+    if (has_empty) {
+        for (size_t i = 0; i < needles.size(); ++i) {
+            if (haystack.substr(0, needles[i].size()) == needles[i]) {
+                *which = i;
+                return 0;
+            }
+        }
+    }
+    if (needles.empty()) return kNotFound;
+    if (needles.size() == 1) {
+        *which = 0;
+        return findSubstring(haystack, needles[0]);
+    }
+
+    if (needles.size() <= kMaxVectorNeedles) {
+        return kernels().findAny(haystack.data(), haystack.size(), needles.data(),
+                                 needles.size(), max_length, which);
+    }
+    return findAnyScalar(haystack.data(), haystack.size(), needles.data(), needles.size(), 0,
+                         which);
+}
+
+size_t replaceAll(std::string_view text, std::string_view from, std::string_view to,
+                  std::string& out) {
+    // One search pass to find the matches, then one copy into an output of
+    // exactly the right size
+    std::vector<size_t> matches;
+    for (size_t pos = findSubstring(text, from); pos != kNotFound;
+         pos = findSubstring(text, from, pos + from.size())) {
+        matches.push_back(pos);
+    }
+    if (matches.empty()) return 0;
+
+    out.resize(text.size() - matches.size() * from.size() + matches.size() * to.size());
+    char* dest = &out[0];
+    size_t copied = 0;
+    for (size_t pos : matches) {
+        std::memcpy(dest, text.data() + copied, pos - copied);
+        dest += pos - copied;
+        std::memcpy(dest, to.data(), to.size());
+        dest += to.size();
+        copied = pos + from.size();
+    }
+    std::memcpy(dest, text.data() + copied, text.size() - copied);
+    return matches.size();
+}
+
+size_t findJsonSpecial(std::string_view text, size_t from) {
+    if (from >= text.size()) return kNotFound;
+    return kernels().findJsonSpecial(text.data(), text.size(), from);
+}
+
+void asciiToUpper(char* data, size_t size) {
+    kernels().mapCase(data, size, 'a', 'z');
+}
+
+void asciiToLower(char* data, size_t size) {
+    kernels().mapCase(data, size, 'A', 'Z');
+}
+
+std::string joinStrings(const std::vector<std::string_view>& parts, std::string_view separator) {
+    if (parts.empty()) return std::string();
+
+    size_t total = separator.size() * (parts.size() - 1);
+    for (const auto& part : parts) total += part.size();
+
+    std::string out;
+    out.reserve(total);
+    out.append(parts[0]);
+    for (size_t i = 1; i < parts.size(); ++i) {
+        out.append(separator);
+        out.append(parts[i]);
+    }
+    return out;
+}
+
+const char* stringKernelLevel() {
+    return kernels().level;
+}
+
+} // namespace androidscript
@@ -0,0 +1,320 @@
+#include "tasks.h"
+#include "device_session.h"
+#include "environment.h"
+#include "hash_table.h"
+#include "interpreter.h"
+#include "thread_pool.h"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace androidscript {
+
+namespace {
+
+// Deep copier that preserves aliasing and cycles: every container and
+// environment is copied once and later references reuse the copy
+class Isolator {
+public:
+    Value copy(const Value& value) {
+        switch (value.type()) {
+            case ValueType::ARRAY: {
+                const void* key = &value.asArray();
+                auto it = copies_.find(key);
+                if (it != copies_.end()) return it->second;
+
+                Value result = Value::makeArray();
+                copies_[key] = result;
+                ValueArray& items = result.asArray();
+                items.reserve(value.asArray().size());
+                for (const auto& item : value.asArray()) {
+                    items.push_back(copy(item));
+                }
+                return result;
+            }
+            case ValueType::OBJECT: {
+                const void* key = &value.asObject();
+                auto it = copies_.find(key);
+                if (it != copies_.end()) return it->second;
+
+                Value result = Value::makeObject();
+                copies_[key] = result;
+                for (const auto& pair : value.asObject()) {
+                    result.set(pair.first, copy(pair.second));
+                }
+                return result;
+            }
+            case ValueType::MAP:
+            case ValueType::SET: {
+                const void* key = &value.asTable();
+                auto it = copies_.find(key);
+                if (it != copies_.end()) return it->second;
+
+                Value result = value.isMap() ? Value::makeMap() : Value::makeSet();
+                copies_[key] = result;
+                ValueHashTable& table = result.asTable();
+                table.reserve(value.asTable().size());
+                value.asTable().forEach([&](const Value& k, const Value& v) {
+                    table.put(copy(k), copy(v));
+                });
+                return result;
+            }
+            case ValueType::FUNCTION: {
+                const void* key = &value.asFunction();
+                auto it = copies_.find(key);
+                if (it != copies_.end()) return it->second;
+
+                FunctionObject isolated = value.asFunction();
+                isolated.closure = nullptr;
+                Value result = Value::makeFunction(isolated);
+                copies_[key] = result;
+                result.asFunction().closure = copyEnvironment(value.asFunction().closure);
+                return result;
+            }
+            default:
+                // Scalars are immutable; native functions and native objects
+                // are shared on purpose
+                return value;
+        }
+    }
+
+private:
+    std::map<const void*, Value> copies_;
+    std::map<const Environment*, std::shared_ptr<Environment>> environments_;
+
+    std::shared_ptr<Environment> copyEnvironment(const std::shared_ptr<Environment>& env) {
+        if (!env) return nullptr;
+        if (env->isFrozen()) return env;  // Read-only, so shared as is
+
+        auto it = environments_.find(env.get());
+        if (it != environments_.end()) return it->second;
+
+        auto parent = copyEnvironment(env->getParent());
+        auto result = parent ? std::make_shared<Environment>(parent)
+                             : std::make_shared<Environment>();
+        environments_[env.get()] = result;
+
+        for (const auto& pair : env->variables()) {
+            result->define(pair.first, copy(pair.second));
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+Value isolateValue(const Value& value) {
+    Isolator isolator;
+    return isolator.copy(value);
+}
+
+namespace {
+
+// Globals for an interpreter running an isolated function, so builtins
+// that register globals (LoadExtension) target the task's own scope
+std::shared_ptr<Environment> globalsFor(const Value& fn) {
+    if (!fn.isFunction() || !fn.asFunction().closure) {
+        return std::make_shared<Environment>();
+    }
+    auto env = fn.asFunction().closure;
+    while (!env->isGlobal()) {
+        env = env->getParent();
+    }
+    return env;
+}
+
+} // namespace
+
+// TaskHandle
+
+void TaskHandle::finish(const Value& result) {
+    result_ = result;
+    done_.store(true, std::memory_order_release);
+    waiters_.notifyAll();
+}
+
+void TaskHandle::fail(const std::string& error) {
+    failed_ = true;
+    error_ = error;
+    done_.store(true, std::memory_order_release);
+    waiters_.notifyAll();
+}
+
+Value TaskHandle::await() {
+    waiters_.waitUntil([this]() { return done_.load(std::memory_order_acquire); });
+    if (failed_) {
+        throw std::runtime_error("Task failed: " + error_);
+    }
+    return result_;
+}
+
+// Channel
+
+void Channel::send(const Value& value) {
+    Value isolated = isolateValue(value);
+    bool sent = false;
+
+    not_full_.waitUntil([&]() {
+        if (closed_.load()) return true;
+        size_t count = count_.load();
+        while (count < capacity_) {
+            if (count_.compare_exchange_weak(count, count + 1)) {
+                // The queue holds at least capacity_ values, so a reserved
+                // slot always has room
+                sent = queue_.tryPush(isolated);
+                return true;
+            }
+        }
+        return false;
+    });
+
+    if (!sent) {
+        throw std::runtime_error("Send() on a closed channel");
+    }
+    not_empty_.notifyAll();
+}
+
+Value Channel::receive() {
+    Value value;
+    bool received = false;
+
+    not_empty_.waitUntil([&]() {
+        received = queue_.tryPop(value);
+        // A value sent just before Close() may land after the first try
+        if (!received && closed_.load()) {
+            received = queue_.tryPop(value);
+        }
+        return received || closed_.load();
+    });
+
+    if (received) {
+        count_.fetch_sub(1);
+        not_full_.notifyAll();
+    }
+    return value;
+}
+
+void Channel::close() {
+    closed_.store(true);
+    not_empty_.notifyAll();
+    not_full_.notifyAll();
+}
+
+// Spawn
+
+Value spawnTask(const Value& fn, const std::vector<Value>& args) {
+    if (!fn.isCallable()) {
+        throw std::runtime_error("Spawn() requires a function");
+    }
+
+    // One isolator for the function and its arguments, so values they have
+    // in common stay shared inside the task
+    Isolator isolator;
+    Value task_fn = isolator.copy(fn);
+    std::vector<Value> task_args;
+    task_args.reserve(args.size());
+    for (const auto& arg : args) {
+        task_args.push_back(isolator.copy(arg));
+    }
+
+    auto handle = std::make_shared<TaskHandle>();
+
+    Scheduler* scheduler = Scheduler::current();
+    if (!scheduler) {
+        scheduler = &Scheduler::shared();
+    }
+
+    // The task drives the spawner's device until it selects its own
+    auto device = selectedDevice();
+
+    scheduler->spawn([handle, task_fn, task_args, device]() {
+        Interpreter interpreter(globalsFor(task_fn));
+        interpreter.setDevice(device);
+        try {
+            handle->finish(interpreter.callFunction(task_fn, task_args));
+        } catch (const std::exception& e) {
+            handle->fail(e.what());
+        }
+    });
+
+    return Value::makeNativeObject(handle);
+}
+
+// Data-parallel loops
+
+namespace {
+
+bool isMutable(const Value& value) {
+    switch (value.type()) {
+        case ValueType::ARRAY:
+        case ValueType::OBJECT:
+        case ValueType::MAP:
+        case ValueType::SET:
+        case ValueType::FUNCTION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Per pool thread: built lazily by the thread that owns the slot
+struct ParallelContext {
+    ParallelContext(const Value& callback, std::shared_ptr<DeviceSession> device)
+        : fn(isolateValue(callback)), interpreter(globalsFor(fn)) {
+        interpreter.setDevice(std::move(device));
+    }
+
+    Value fn;
+    Interpreter interpreter;
+};
+
+} // namespace
+
+Value parallelMap(const Value& array, const Value& fn, bool collect) {
+    if (!fn.isCallable()) {
+        throw std::runtime_error("Parallel callback must be a function");
+    }
+
+    // Snapshot the elements so the caller's array can't change under us
+    const ValueArray items = array.asArray();
+    WorkStealingPool& pool = WorkStealingPool::shared();
+    auto device = selectedDevice();
+
+    std::vector<std::unique_ptr<ParallelContext>> contexts(pool.threadCount());
+    ValueArray results(collect ? items.size() : 0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::string error;
+
+    pool.parallelFor(items.size(), [&](size_t slot, size_t begin, size_t end) {
+        if (failed.load(std::memory_order_relaxed)) return;
+
+        try {
+            auto& context = contexts[slot];
+            if (!context) {
+                context = std::make_unique<ParallelContext>(fn, device);
+            }
+
+            std::vector<Value> args(1);
+            for (size_t i = begin; i < end; ++i) {
+                args[0] = isMutable(items[i]) ? isolateValue(items[i]) : items[i];
+                Value result = context->interpreter.callFunction(context->fn, args);
+                if (collect) {
+                    results[i] = std::move(result);
+                }
+            }
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!failed.exchange(true)) {
+                error = e.what();
+            }
+        }
+    });
+
+    if (failed) {
+        throw std::runtime_error(error);
+    }
+    return collect ? Value::makeArray(results) : Value::makeNil();
+}
+
+} // namespace androidscript
@@ -0,0 +1,144 @@
+#include "thread_pool.h"
+
+namespace androidscript {
+
+namespace {
+
+// Pool and slot of the calling thread, if it is a pool worker
+thread_local WorkStealingPool* t_pool = nullptr;
+thread_local size_t t_slot = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : queued_(0), stopping_(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread([this, i]() { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+WorkStealingPool& WorkStealingPool::shared() {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+void WorkStealingPool::parallelFor(size_t count,
+                                   const std::function<void(size_t, size_t, size_t)>& body) {
+    if (count == 0) return;
+
+    // Nested loop on one of our own workers: blocking here could leave no
+    // thread to run the pieces, so run inline
+    if (t_pool == this) {
+        body(t_slot, 0, count);
+        return;
+    }
+
+    size_t threads = workers_.size();
+    Job job;
+    job.body = &body;
+    job.grain = count / (threads * 8);
+    if (job.grain == 0) job.grain = 1;
+    job.remaining = count;
+
+    // One slice per worker to start with; stealing evens out the rest
+    size_t slices = threads < count ? threads : count;
+    for (size_t i = 0; i < slices; ++i) {
+        push(i, {&job, count * i / slices, count * (i + 1) / slices});
+    }
+
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.done.wait(lock, [&job]() { return job.remaining.load() == 0; });
+}
+
+void WorkStealingPool::push(size_t slot, const Range& range) {
+    {
+        std::lock_guard<std::mutex> lock(workers_[slot]->mutex);
+        workers_[slot]->deque.push_back(range);
+    }
+    queued_++;
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_cv_.notify_one();
+}
+
+bool WorkStealingPool::popLocal(size_t slot, Range& range) {
+    std::lock_guard<std::mutex> lock(workers_[slot]->mutex);
+    auto& deque = workers_[slot]->deque;
+    if (deque.empty()) return false;
+    range = deque.back();
+    deque.pop_back();
+    queued_--;
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t slot, Range& range) {
+    size_t threads = workers_.size();
+    for (size_t i = 1; i < threads; ++i) {
+        Worker& victim = *workers_[(slot + i) % threads];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.deque.empty()) {
+            range = victim.deque.front();
+            victim.deque.pop_front();
+            queued_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(size_t slot, Range range) {
+    Job* job = range.job;
+
+    // Leave the upper halves where other workers can steal them
+    while (range.end - range.begin > job->grain) {
+        size_t mid = range.begin + (range.end - range.begin) / 2;
+        push(slot, {job, mid, range.end});
+        range.end = mid;
+    }
+
+    (*job->body)(slot, range.begin, range.end);
+
+    // Decrement under the lock: once the waiter sees zero it destroys the
+    // job, so we must be done touching it by then
+    size_t done = range.end - range.begin;
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (job->remaining.fetch_sub(done) == done) {
+        job->done.notify_all();
+    }
+}
+
+void WorkStealingPool::workerLoop(size_t slot) {
+    t_pool = this;
+    t_slot = slot;
+
+    while (true) {
+        Range range;
+        if (popLocal(slot, range) || steal(slot, range)) {
+            execute(slot, range);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+        if (stopping_) return;
+    }
+}
+
+} // namespace androidscript
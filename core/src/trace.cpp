@@ -0,0 +1,286 @@
+#include "trace.h"
+#include "adb_client.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace androidscript {
+
+namespace {
+
+struct Event {
+    int64_t begin;
+    int64_t end;
+    const void* row;       // Interpreter the span ran in, or null
+    const char* category;
+    char name[48];
+    char track[48];
+};
+
+constexpr size_t kRingSize = 4096;  // Events per thread; a power of two
+
+// Single producer (the owning thread), single consumer (the writer)
+struct Ring {
+    std::array<Event, kRingSize> events;
+    std::atomic<uint64_t> head{0};  // Next slot the owning thread fills
+    std::atomic<uint64_t> tail{0};  // Next slot the writer reads
+};
+
+struct TraceState {
+    std::atomic<int64_t> origin{0};  // steady_clock nanoseconds at start()
+    std::atomic<uint64_t> dropped{0};
+
+    // Rings are registered once per thread and kept after the thread exits
+    // so their last events are still written
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    // Writer thread (and start/stop while it is not running)
+    std::mutex control_mutex;
+    std::atomic<bool> running{false};
+    std::thread writer;
+    std::ofstream out;
+    uint64_t written = 0;
+    std::unordered_map<std::string, int> pids;  // Track -> viewer process
+    std::unordered_map<const void*, int> rows;  // Interpreter -> row number
+    std::set<std::pair<int, int>> named_rows;
+};
+
+TraceState& state() {
+    static TraceState s;
+    return s;
+}
+
+Ring& localRing() {
+    thread_local std::shared_ptr<Ring> ring = [] {
+        auto created = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(state().rings_mutex);
+        state().rings.push_back(created);
+        return created;
+    }();
+    return *ring;
+}
+
+// Copy text into a fixed field, cut at a UTF-8 character boundary
+template <size_t N>
+void copyField(char (&field)[N], std::string_view text) {
+    size_t n = std::min(text.size(), N - 1);
+    if (n < text.size()) {
+        while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) --n;
+    }
+    std::memcpy(field, text.data(), n);
+    field[n] = '\0';
+}
+
+int64_t sinceOrigin(std::chrono::steady_clock::time_point time) {
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        time.time_since_epoch()).count();
+    return ns - state().origin.load(std::memory_order_relaxed);
+}
+
+// adb commands: the whole process, and its start-up nested inside
+void onAdbCommand(const std::vector<std::string>& args,
+                  std::chrono::steady_clock::time_point started,
+                  std::chrono::steady_clock::time_point spawned,
+                  std::chrono::steady_clock::time_point finished) {
+    if (!Tracer::enabled()) return;
+
+    size_t first = 0;
+    std::string_view serial;
+    if (args.size() >= 2 && args[0] == "-s") {
+        serial = args[1];
+        first = 2;
+    }
+    std::string name = "adb";
+    for (size_t i = first; i < args.size() && name.size() < 48; ++i) {
+        name += " " + args[i];
+    }
+
+    int64_t begin = sinceOrigin(started);
+    Tracer::record("adb", name, serial, begin, sinceOrigin(finished));
+    Tracer::record("adb", "adb spawn", serial, begin, sinceOrigin(spawned));
+}
+
+// Output (writer thread)
+
+void writeMicros(std::ostream& out, int64_t ns) {
+    ns = std::max<int64_t>(ns, 0);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%" PRId64 ".%03" PRId64, ns / 1000, ns % 1000);
+    out << buffer;
+}
+
+void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+            out << escaped;
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+// Start of the next record in the JSON array
+std::ostream& next(TraceState& s) {
+    return s.out << (s.written++ ? ",\n{" : "\n{");
+}
+
+int processFor(TraceState& s, const char* track) {
+    auto it = s.pids.find(track);
+    if (it != s.pids.end()) {
+        return it->second;
+    }
+    int pid = static_cast<int>(s.pids.size()) + 1;
+    s.pids.emplace(track, pid);
+    next(s) << "\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":";
+    writeString(s.out, *track ? track : "host");
+    s.out << "}}";
+    return pid;
+}
+
+int rowFor(TraceState& s, int pid, const void* interpreter) {
+    int tid = 0;
+    if (interpreter) {
+        tid = s.rows.emplace(interpreter, static_cast<int>(s.rows.size()) + 1).first->second;
+    }
+    if (s.named_rows.emplace(pid, tid).second) {
+        next(s) << "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"args\":{\"name\":\"";
+        if (tid) {
+            s.out << "interpreter " << tid;
+        } else {
+            s.out << "no interpreter";
+        }
+        s.out << "\"}}";
+    }
+    return tid;
+}
+
+void writeEvent(TraceState& s, const Event& event) {
+    int pid = processFor(s, event.track);
+    int tid = rowFor(s, pid, event.row);
+
+    next(s) << "\"name\":";
+    writeString(s.out, event.name[0] ? event.name : "<anonymous>");
+    s.out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":";
+    writeMicros(s.out, event.begin);
+    s.out << ",\"dur\":";
+    writeMicros(s.out, event.end - event.begin);
+    s.out << ",\"pid\":" << pid << ",\"tid\":" << tid << "}";
+}
+
+void drain(TraceState& s) {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(s.rings_mutex);
+        rings = s.rings;
+    }
+    for (const auto& ring : rings) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            writeEvent(s, ring->events[tail & (kRingSize - 1)]);
+        }
+        ring->tail.store(head, std::memory_order_release);
+    }
+}
+
+} // namespace
+
+void Tracer::start(const std::string& path) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.control_mutex);
+    if (s.running) {
+        throw std::runtime_error("Tracing is already on");
+    }
+
+    s.out.open(path, std::ios::trunc);
+    if (!s.out) {
+        throw std::runtime_error("Cannot create trace file: " + path);
+    }
+    s.out << "[";
+    s.written = 0;
+    s.pids.clear();
+    s.rows.clear();
+    s.named_rows.clear();
+    s.dropped = 0;
+    s.origin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    s.running = true;
+    s.writer = std::thread([&s]() {
+        while (s.running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            drain(s);
+        }
+    });
+    setCommandTraceHook(&onAdbCommand);
+    enabled_ = true;
+}
+
+void Tracer::stop() {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.control_mutex);
+    if (!s.running) return;
+
+    enabled_ = false;
+    setCommandTraceHook(nullptr);
+    s.running = false;
+    s.writer.join();
+
+    drain(s);
+    s.out << "\n]\n";
+    s.out.close();
+}
+
+int64_t Tracer::now() {
+    return sinceOrigin(std::chrono::steady_clock::now());
+}
+
+void Tracer::record(const char* category, std::string_view name, std::string_view track,
+                    int64_t begin, int64_t end) {
+    Ring& ring = localRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= kRingSize) {
+        state().dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Event& event = ring.events[head & (kRingSize - 1)];
+    event.begin = begin;
+    event.end = end;
+    event.row = Interpreter::current();
+    event.category = category;
+    copyField(event.name, name);
+    copyField(event.track, track);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t Tracer::eventsWritten() {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.control_mutex);
+    return s.written;
+}
+
+uint64_t Tracer::eventsDropped() {
+    return state().dropped.load();
+}
+
+} // namespace androidscript
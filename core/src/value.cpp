@@ -1,7 +1,12 @@
 #include "value.h"
+#include "hash_table.h"
+#include "number_format.h"
 #include <sstream>
 #include <stdexcept>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
 
 namespace androidscript {
 
@@ -20,6 +25,10 @@ Value::Value(const std::string& s)
     : type_(ValueType::STRING), int_val(0),
       string_val(std::make_shared<std::string>(s)) {}
 
+Value::Value(std::string&& s)
+    : type_(ValueType::STRING), int_val(0),
+      string_val(std::make_shared<std::string>(std::move(s))) {}
+
 Value::Value(const char* s)
     : type_(ValueType::STRING), int_val(0),
       string_val(std::make_shared<std::string>(s)) {}
@@ -28,10 +37,18 @@ Value::Value(const ValueArray& arr)
     : type_(ValueType::ARRAY), int_val(0),
       array_val(std::make_shared<ValueArray>(arr)) {}
 
+Value::Value(ValueArray&& arr)
+    : type_(ValueType::ARRAY), int_val(0),
+      array_val(std::make_shared<ValueArray>(std::move(arr))) {}
+
 Value::Value(const ValueMap& obj)
     : type_(ValueType::OBJECT), int_val(0),
       object_val(std::make_shared<ValueMap>(obj)) {}
 
+Value::Value(ValueMap&& obj)
+    : type_(ValueType::OBJECT), int_val(0),
+      object_val(std::make_shared<ValueMap>(std::move(obj))) {}
+
 Value::Value(const DeviceRef& dev)
     : type_(ValueType::DEVICE), int_val(0),
       device_val(std::make_shared<DeviceRef>(dev)) {}
@@ -42,7 +59,7 @@ Value::Value(const FunctionObject& func)
 
 Value::Value(NativeFunction func)
     : type_(ValueType::NATIVE_FUNCTION), int_val(0),
-      native_function_val(std::make_shared<NativeFunction>(func)) {}
+      native_function_val(std::make_shared<NativeFunctionObject>(NativeFunctionObject{std::move(func), {}})) {}
 
 // Copy constructor
 Value::Value(const Value& other) : type_(ValueType::NIL), int_val(0) {
@@ -61,6 +78,9 @@ Value::Value(Value&& other) noexcept : type_(other.type_) {
         case ValueType::DEVICE: device_val = std::move(other.device_val); break;
         case ValueType::FUNCTION: function_val = std::move(other.function_val); break;
         case ValueType::NATIVE_FUNCTION: native_function_val = std::move(other.native_function_val); break;
+        case ValueType::MAP:
+        case ValueType::SET: table_val = std::move(other.table_val); break;
+        case ValueType::NATIVE_OBJECT: native_object_val = std::move(other.native_object_val); break;
         default: break;
     }
     other.type_ = ValueType::NIL;
@@ -91,6 +111,9 @@ Value& Value::operator=(Value&& other) noexcept {
             case ValueType::DEVICE: device_val = std::move(other.device_val); break;
             case ValueType::FUNCTION: function_val = std::move(other.function_val); break;
             case ValueType::NATIVE_FUNCTION: native_function_val = std::move(other.native_function_val); break;
+            case ValueType::MAP:
+            case ValueType::SET: table_val = std::move(other.table_val); break;
+            case ValueType::NATIVE_OBJECT: native_object_val = std::move(other.native_object_val); break;
             default: break;
         }
 
@@ -113,6 +136,8 @@ void Value::cleanup() {
     device_val.reset();
     function_val.reset();
     native_function_val.reset();
+    table_val.reset();
+    native_object_val.reset();
 }
 
 void Value::copyFrom(const Value& other) {
@@ -129,6 +154,9 @@ void Value::copyFrom(const Value& other) {
         case ValueType::DEVICE: device_val = other.device_val; break;
         case ValueType::FUNCTION: function_val = other.function_val; break;
         case ValueType::NATIVE_FUNCTION: native_function_val = other.native_function_val; break;
+        case ValueType::MAP:
+        case ValueType::SET: table_val = other.table_val; break;
+        case ValueType::NATIVE_OBJECT: native_object_val = other.native_object_val; break;
     }
 }
 
@@ -155,6 +183,11 @@ std::string Value::asString() const {
     return *string_val;
 }
 
+const std::string& Value::asStringRef() const {
+    if (!isString()) throw std::runtime_error("Value is not a string");
+    return *string_val;
+}
+
 ValueArray& Value::asArray() {
     if (!isArray()) throw std::runtime_error("Value is not an array");
     return *array_val;
@@ -197,12 +230,32 @@ const FunctionObject& Value::asFunction() const {
 
 NativeFunction& Value::asNativeFunction() {
     if (!isNativeFunction()) throw std::runtime_error("Value is not a native function");
-    return *native_function_val;
+    return native_function_val->function;
 }
 
 const NativeFunction& Value::asNativeFunction() const {
     if (!isNativeFunction()) throw std::runtime_error("Value is not a native function");
-    return *native_function_val;
+    return native_function_val->function;
+}
+
+const std::vector<std::string>& Value::nativeParameters() const {
+    if (!isNativeFunction()) throw std::runtime_error("Value is not a native function");
+    return native_function_val->parameters;
+}
+
+ValueHashTable& Value::asTable() {
+    if (!isMap() && !isSet()) throw std::runtime_error("Value is not a map or set");
+    return *table_val;
+}
+
+const ValueHashTable& Value::asTable() const {
+    if (!isMap() && !isSet()) throw std::runtime_error("Value is not a map or set");
+    return *table_val;
+}
+
+const std::shared_ptr<NativeObject>& Value::asNativeObject() const {
+    if (!isNativeObject()) throw std::runtime_error("Value is not a native object");
+    return native_object_val;
 }
 
 // Factory methods
@@ -212,16 +265,53 @@ Value Value::makeInt(int64_t i) { return Value(i); }
 Value Value::makeFloat(double d) { return Value(d); }
 Value Value::makeString(const std::string& s) { return Value(s); }
 Value Value::makeArray(const ValueArray& arr) { return Value(arr); }
+Value Value::makeArray(ValueArray&& arr) { return Value(std::move(arr)); }
 Value Value::makeObject(const ValueMap& obj) { return Value(obj); }
+Value Value::makeObject(ValueMap&& obj) { return Value(std::move(obj)); }
 Value Value::makeDevice(const DeviceRef& dev) { return Value(dev); }
 Value Value::makeFunction(const FunctionObject& func) { return Value(func); }
-Value Value::makeNativeFunction(NativeFunction func) { return Value(func); }
+Value Value::makeNativeFunction(NativeFunction func) { return Value(std::move(func)); }
+
+Value Value::makeNativeFunction(NativeFunction func, std::vector<std::string> parameters) {
+    Value value(std::move(func));
+    value.native_function_val->parameters = std::move(parameters);
+    return value;
+}
+
+Value Value::makeMap() {
+    Value v;
+    v.type_ = ValueType::MAP;
+    v.table_val = std::make_shared<ValueHashTable>();
+    return v;
+}
+
+Value Value::makeSet() {
+    Value v;
+    v.type_ = ValueType::SET;
+    v.table_val = std::make_shared<ValueHashTable>();
+    return v;
+}
+
+Value Value::makeNativeObject(std::shared_ptr<NativeObject> obj) {
+    Value v;
+    v.type_ = ValueType::NATIVE_OBJECT;
+    v.native_object_val = std::move(obj);
+    return v;
+}
 
 // Arithmetic operators
 Value Value::operator+(const Value& other) const {
     // String concatenation
     if (isString() || other.isString()) {
-        return Value(toString() + other.toString());
+        std::string result = toString();
+        if (other.isInt()) {
+            appendInt(result, other.int_val);
+        } else if (other.isFloat()) {
+            appendFloat(result, other.float_val);
+        } else {
+            result += other.toString();
+        }
+        return Value(std::move(result));
     }
 
     // Numeric addition
@@ -291,6 +381,9 @@ bool Value::operator==(const Value& other) const {
         case ValueType::ARRAY: return array_val == other.array_val;  // Pointer comparison
         case ValueType::OBJECT: return object_val == other.object_val;
         case ValueType::DEVICE: return device_val->serial == other.device_val->serial;
+        case ValueType::MAP:
+        case ValueType::SET: return table_val == other.table_val;
+        case ValueType::NATIVE_OBJECT: return native_object_val == other.native_object_val;
         default: return false;
     }
 }
@@ -365,20 +458,24 @@ const Value& Value::operator[](const std::string& key) const {
 
 // String representation
 std::string Value::toString() const {
-    std::ostringstream oss;
-
     switch (type_) {
         case ValueType::NIL:
             return "null";
         case ValueType::BOOLEAN:
             return bool_val ? "true" : "false";
         case ValueType::INTEGER:
-            return std::to_string(int_val);
+            return formatInt(int_val);
         case ValueType::FLOAT:
-            oss << float_val;
-            return oss.str();
+            // Shortest form that reads back as the same double
+            return formatFloat(float_val);
         case ValueType::STRING:
             return *string_val;
+        default:
+            break;
+    }
+
+    std::ostringstream oss;
+    switch (type_) {
         case ValueType::ARRAY:
             oss << "[";
             for (size_t i = 0; i < array_val->size(); ++i) {
@@ -398,12 +495,36 @@ std::string Value::toString() const {
             oss << "}";
             return oss.str();
         }
+        case ValueType::MAP: {
+            oss << "Map{";
+            bool first = true;
+            table_val->forEach([&](const Value& key, const Value& val) {
+                if (!first) oss << ", ";
+                oss << key.toString() << ": " << val.toString();
+                first = false;
+            });
+            oss << "}";
+            return oss.str();
+        }
+        case ValueType::SET: {
+            oss << "Set{";
+            bool first = true;
+            table_val->forEach([&](const Value& key, const Value&) {
+                if (!first) oss << ", ";
+                oss << key.toString();
+                first = false;
+            });
+            oss << "}";
+            return oss.str();
+        }
         case ValueType::DEVICE:
             return "Device(" + device_val->serial + ")";
         case ValueType::FUNCTION:
             return "<function>";
         case ValueType::NATIVE_FUNCTION:
             return "<native function>";
+        case ValueType::NATIVE_OBJECT:
+            return native_object_val->toString();
         default:
             return "<unknown>";
     }
@@ -421,6 +542,9 @@ std::string Value::typeString() const {
         case ValueType::DEVICE: return "device";
         case ValueType::FUNCTION: return "function";
         case ValueType::NATIVE_FUNCTION: return "native_function";
+        case ValueType::MAP: return "map";
+        case ValueType::SET: return "set";
+        case ValueType::NATIVE_OBJECT: return native_object_val->typeName();
         default: return "unknown";
     }
 }
@@ -435,10 +559,82 @@ bool Value::isTruthy() const {
         case ValueType::STRING: return !string_val->empty();
         case ValueType::ARRAY: return !array_val->empty();
         case ValueType::OBJECT: return !object_val->empty();
+        case ValueType::MAP:
+        case ValueType::SET: return !table_val->empty();
         default: return true;
     }
 }
 
+// Hashing
+
+namespace {
+
+// splitmix64 finalizer - spreads low-entropy keys (small ints) across the
+// table so linear probing does not cluster
+inline uint64_t mixHash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline uint64_t pointerHash(const void* ptr) {
+    return mixHash(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)));
+}
+
+} // namespace
+
+uint64_t Value::hash() const {
+    uint64_t seed = static_cast<uint64_t>(type_) * 0x9e3779b97f4a7c15ULL;
+
+    switch (type_) {
+        case ValueType::NIL:
+            return mixHash(seed);
+        case ValueType::BOOLEAN:
+            return mixHash(seed ^ (bool_val ? 1 : 0));
+        case ValueType::INTEGER:
+            return mixHash(seed ^ static_cast<uint64_t>(int_val));
+        case ValueType::FLOAT: {
+            double d = float_val;
+            if (d == 0.0) d = 0.0;                                      // -0.0 == 0.0
+            if (d != d) d = std::numeric_limits<double>::quiet_NaN();    // one NaN key
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            return mixHash(seed ^ bits);
+        }
+        case ValueType::STRING:
+            return mixHash(seed ^ std::hash<std::string>()(*string_val));
+        case ValueType::DEVICE:
+            return mixHash(seed ^ std::hash<std::string>()(device_val->serial));
+        case ValueType::ARRAY: return pointerHash(array_val.get());
+        case ValueType::OBJECT: return pointerHash(object_val.get());
+        case ValueType::FUNCTION: return pointerHash(function_val.get());
+        case ValueType::NATIVE_FUNCTION: return pointerHash(native_function_val.get());
+        case ValueType::MAP:
+        case ValueType::SET: return pointerHash(table_val.get());
+        case ValueType::NATIVE_OBJECT: return pointerHash(native_object_val.get());
+    }
+    return seed;
+}
+
+bool Value::identityEquals(const Value& other) const {
+    if (type_ != other.type_) return false;
+
+    switch (type_) {
+        case ValueType::ARRAY: return array_val == other.array_val;
+        case ValueType::OBJECT: return object_val == other.object_val;
+        case ValueType::FUNCTION: return function_val == other.function_val;
+        case ValueType::NATIVE_FUNCTION: return native_function_val == other.native_function_val;
+        case ValueType::DEVICE: return device_val->serial == other.device_val->serial;
+        case ValueType::MAP:
+        case ValueType::SET: return table_val == other.table_val;
+        case ValueType::NATIVE_OBJECT: return native_object_val == other.native_object_val;
+        default: return *this == other;
+    }
+}
+
 // Array operations
 void Value::push(const Value& val) {
     if (!isArray()) throw std::runtime_error("Value is not an array");
@@ -457,6 +653,7 @@ size_t Value::length() const {
     if (isArray()) return array_val->size();
     if (isString()) return string_val->length();
     if (isObject()) return object_val->size();
+    if (isMap() || isSet()) return table_val->size();
     throw std::runtime_error("Value does not have a length");
 }
 
@@ -493,4 +690,30 @@ std::ostream& operator<<(std::ostream& os, const Value& val) {
     return os;
 }
 
+bool NativeObject::next(Value&) {
+    return false;
+}
+
+ForEachCursor::ForEachCursor(const Value& iterable)
+    : iterable_(iterable), items_(nullptr), index_(0), native_(nullptr) {
+    if (iterable_.isArray()) {
+        items_ = &iterable_.asArray();
+    } else if (iterable_.isMap() || iterable_.isSet()) {
+        // Snapshot so the body may modify the collection
+        keys_ = iterable_.asTable().keys();
+        items_ = &keys_;
+    } else if (iterable_.isNativeObject() && iterable_.asNativeObject()->isIterable()) {
+        native_ = iterable_.asNativeObject().get();
+    } else {
+        throw std::runtime_error("ForEach requires an array, map, set or iterable object");
+    }
+}
+
+bool ForEachCursor::next(Value& item) {
+    if (native_) return native_->next(item);
+    if (index_ >= items_->size()) return false;
+    item = (*items_)[index_++];
+    return true;
+}
+
 } // namespace androidscript
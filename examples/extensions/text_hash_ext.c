@@ -0,0 +1,66 @@
+// Example AndroidScript native extension
+//
+// Build: part of the CMake build when BUILD_EXAMPLES=ON
+// Use:   LoadExtension("build/lib/libtext_hash_ext.so")
+//        Print(Fnv1a("com.example.app"))
+//        Print(CountChar(ReadFile("logcat.txt"), "\n"))
+
+#include "extension_api.h"
+
+static const as_host_api* host;
+
+// Fnv1a(str) - 64-bit FNV-1a hash of a string, as an integer
+static void fnv1a(as_call* call, void* userdata) {
+    (void)userdata;
+    size_t length = 0;
+    const char* data = host->arg_string(call, 0, &length);
+    if (!data) {
+        host->raise_error(call, "Fnv1a() requires 1 string argument");
+        return;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    host->return_int(call, (int64_t)hash);
+}
+
+// CountChar(str, ch) - number of occurrences of a single character
+static void countChar(as_call* call, void* userdata) {
+    (void)userdata;
+    size_t length = 0;
+    size_t needle_length = 0;
+    const char* data = host->arg_string(call, 0, &length);
+    const char* needle = host->arg_string(call, 1, &needle_length);
+    if (!data || !needle || needle_length != 1) {
+        host->raise_error(call, "CountChar() requires a string and a single character");
+        return;
+    }
+
+    int64_t count = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] == needle[0]) count++;
+    }
+    host->return_int(call, count);
+}
+
+// Identity(x) - returns its integer argument; used to measure call overhead
+static void identity(as_call* call, void* userdata) {
+    (void)userdata;
+    host->return_int(call, host->arg_int(call, 0));
+}
+
+ANDROIDSCRIPT_EXTENSION_EXPORT
+int androidscript_extension_init(const as_host_api* api, as_registry* registry) {
+    if (api->abi_version < ANDROIDSCRIPT_EXTENSION_ABI_VERSION) {
+        return 1;
+    }
+    host = api;
+
+    host->register_function(registry, "Fnv1a", fnv1a, NULL);
+    host->register_function(registry, "CountChar", countChar, NULL);
+    host->register_function(registry, "Identity", identity, NULL);
+    return 0;
+}
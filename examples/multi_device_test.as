@@ -25,11 +25,12 @@ function RunTest($device) {
 }
 
 // Run test on all devices in parallel
+$tasks = []
 ForEach($device in $devices) {
-    RunTest($device)
+    Push($tasks, Spawn(RunTest, $device))
 }
 
 // Wait for all devices to complete
-SyncDevices($devices)
+AwaitAll($tasks)
 
 Print("All device tests completed!")
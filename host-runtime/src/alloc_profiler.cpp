@@ -0,0 +1,245 @@
+// Allocation profiler, linked only into androidscript-allocprof
+//
+// Replaces the global operator new and delete with counting versions. Each
+// allocation is charged to the AST node type the running interpreter is
+// evaluating and the builtin it is calling (Interpreter::currentNode and
+// currentBuiltin), and a ranked report is printed to stderr at exit.
+// Counts are heap traffic: allocations made, not memory still in use.
+
+#include "interpreter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+using namespace androidscript;
+
+namespace {
+
+// One (node type, builtin) pair. Builtins are keyed by the call site's
+// name string and the name is copied, since the AST is gone by the report.
+struct Site {
+    bool used;
+    const std::type_info* node;  // &typeid(void): outside any interpreter
+    const std::string* builtin_key;
+    char builtin[32];
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// Static and fixed-size so that recording never allocates
+constexpr size_t kSites = 4096;
+Site g_sites[kSites];
+uint64_t g_lost_count = 0;  // Allocations made after the table filled up
+uint64_t g_lost_bytes = 0;
+std::atomic_flag g_lock = ATOMIC_FLAG_INIT;
+std::atomic<bool> g_recording{false};
+std::atomic<uint64_t> g_frees{0};
+
+bool sameBuiltin(const Site& site, const std::string* builtin) {
+    if (site.builtin_key != builtin) return false;
+    return !builtin || std::strncmp(site.builtin, builtin->c_str(), sizeof(site.builtin) - 1) == 0;
+}
+
+void record(size_t size) {
+    if (!g_recording.load(std::memory_order_relaxed)) return;
+
+    // Allocations made while looking up the interpreter are not counted
+    thread_local bool inside = false;
+    if (inside) return;
+    inside = true;
+
+    Interpreter* interpreter = Interpreter::current();
+    const std::type_info* node = interpreter ? interpreter->currentNode() : &typeid(void);
+    const std::string* builtin = interpreter ? interpreter->currentBuiltin() : nullptr;
+
+    size_t hash = (reinterpret_cast<uintptr_t>(node) >> 4) * 31 +
+                  (reinterpret_cast<uintptr_t>(builtin) >> 3);
+    while (g_lock.test_and_set(std::memory_order_acquire)) {
+    }
+    Site* found = nullptr;
+    for (size_t probe = 0; probe < kSites; ++probe) {
+        Site& site = g_sites[(hash + probe) % kSites];
+        if (!site.used) {
+            site.used = true;
+            site.node = node;
+            site.builtin_key = builtin;
+            if (builtin) {
+                std::strncpy(site.builtin, builtin->c_str(), sizeof(site.builtin) - 1);
+            }
+            found = &site;
+            break;
+        }
+        if (site.node == node && sameBuiltin(site, builtin)) {
+            found = &site;
+            break;
+        }
+    }
+    if (found) {
+        found->count++;
+        found->bytes += size;
+    } else {
+        g_lost_count++;
+        g_lost_bytes += size;
+    }
+    g_lock.clear(std::memory_order_release);
+
+    inside = false;
+}
+
+void* allocate(size_t size) {
+    record(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void release(void* p) {
+    if (!p) return;
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+// Report
+
+std::string nodeName(const std::type_info* node) {
+    if (!node) return "(between nodes)";
+    if (*node == typeid(void)) return "(outside the interpreter)";
+
+    std::string name = node->name();
+#if defined(__GNUG__)
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status == 0 && demangled) {
+        name = demangled;
+    }
+    std::free(demangled);
+#endif
+    const std::string prefix = "androidscript::";
+    if (name.rfind(prefix, 0) == 0) {
+        name.erase(0, prefix.size());
+    }
+    return name;
+}
+
+struct Total {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+void printTable(const char* title, const std::map<std::string, Total>& totals,
+                const Total& all, size_t limit) {
+    std::vector<std::pair<std::string, Total>> rows(totals.begin(), totals.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.second.count != b.second.count ? a.second.count > b.second.count
+                                                : a.first < b.first;
+    });
+
+    std::fprintf(stderr, "\n%s\n%14s %8s %14s %8s  %s\n", title,
+                 "allocations", "%", "bytes", "%", "where");
+    for (size_t i = 0; i < rows.size() && i < limit; ++i) {
+        const Total& t = rows[i].second;
+        std::fprintf(stderr, "%14llu %7.1f%% %14llu %7.1f%%  %s\n",
+                     static_cast<unsigned long long>(t.count),
+                     all.count ? 100.0 * static_cast<double>(t.count) / static_cast<double>(all.count) : 0.0,
+                     static_cast<unsigned long long>(t.bytes),
+                     all.bytes ? 100.0 * static_cast<double>(t.bytes) / static_cast<double>(all.bytes) : 0.0,
+                     rows[i].first.c_str());
+    }
+    if (rows.size() > limit) {
+        std::fprintf(stderr, "%14s (%zu more)\n", "", rows.size() - limit);
+    }
+}
+
+void report() {
+    std::map<std::string, Total> by_node;
+    std::map<std::string, Total> by_builtin;
+    std::map<std::string, Total> by_both;
+    Total all;
+    for (const Site& site : g_sites) {
+        if (!site.used) continue;
+        std::string node = nodeName(site.node);
+        std::string builtin = site.builtin_key ? site.builtin : "(no builtin)";
+        for (Total* t : {&by_node[node], &by_builtin[builtin], &by_both[node + " / " + builtin], &all}) {
+            t->count += site.count;
+            t->bytes += site.bytes;
+        }
+    }
+
+    std::fprintf(stderr, "\n[ALLOC] %llu allocations, %llu bytes, %llu frees\n",
+                 static_cast<unsigned long long>(all.count),
+                 static_cast<unsigned long long>(all.bytes),
+                 static_cast<unsigned long long>(g_frees.load()));
+    if (g_lost_count) {
+        std::fprintf(stderr, "[ALLOC] %llu allocations (%llu bytes) not attributed: site table full\n",
+                     static_cast<unsigned long long>(g_lost_count),
+                     static_cast<unsigned long long>(g_lost_bytes));
+    }
+    printTable("By AST node type (innermost node being evaluated):", by_node, all, 25);
+    printTable("By builtin being called:", by_builtin, all, 25);
+    printTable("By node type and builtin:", by_both, all, 25);
+}
+
+// Turns tracking on before main() and reports after it returns
+struct Profiler {
+    Profiler() {
+        Interpreter::setAllocationTracking(true);
+        g_recording = true;
+    }
+    ~Profiler() {
+        g_recording = false;
+        report();
+    }
+} g_profiler;
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    release(p);
+}
+
+void operator delete[](void* p) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    release(p);
+}
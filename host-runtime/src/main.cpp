@@ -4,7 +4,18 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "interpreter_pool.h"
 #include "builtins.h"
+#include "cpp_emitter.h"
+#include "scheduler.h"
+#include "clock.h"
+#include "checkpoint.h"
+#include "coverage.h"
+#include "debugger.h"
+#include "profiler.h"
+#include "trace.h"
+#include <chrono>
+#include <iomanip>
 
 using namespace androidscript;
 
@@ -12,42 +23,50 @@ void printUsage(const char* program) {
     std::cout << "AndroidScript - Android Automation Framework\n\n";
     std::cout << "Usage:\n";
     std::cout << "  " << program << " <script.as>                 Run a script\n";
+    std::cout << "  " << program << " [--workers N] <a.as> <b.as> ...\n";
+    std::cout << "                                       Run several scripts concurrently\n";
+    std::cout << "  " << program << " --virtual-time <script.as> ...\n";
+    std::cout << "                                       Fast-forward Sleep() on a simulated clock\n";
+    std::cout << "  " << program << " --checkpoint <ckpt.bin> <script.as>\n";
+    std::cout << "                                       Run, saving progress at every loop iteration\n";
+    std::cout << "  " << program << " --resume <ckpt.bin>         Continue a checkpointed run\n";
+    std::cout << "  " << program << " --coverage <report.txt> <script.as>\n";
+    std::cout << "                                       Run, writing per-line execution counts\n";
+    std::cout << "  " << program << " --debug <script.as>         Run under the line debugger\n";
+    std::cout << "  " << program << " --profile=<out.folded> <script.as>\n";
+    std::cout << "                                       Sample the call stack for flamegraph.pl\n";
+    std::cout << "  " << program << " --trace=<run.json> <args...>\n";
+    std::cout << "                                       Record a timeline for chrome://tracing\n";
+    std::cout << "  " << program << " --emit-cpp <script.as> [-o out.cpp]\n";
+    std::cout << "                                       Compile a script to C++\n";
     std::cout << "  " << program << " --version                   Show version\n";
     std::cout << "  " << program << " --help                      Show this help\n";
     std::cout << "\nExamples:\n";
     std::cout << "  " << program << " examples/simple_login.as\n";
     std::cout << "  " << program << " my_script.as\n";
+    std::cout << "  " << program << " --workers 2 device1.as device2.as device3.as\n";
+    std::cout << "  " << program << " --virtual-time examples/stress_test.as\n";
+    std::cout << "  " << program << " --checkpoint stress.ckpt examples/stress_test.as\n";
+    std::cout << "  " << program << " --emit-cpp suite.as -o suite.cpp\n";
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        printUsage(argv[0]);
-        return 1;
-    }
-
-    std::string arg = argv[1];
-
-    if (arg == "--help" || arg == "-h") {
-        printUsage(argv[0]);
-        return 0;
-    }
-
-    if (arg == "--version" || arg == "-v") {
-        std::cout << "AndroidScript v1.0.0-alpha\n";
-        return 0;
-    }
-
-    // Read script file
-    std::string filename = argv[1];
+// Read, tokenize and parse a script. Prints diagnostics and returns false
+// on failure.
+static bool loadScript(const std::string& filename,
+                       std::vector<std::unique_ptr<Statement>>& ast,
+                       std::string* text = nullptr) {
     std::ifstream file(filename);
     if (!file) {
         std::cerr << "Error: Cannot open file: " << filename << std::endl;
-        return 1;
+        return false;
     }
 
     std::ostringstream buffer;
     buffer << file.rdbuf();
     std::string source = buffer.str();
+    if (text) {
+        *text = source;
+    }
 
     // Lexer
     Lexer lexer(source);
@@ -58,34 +77,348 @@ int main(int argc, char* argv[]) {
         for (const auto& error : lexer.getErrors()) {
             std::cerr << "  " << error << "\n";
         }
-        return 1;
+        return false;
     }
 
     // Parser
     Parser parser(tokens);
-    auto ast = parser.parse();
+    ast = parser.parse();
 
     if (parser.hasErrors()) {
         std::cerr << "Parser errors:\n";
         for (const auto& error : parser.getErrors()) {
             std::cerr << "  " << error << "\n";
         }
+        return false;
+    }
+
+    return true;
+}
+
+// Ahead-of-time compile a script to a C++ translation unit
+static int emitCpp(int argc, char* argv[]) {
+    std::string input;
+    std::string output;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string opt = argv[i];
+        if (opt == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (input.empty()) {
+            input = opt;
+        } else {
+            std::cerr << "Error: Unexpected argument: " << opt << std::endl;
+            return 1;
+        }
+    }
+
+    if (input.empty()) {
+        std::cerr << "Error: --emit-cpp requires a script" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Statement>> ast;
+    if (!loadScript(input, ast)) {
+        return 1;
+    }
+
+    CppEmitter emitter;
+    std::string code = emitter.emit(ast, input);
+
+    if (emitter.hasErrors()) {
+        std::cerr << "Emitter errors:\n";
+        for (const auto& error : emitter.getErrors()) {
+            std::cerr << "  " << error << "\n";
+        }
+        return 1;
+    }
+
+    if (output.empty()) {
+        std::cout << code;
+        return 0;
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        std::cerr << "Error: Cannot write to file: " << output << std::endl;
+        return 1;
+    }
+    out << code;
+    return 0;
+}
+
+// Run one script with a checkpoint file: --checkpoint starts a fresh one,
+// --resume continues from the last safe point recorded in it
+static int runCheckpointed(int argc, char* argv[]) {
+    std::string mode = argv[1];
+    if (argc != (mode == "--resume" ? 3 : 4)) {
+        std::cerr << "Error: Usage: " << mode
+                  << (mode == "--resume" ? " <ckpt.bin>" : " <ckpt.bin> <script.as>") << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Checkpointer> checkpointer;
+    std::string filename;
+    std::vector<std::unique_ptr<Statement>> ast;
+    try {
+        if (mode == "--resume") {
+            checkpointer = Checkpointer::open(argv[2]);
+            filename = checkpointer->scriptPath();
+        } else {
+            filename = argv[3];
+        }
+        if (!loadScript(filename, ast)) {
+            return 1;
+        }
+        if (!checkpointer) {
+            checkpointer = Checkpointer::create(argv[2], filename);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
 
-    // Interpreter
-    Interpreter interpreter;
+    auto interpreter = InterpreterPool::create();
 
-    // Register built-in functions
-    registerBuiltins(interpreter);
+    try {
+        interpreter->setScriptPath(filename);
+        interpreter->setCheckpointer(checkpointer.get());
+        interpreter->execute(ast);
+        Scheduler::drainShared();
+
+        if (interpreter->hasErrors()) {
+            std::cerr << "Runtime errors:\n";
+            for (const auto& error : interpreter->getErrors()) {
+                std::cerr << "  " << error << "\n";
+            }
+            std::cerr << "Progress saved; continue with --resume " << argv[2] << "\n";
+            return 1;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// Run one script under a line coverage collector (--coverage), the
+// interactive debugger (--debug) or the sampling profiler (--profile=)
+static int runInstrumented(int argc, char* argv[]) {
+    std::string mode = argv[1];
+    bool coverage = mode == "--coverage";
+    bool profile = mode.rfind("--profile=", 0) == 0;
+    if (argc != (coverage ? 4 : 3) || mode == "--profile=") {
+        std::cerr << "Error: Usage: " << (profile ? "--profile=<out.folded>" : mode)
+                  << (coverage ? " <report.txt> <script.as>" : " <script.as>") << std::endl;
+        return 1;
+    }
+
+    std::string filename = argv[coverage ? 3 : 2];
+    std::string source;
+    std::vector<std::unique_ptr<Statement>> ast;
+    if (!loadScript(filename, ast, &source)) {
+        return 1;
+    }
+
+    std::unique_ptr<ExecutionHooks> hooks;
+    SamplingProfiler* profiler = nullptr;
+    if (coverage) {
+        hooks = std::make_unique<LineCoverage>(ast);
+    } else if (profile) {
+        std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+        hooks = std::make_unique<SamplingProfiler>(name);
+        profiler = static_cast<SamplingProfiler*>(hooks.get());
+    } else {
+        hooks = std::make_unique<Debugger>(ast, source, std::cin, std::cerr);
+    }
+
+    auto interpreter = InterpreterPool::create();
+    interpreter->setScriptPath(filename);
+    interpreter->setHooks(hooks.get());
+
+    try {
+        if (profiler) profiler->start();
+        interpreter->execute(ast);
+        if (profiler) profiler->stop();
+        Scheduler::drainShared();
+    } catch (const Debugger::Quit&) {
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (profiler) {
+        std::string path = mode.substr(std::string("--profile=").size());
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Error: Cannot write to file: " << path << std::endl;
+            return 1;
+        }
+        profiler->writeFolded(out);
+        std::cerr << "[PROFILE] " << profiler->samples() << " samples written to " << path << "\n";
+    }
+
+    if (coverage) {
+        auto& lines = static_cast<LineCoverage&>(*hooks);
+        std::ofstream report(argv[2]);
+        if (!report) {
+            std::cerr << "Error: Cannot write to file: " << argv[2] << std::endl;
+            return 1;
+        }
+        lines.writeReport(report, source);
+        std::cerr << "[COVERAGE] " << lines.linesHit() << " of " << lines.linesFound()
+                  << " lines executed; report written to " << argv[2] << "\n";
+    }
+
+    if (interpreter->hasErrors()) {
+        std::cerr << "Runtime errors:\n";
+        for (const auto& error : interpreter->getErrors()) {
+            std::cerr << "  " << error << "\n";
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Run several scripts as cooperative tasks on a small worker pool. Each
+// script gets its own interpreter; Sleep() and adb I/O park the task rather
+// than the thread.
+static int runScripts(int argc, char* argv[]) {
+    size_t workers = 0;
+    bool virtual_time = false;
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string opt = argv[i];
+        if (opt == "--virtual-time") {
+            virtual_time = true;
+        } else if (opt == "--workers" && i + 1 < argc) {
+            try {
+                workers = static_cast<size_t>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Invalid worker count: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else {
+            filenames.push_back(opt);
+        }
+    }
+
+    if (filenames.empty()) {
+        std::cerr << "Error: No scripts given" << std::endl;
+        return 1;
+    }
+
+    // Parse everything up front so syntax errors are reported before any
+    // script starts talking to a device
+    std::vector<std::vector<std::unique_ptr<Statement>>> programs(filenames.size());
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (!loadScript(filenames[i], programs[i])) {
+            return 1;
+        }
+    }
+
+    // Must happen before the scheduler exists: it creates its timers from
+    // the clock
+    if (virtual_time) {
+        Clock::enableVirtual();
+    }
+    auto real_start = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<std::string>> errors(filenames.size());
+    InterpreterPool pool;
+    Scheduler scheduler(workers);
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        scheduler.spawn([&, i]() {
+            auto interpreter = pool.acquire();
+            try {
+                interpreter->setScriptPath(filenames[i]);
+                interpreter->execute(programs[i]);
+                errors[i] = interpreter->getErrors();
+            } catch (const std::exception& e) {
+                errors[i].push_back(std::string("Fatal error: ") + e.what());
+            }
+        });
+    }
+
+    scheduler.run();
+
+    if (virtual_time) {
+        std::chrono::duration<double> real = std::chrono::steady_clock::now() - real_start;
+        std::cerr << std::fixed << std::setprecision(3)
+                  << "[VIRTUAL TIME] " << Clock::virtualElapsedMs() / 1000.0
+                  << " s simulated in " << real.count() << " s\n";
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (errors[i].empty()) continue;
+        std::cerr << "Runtime errors in " << filenames[i] << ":\n";
+        for (const auto& error : errors[i]) {
+            std::cerr << "  " << error << "\n";
+        }
+        status = 1;
+    }
+    return status;
+}
+
+static int run(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string arg = argv[1];
+
+    if (arg == "--help" || arg == "-h") {
+        printUsage(argv[0]);
+        return 0;
+    }
+
+    if (arg == "--version" || arg == "-v") {
+        std::cout << "AndroidScript v1.0.0-alpha\n";
+        return 0;
+    }
+
+    if (arg == "--emit-cpp") {
+        return emitCpp(argc, argv);
+    }
+
+    if (arg == "--checkpoint" || arg == "--resume") {
+        return runCheckpointed(argc, argv);
+    }
+
+    if (arg == "--coverage" || arg == "--debug" || arg.rfind("--profile=", 0) == 0) {
+        return runInstrumented(argc, argv);
+    }
+
+    if (arg == "--workers" || arg == "--virtual-time" || argc > 2) {
+        return runScripts(argc, argv);
+    }
+
+    // Read and parse script file
+    std::string filename = argv[1];
+    std::vector<std::unique_ptr<Statement>> ast;
+    if (!loadScript(filename, ast)) {
+        return 1;
+    }
+
+    // Interpreter, with the built-in functions shared read-only
+    auto interpreter = InterpreterPool::create();
 
     // Execute
     try {
-        interpreter.execute(ast);
+        interpreter->setScriptPath(filename);
+        interpreter->execute(ast);
+
+        // Spawned tasks reference the script's AST; let them finish first
+        Scheduler::drainShared();
 
-        if (interpreter.hasErrors()) {
+        if (interpreter->hasErrors()) {
             std::cerr << "Runtime errors:\n";
-            for (const auto& error : interpreter.getErrors()) {
+            for (const auto& error : interpreter->getErrors()) {
                 std::cerr << "  " << error << "\n";
             }
             return 1;
@@ -97,3 +430,31 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 }
+
+// --trace=<file> may precede any of the run modes above
+int main(int argc, char* argv[]) {
+    std::string first = argc > 1 ? argv[1] : "";
+    if (first.rfind("--trace=", 0) != 0) {
+        return run(argc, argv);
+    }
+
+    std::string path = first.substr(std::string("--trace=").size());
+    try {
+        Tracer::start(path);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<char*> rest(argv, argv + argc + 1);
+    rest.erase(rest.begin() + 1);
+    int status = run(argc - 1, rest.data());
+
+    Tracer::stop();
+    std::cerr << "[TRACE] " << Tracer::eventsWritten() << " events written to " << path;
+    if (uint64_t dropped = Tracer::eventsDropped()) {
+        std::cerr << " (" << dropped << " dropped while buffers were full)";
+    }
+    std::cerr << "\n";
+    return status;
+}